@@ -72,10 +72,25 @@ typedef enum
     DDWAF_LOG_OFF,
 } DDWAF_LOG_LEVEL;
 
+/**
+ * @enum DDWAF_RESULT_FORMAT
+ *
+ * Format in which ddwaf_run reports the matches.
+ **/
+typedef enum
+{
+    /** Matches are serialized to JSON in ddwaf_result.data. **/
+    DDWAF_RESULT_JSON   = 0,
+    /** Matches are returned as a ddwaf_object array by ddwaf_run_with_matches,
+     *  no JSON is generated. **/
+    DDWAF_RESULT_OBJECT = 1,
+} DDWAF_RESULT_FORMAT;
+
 typedef struct _ddwaf_handle* ddwaf_handle;
 typedef struct _ddwaf_context* ddwaf_context;
 typedef struct _ddwaf_object ddwaf_object;
 typedef struct _ddwaf_config ddwaf_config;
+typedef struct _ddwaf_options ddwaf_options;
 typedef struct _ddwaf_result ddwaf_result;
 typedef struct _ddwaf_version ddwaf_version;
 
@@ -115,6 +130,41 @@ struct _ddwaf_config
     int32_t maxTimeStore;
 };
 
+/**
+ * @struct ddwaf_options
+ *
+ * Options of the WAF added after ddwaf_config, whose layout can't change as
+ * it's allocated by the caller. Only read by ddwaf_init_with_options, up to
+ * the size set by the caller: the options past it keep their default. The
+ * structure should be zeroed, which gives the default of every option, and
+ * its size set to sizeof(ddwaf_options).
+ **/
+struct _ddwaf_options
+{
+    /** Size of the structure, as known by the caller. **/
+    uint32_t size;
+    /** Format of the matches reported by ddwaf_run, defaults to JSON. **/
+    DDWAF_RESULT_FORMAT resultFormat;
+    /** Number of threads evaluating the flows of a run in parallel, under the
+     *  same timeout. 0 or 1 evaluates them serially on the calling thread.
+     *  Past 1, the log callback is also called from the worker threads. **/
+    uint32_t workerThreads;
+    /** Maximum number of bytes of a string evaluated by match_regex, is_sqli
+     *  and is_xss. Past DDWAF_MAX_STRING_LENGTH, the string is evaluated in
+     *  overlapping windows of that size. 0 defaults to DDWAF_MAX_STRING_LENGTH. **/
+    uint64_t maxStringLength;
+    /** Memory budget, in bytes, of the match_regex conditions, including the
+     *  sets and copies used to prefilter them. A regular expression running
+     *  on its own gets four times the share of a prefiltered one. Regular
+     *  expressions not compiling within their share get the smallest budget
+     *  they compile in, the total being then reported in a warning. 0
+     *  defaults to 512KiB per regular expression. **/
+    uint64_t maxRegexMemory;
+    /** Whether ddwaf_init_with_options builds the DFA states reached by a
+     *  few typical inputs, rather than leaving it to the first runs. **/
+    bool warmUpRegexes;
+};
+
 /**
  * @struct ddwaf_result
  *
@@ -124,7 +174,7 @@ struct _ddwaf_result
 {
     /** Run result action **/
     DDWAF_RET_CODE action;
-    /** Run result in JSON format **/
+    /** Run result in JSON format, only set with DDWAF_RESULT_JSON **/
     const char* data;
     /** Performance data in JSON format **/
     const char* perfData;
@@ -179,6 +229,20 @@ typedef void (*ddwaf_log_cb)(
  **/
 ddwaf_handle ddwaf_init(const ddwaf_object *rule, const ddwaf_config* config);
 
+/**
+ * ddwaf_init_with_options
+ *
+ * Initialize a ddwaf instance, with the options added after ddwaf_config.
+ *
+ * @param rule ddwaf::object containing the patterns to be used by the WAF. (nonnull)
+ * @param config Optional configuration of the WAF. (nullable)
+ * @param options Optional options of the WAF, only read up to options->size
+ *                bytes. (nullable)
+ *
+ * @return Handle to the WAF instance.
+ **/
+ddwaf_handle ddwaf_init_with_options(const ddwaf_object *rule, const ddwaf_config* config, const ddwaf_options* options);
+
 /**
  * ddwaf_destroy
  *
@@ -200,6 +264,18 @@ void ddwaf_destroy(ddwaf_handle handle);
  * @return NULL if error, otherwise a pointer to an array with size elements.
  **/
 const char* const* ddwaf_required_addresses(const ddwaf_handle handle, uint32_t *size);
+
+/**
+ * ddwaf_regex_fallbacks
+ *
+ * Get the number of regular expression searches which ran out of DFA memory,
+ * and thus fell back to a slower engine, since the WAF was initialised.
+ *
+ * @param Handle to the WAF instance.
+ * @return 0 if error, otherwise the number of fallbacks.
+ **/
+uint64_t ddwaf_regex_fallbacks(const ddwaf_handle handle);
+
 /**
  * ddwaf_context_init
  *
@@ -250,6 +326,44 @@ ddwaf_context ddwaf_context_init(const ddwaf_handle handle, ddwaf_object_free_fn
  **/
 DDWAF_RET_CODE ddwaf_run(ddwaf_context context, ddwaf_object *data, ddwaf_result *result, uint64_t timeout);
 
+/**
+ * ddwaf_run_with_matches
+ *
+ * Same as ddwaf_run, also providing the matches of a WAF instance created with
+ * the DDWAF_RESULT_OBJECT format. ddwaf_run discards them.
+ *
+ * @param matches Matches of the run, as a ddwaf_object array with the same
+ *                layout as the JSON, DDWAF_OBJ_INVALID if nothing matched, if
+ *                the format is DDWAF_RESULT_JSON or on error. To be freed with
+ *                ddwaf_object_free. (nullable)
+ **/
+DDWAF_RET_CODE ddwaf_run_with_matches(ddwaf_context context, ddwaf_object *data, ddwaf_result *result, ddwaf_object *matches, uint64_t timeout);
+
+/**
+ * ddwaf_run_many
+ *
+ * Perform a matching operation on a batch of contexts, each item behaving as
+ * if ddwaf_run(contexts[i], &data[i], &results[i], timeout) had been called.
+ *
+ * @param contexts Array of count WAF contexts, a null context results in
+ *                 DDWAF_ERR_INVALID_ARGUMENT for its item. (nonnull)
+ * @param data Array of count objects, data[i] is provided to contexts[i] with
+ *             the same ownership rules as ddwaf_run. (nonnull)
+ * @param results Array of count structures containing the result of each
+ *                item. (nullable)
+ * @param count Number of items in the batch.
+ * @param timeout Maximum time budget in microseconds of each item, counted
+ *                from the end of the previous one, or from the call for the
+ *                first one: the clock is read once between two items.
+ *
+ * @return The error of the first item which failed, if any. Otherwise the
+ *         most severe return code of the batch (DDWAF_BLOCK, then
+ *         DDWAF_MONITOR and DDWAF_GOOD), DDWAF_GOOD if the batch is empty.
+ * @error DDWAF_ERR_INVALID_ARGUMENT The contexts or data array is null, no item
+ *                                   was processed.
+ **/
+DDWAF_RET_CODE ddwaf_run_many(ddwaf_context *contexts, ddwaf_object *data, ddwaf_result *results, size_t count, uint64_t timeout);
+
 /**
  * ddwaf_context_destroy
  *
@@ -263,7 +377,7 @@ void ddwaf_context_destroy(ddwaf_context context);
 /**
  * ddwaf_result_free
  *
- * Free a ddwaf_result structure.
+ * Free a ddwaf_result structure, including the matches object.
  *
  * @param result Structure to free. (nonnull)
  **/
@@ -470,7 +584,9 @@ void ddwaf_get_version(ddwaf_version *version);
 /**
  * ddwaf_set_log_cb
  *
- * Sets the callback to relay logging messages to the binding
+ * Sets the callback to relay logging messages to the binding. The callback
+ * must be thread-safe: it's called from every thread running the WAF,
+ * including the worker threads of ddwaf_options::workerThreads.
  *
  * @param cb The callback to call, or NULL to stop relaying messages
  * @param min_level The minimum logging level for which to relay messages
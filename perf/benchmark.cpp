@@ -0,0 +1,282 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+// Measures the throughput and the latency of ddwaf_run.
+//
+// Usage: ddwaf_benchmark <ruleset> <corpus> [iterations] [timeout]
+//
+// The ruleset and the corpus are YAML or JSON files. The corpus is a sequence
+// of requests, each request being either a map of addresses, provided to a
+// fresh context in a single ddwaf_run, or a sequence of such maps, provided
+// to the same context in successive calls. The whole corpus is run
+// `iterations` times (default 100) with a timeout of `timeout` microseconds
+// per call (default 1s, so that no call times out).
+
+#include <yaml-cpp/yaml.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "ddwaf.h"
+
+namespace
+{
+std::atomic<uint64_t> allocationCount { 0 };
+std::atomic<uint64_t> allocationBytes { 0 };
+
+void countAllocation(size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocationBytes.fetch_add(size, std::memory_order_relaxed);
+}
+}
+
+#if defined(__GLIBC__)
+// glibc lets the program replace malloc, which counts every allocation: those
+// of operator new, of the ddwaf_object helpers and of strdup
+const char* const allocationScope = "malloc";
+
+extern "C"
+{
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t count, size_t size);
+    void* __libc_realloc(void* ptr, size_t size);
+    void __libc_free(void* ptr);
+
+    void* malloc(size_t size) noexcept
+    {
+        countAllocation(size);
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t count, size_t size) noexcept
+    {
+        countAllocation(count * size);
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* ptr, size_t size) noexcept
+    {
+        countAllocation(size);
+        return __libc_realloc(ptr, size);
+    }
+
+    void free(void* ptr) noexcept
+    {
+        __libc_free(ptr);
+    }
+}
+#else
+// Elsewhere, only the allocations performed through operator new are counted,
+// not those of the ddwaf_object helpers (malloc)
+const char* const allocationScope = "operator new";
+
+void* operator new(size_t size)
+{
+    countAllocation(size);
+
+    void* ptr = malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    free(ptr);
+}
+#endif
+
+namespace
+{
+
+using clock_type = std::chrono::steady_clock;
+
+ddwaf_object nodeToObject(const YAML::Node& node)
+{
+    ddwaf_object arg;
+    switch (node.Type())
+    {
+        case YAML::NodeType::Sequence:
+            ddwaf_object_array(&arg);
+            for (auto it = node.begin(); it != node.end(); ++it)
+            {
+                ddwaf_object child = nodeToObject(*it);
+                ddwaf_object_array_add(&arg, &child);
+            }
+            break;
+        case YAML::NodeType::Map:
+            ddwaf_object_map(&arg);
+            for (auto it = node.begin(); it != node.end(); ++it)
+            {
+                std::string key    = it->first.as<std::string>();
+                ddwaf_object child = nodeToObject(it->second);
+                ddwaf_object_map_addl(&arg, key.c_str(), key.size(), &child);
+            }
+            break;
+        case YAML::NodeType::Scalar:
+        {
+            const std::string& value = node.Scalar();
+            ddwaf_object_stringl(&arg, value.c_str(), value.size());
+            break;
+        }
+        default:
+            ddwaf_object_invalid(&arg);
+            break;
+    }
+
+    return arg;
+}
+
+// A request is the list of batches provided to a single context
+std::vector<std::vector<YAML::Node>> loadCorpus(const YAML::Node& corpus)
+{
+    std::vector<std::vector<YAML::Node>> requests;
+    for (auto it = corpus.begin(); it != corpus.end(); ++it)
+    {
+        if (it->IsMap())
+        {
+            requests.push_back({ *it });
+        }
+        else if (it->IsSequence())
+        {
+            std::vector<YAML::Node> batches(it->begin(), it->end());
+            requests.push_back(std::move(batches));
+        }
+    }
+    return requests;
+}
+
+uint64_t percentile(const std::vector<uint64_t>& sorted, double rank)
+{
+    const size_t index = std::min(sorted.size() - 1, (size_t)(rank * (double) sorted.size()));
+    return sorted[index];
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "Usage: %s <ruleset> <corpus> [iterations] [timeout]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const uint64_t iterations = argc > 3 ? strtoull(argv[3], nullptr, 10) : 100;
+    const uint64_t timeout    = argc > 4 ? strtoull(argv[4], nullptr, 10) : 1000000;
+
+    ddwaf_handle handle = nullptr;
+    std::vector<std::vector<YAML::Node>> requests;
+    try
+    {
+        ddwaf_object rule = nodeToObject(YAML::LoadFile(argv[1]));
+        handle            = ddwaf_init(&rule, nullptr);
+        ddwaf_object_free(&rule);
+
+        requests = loadCorpus(YAML::LoadFile(argv[2]));
+    }
+    catch (const std::exception& e)
+    {
+        fprintf(stderr, "Failed to load the inputs: %s\n", e.what());
+        return EXIT_FAILURE;
+    }
+
+    if (handle == nullptr)
+    {
+        fprintf(stderr, "Failed to load the ruleset %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    if (requests.empty())
+    {
+        fprintf(stderr, "No request found in %s\n", argv[2]);
+        ddwaf_destroy(handle);
+        return EXIT_FAILURE;
+    }
+
+    std::vector<uint64_t> latencies;
+    uint64_t matches = 0, timeouts = 0, errors = 0;
+    uint64_t allocations = 0, allocatedBytes = 0;
+    clock_type::duration total { 0 };
+
+    for (uint64_t iteration = 0; iteration < iterations; ++iteration)
+    {
+        for (const auto& request : requests)
+        {
+            ddwaf_context context = ddwaf_context_init(handle, ddwaf_object_free);
+            for (const YAML::Node& batch : request)
+            {
+                // Only ddwaf_run is measured, not the creation of its input
+                ddwaf_object data = nodeToObject(batch);
+                ddwaf_result result;
+
+                const uint64_t countBefore = allocationCount.load(std::memory_order_relaxed);
+                const uint64_t bytesBefore = allocationBytes.load(std::memory_order_relaxed);
+                const auto start           = clock_type::now();
+
+                const DDWAF_RET_CODE code = ddwaf_run(context, &data, &result, timeout);
+
+                const auto elapsed = clock_type::now() - start;
+                allocations += allocationCount.load(std::memory_order_relaxed) - countBefore;
+                allocatedBytes += allocationBytes.load(std::memory_order_relaxed) - bytesBefore;
+
+                total += elapsed;
+                latencies.push_back((uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+
+                if (code == DDWAF_MONITOR || code == DDWAF_BLOCK)
+                    ++matches;
+                else if (code == DDWAF_ERR_TIMEOUT)
+                    ++timeouts;
+                else if (code != DDWAF_GOOD)
+                    ++errors;
+
+                if (code != DDWAF_ERR_INTERNAL)
+                    ddwaf_result_free(&result);
+            }
+            ddwaf_context_destroy(context);
+        }
+    }
+
+    ddwaf_destroy(handle);
+
+    if (latencies.empty())
+    {
+        fprintf(stderr, "Nothing was run\n");
+        return EXIT_FAILURE;
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    const double runs    = (double) latencies.size();
+    const double seconds = std::chrono::duration<double>(total).count();
+
+    printf("runs:        %zu (%zu requests x %" PRIu64 " iterations)\n", latencies.size(), requests.size(), iterations);
+    printf("matches:     %" PRIu64 "\n", matches);
+    printf("timeouts:    %" PRIu64 "\n", timeouts);
+    printf("errors:      %" PRIu64 "\n", errors);
+    printf("throughput:  %.0f runs/s\n", seconds > 0 ? runs / seconds : 0.0);
+    printf("mean:        %.3f us\n", seconds * 1e6 / runs);
+    printf("p50:         %.3f us\n", (double) percentile(latencies, 0.50) / 1000);
+    printf("p99:         %.3f us\n", (double) percentile(latencies, 0.99) / 1000);
+    printf("p999:        %.3f us\n", (double) percentile(latencies, 0.999) / 1000);
+    printf("max:         %.3f us\n", (double) latencies.back() / 1000);
+    printf("allocations: %.2f per run, %.0f bytes per run (%s)\n", (double) allocations / runs, (double) allocatedBytes / runs, allocationScope);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,133 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+// Measures the cost of feeding the items of a large input to the conditions,
+// through ddwaf_run: `rules` rules each have a single match_regex condition on
+// the same address, which never matches, and the address is a map of `leaves`
+// strings. The time of each run is divided by the number of items looked at
+// (keys and values of the leaves) times the number of conditions.
+//
+// Usage: ddwaf_dispatch_benchmark [leaves] [rules] [iterations]
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "ddwaf.h"
+
+namespace
+{
+
+using clock_type = std::chrono::steady_clock;
+
+ddwaf_object buildRuleset(size_t ruleCount)
+{
+    ddwaf_object ruleset, rules, tmp;
+    ddwaf_object_map(&ruleset);
+    ddwaf_object_map_add(&ruleset, "version", ddwaf_object_string(&tmp, "2.1"));
+
+    ddwaf_object_array(&rules);
+    for (size_t i = 0; i < ruleCount; ++i)
+    {
+        const std::string id = std::to_string(i);
+
+        ddwaf_object tags;
+        ddwaf_object_map(&tags);
+        ddwaf_object_map_add(&tags, "type", ddwaf_object_string(&tmp, "flow1"));
+        ddwaf_object_map_add(&tags, "category", ddwaf_object_string(&tmp, "category1"));
+
+        ddwaf_object input, inputs;
+        ddwaf_object_map(&input);
+        ddwaf_object_map_add(&input, "address", ddwaf_object_string(&tmp, "arg"));
+        ddwaf_object_array(&inputs);
+        ddwaf_object_array_add(&inputs, &input);
+
+        // Distinct regexes, so that every condition is evaluated
+        const std::string regex = "^never_" + id + "_[0-9]+$";
+        ddwaf_object parameters;
+        ddwaf_object_map(&parameters);
+        ddwaf_object_map_add(&parameters, "inputs", &inputs);
+        ddwaf_object_map_add(&parameters, "regex", ddwaf_object_string(&tmp, regex.c_str()));
+
+        ddwaf_object condition, conditions;
+        ddwaf_object_map(&condition);
+        ddwaf_object_map_add(&condition, "operator", ddwaf_object_string(&tmp, "match_regex"));
+        ddwaf_object_map_add(&condition, "parameters", &parameters);
+        ddwaf_object_array(&conditions);
+        ddwaf_object_array_add(&conditions, &condition);
+
+        ddwaf_object rule;
+        ddwaf_object_map(&rule);
+        ddwaf_object_map_add(&rule, "id", ddwaf_object_string(&tmp, id.c_str()));
+        ddwaf_object_map_add(&rule, "name", ddwaf_object_string(&tmp, ("rule" + id).c_str()));
+        ddwaf_object_map_add(&rule, "tags", &tags);
+        ddwaf_object_map_add(&rule, "conditions", &conditions);
+        ddwaf_object_array_add(&rules, &rule);
+    }
+
+    ddwaf_object_map_add(&ruleset, "rules", &rules);
+    return ruleset;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t leaves       = argc > 1 ? strtoull(argv[1], nullptr, 10) : 4096;
+    const size_t ruleCount    = argc > 2 ? strtoull(argv[2], nullptr, 10) : 16;
+    const uint64_t iterations = argc > 3 ? strtoull(argv[3], nullptr, 10) : 200;
+    if (leaves == 0 || ruleCount == 0 || iterations == 0)
+    {
+        fprintf(stderr, "Usage: %s [leaves] [rules] [iterations]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // Every leaf is looked at
+    ddwaf_config config  = { leaves, DDWAF_MAX_MAP_DEPTH, 0 };
+    ddwaf_object ruleset = buildRuleset(ruleCount);
+    ddwaf_handle handle  = ddwaf_init(&ruleset, &config);
+    ddwaf_object_free(&ruleset);
+    if (handle == nullptr)
+    {
+        fprintf(stderr, "Failed to load the ruleset\n");
+        return EXIT_FAILURE;
+    }
+
+    ddwaf_object values, data, tmp;
+    ddwaf_object_map(&values);
+    for (size_t i = 0; i < leaves; ++i)
+    {
+        const std::string key = "key" + std::to_string(i);
+        ddwaf_object_map_add(&values, key.c_str(), ddwaf_object_string(&tmp, "some value to look at"));
+    }
+    ddwaf_object_map(&data);
+    ddwaf_object_map_add(&data, "arg", &values);
+
+    // The contexts don't own the data, it's reused by every run
+    uint64_t failures = 0;
+    const auto start  = clock_type::now();
+    for (uint64_t iteration = 0; iteration < iterations; ++iteration)
+    {
+        ddwaf_context context = ddwaf_context_init(handle, nullptr);
+        if (context == nullptr || ddwaf_run(context, &data, nullptr, 10000000) != DDWAF_GOOD)
+            failures += 1;
+        ddwaf_context_destroy(context);
+    }
+    const double elapsed = std::chrono::duration<double, std::nano>(clock_type::now() - start).count();
+
+    const double items = (double) (2 * leaves * ruleCount);
+    printf("leaves:     %zu x %zu rules x %" PRIu64 " iterations\n", leaves, ruleCount, iterations);
+    printf("run:        %.3f us\n", elapsed / (double) iterations / 1000.0);
+    printf("item:       %.3f ns per item (key or value) and condition\n", elapsed / (double) iterations / items);
+    printf("failures:   %" PRIu64 "\n", failures);
+
+    ddwaf_object_free(&data);
+    ddwaf_destroy(handle);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,202 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+// Measures the lookups of ip_match through ddwaf::ip_set (as it is now) and
+// through the radix tree with inet_pton (as it used to be), with and without
+// the parsing of the address.
+//
+// Usage: ddwaf_ip_benchmark [networks] [lookups]
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32) || defined(__MINGW32__)
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#endif
+
+#include <ip_set.hpp>
+#include <radixlib.h>
+
+namespace
+{
+
+using clock_type = std::chrono::steady_clock;
+
+struct network
+{
+    std::string text;
+    ddwaf::ip_address address;
+    uint8_t bits;
+};
+
+std::string toString(const ddwaf::ip_address& address)
+{
+    char buffer[64];
+    if (address.isMappedIPv4())
+    {
+        const uint32_t ipv4 = (uint32_t) address.lo;
+        snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", ipv4 >> 24, (ipv4 >> 16) & 0xff, (ipv4 >> 8) & 0xff, ipv4 & 0xff);
+        return buffer;
+    }
+
+    snprintf(buffer, sizeof(buffer), "%x:%x:%x:%x:%x:%x:%x:%x",
+             (unsigned) (address.hi >> 48), (unsigned) (address.hi >> 32) & 0xffff,
+             (unsigned) (address.hi >> 16) & 0xffff, (unsigned) address.hi & 0xffff,
+             (unsigned) (address.lo >> 48), (unsigned) (address.lo >> 32) & 0xffff,
+             (unsigned) (address.lo >> 16) & 0xffff, (unsigned) address.lo & 0xffff);
+    return buffer;
+}
+
+void toBytes(const ddwaf::ip_address& address, uint8_t bytes[16])
+{
+    for (int i = 0; i < 8; ++i)
+    {
+        bytes[i]     = (uint8_t) (address.hi >> (56 - 8 * i));
+        bytes[i + 8] = (uint8_t) (address.lo >> (56 - 8 * i));
+    }
+}
+
+// The previous implementation of IPMatch::performMatch
+bool radixLookup(radix_tree_t* tree, const std::string& ip)
+{
+    uint8_t bytes[16] = { 0 };
+    if (inet_pton(AF_INET, ip.c_str(), bytes) == 1)
+    {
+        bytes[10] = bytes[11] = 0xff;
+        bytes[12]             = bytes[0];
+        bytes[13]             = bytes[1];
+        bytes[14]             = bytes[2];
+        bytes[15]             = bytes[3];
+        bytes[0] = bytes[1] = bytes[2] = bytes[3] = 0;
+    }
+    else if (inet_pton(AF_INET6, ip.c_str(), bytes) != 1)
+    {
+        return false;
+    }
+
+    prefix_t prefix;
+    radix_prefix_init(FAMILY_IPv6, bytes, 128, &prefix);
+    return radix_matching_do(tree, &prefix);
+}
+
+template <typename Lookup>
+double measure(size_t count, uint64_t& matches, Lookup&& lookup)
+{
+    matches          = 0;
+    const auto start = clock_type::now();
+    for (size_t i = 0; i < count; ++i)
+        matches += lookup(i) ? 1 : 0;
+    return std::chrono::duration<double, std::nano>(clock_type::now() - start).count() / (double) count;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t networkCount = argc > 1 ? strtoull(argv[1], nullptr, 10) : 100000;
+    const size_t lookupCount  = argc > 2 ? strtoull(argv[2], nullptr, 10) : 1000000;
+    if (networkCount == 0 || lookupCount == 0)
+    {
+        fprintf(stderr, "Usage: %s [networks] [lookups]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // Mostly IPv4 networks and addresses, as in the usual deny lists
+    std::mt19937_64 random(42);
+    const auto randomAddress = [&random]() {
+        ddwaf::ip_address address;
+        if (random() % 10 != 0)
+            address.lo = 0xffff00000000 | (random() & 0xffffffff);
+        else
+            address = { 0x2000000000000000 | (random() >> 3), random() };
+        return address;
+    };
+
+    std::vector<network> networks;
+    networks.reserve(networkCount);
+    for (size_t i = 0; i < networkCount; ++i)
+    {
+        ddwaf::ip_address address = randomAddress();
+        const bool isIPv4         = address.isMappedIPv4();
+        const uint8_t bits        = (uint8_t) (isIPv4 ? 112 + random() % 17 : 32 + random() % 97);
+
+        ddwaf::ip_address last;
+        std::string text = toString(address) + "/" + std::to_string(isIPv4 ? bits - 96 : bits);
+        ddwaf::parse_cidr(text, address, last);
+        networks.push_back({ std::move(text), address, bits });
+    }
+
+    // Half of the lookups in one of the networks
+    std::vector<ddwaf::ip_address> addresses;
+    std::vector<std::string> strings;
+    addresses.reserve(lookupCount);
+    strings.reserve(lookupCount);
+    for (size_t i = 0; i < lookupCount; ++i)
+    {
+        ddwaf::ip_address address = randomAddress();
+        if (i % 2 == 0)
+        {
+            const network& target = networks[random() % networks.size()];
+            const uint8_t hostBits = (uint8_t) (128 - target.bits);
+            address                = target.address;
+            if (hostBits > 0 && hostBits <= 64)
+                address.lo |= random() & (~0ULL >> (64 - hostBits));
+        }
+        addresses.push_back(address);
+        strings.push_back(toString(address));
+    }
+
+    auto start = clock_type::now();
+    std::vector<std::string_view> views(networks.size());
+    for (size_t i = 0; i < networks.size(); ++i)
+        views[i] = networks[i].text;
+    const ddwaf::ip_set set(views);
+    const double setBuild = std::chrono::duration<double, std::milli>(clock_type::now() - start).count();
+
+    start              = clock_type::now();
+    radix_tree_t* tree = radix_new(128);
+    for (const network& entry : networks)
+    {
+        uint8_t bytes[16];
+        toBytes(entry.address, bytes);
+
+        prefix_t prefix;
+        radix_prefix_init(FAMILY_IPv6, bytes, entry.bits, &prefix);
+        radix_put_if_absent(tree, &prefix);
+    }
+    const double radixBuild = std::chrono::duration<double, std::milli>(clock_type::now() - start).count();
+
+    uint64_t setMatches, setParsedMatches, radixMatches, radixParsedMatches;
+    const double setParsed = measure(lookupCount, setParsedMatches, [&](size_t i) { return set.contains(addresses[i]); });
+    const double setString = measure(lookupCount, setMatches, [&](size_t i) { return set.contains(strings[i]); });
+    const double radixParsed = measure(lookupCount, radixParsedMatches, [&](size_t i) {
+        uint8_t bytes[16];
+        toBytes(addresses[i], bytes);
+
+        prefix_t prefix;
+        radix_prefix_init(FAMILY_IPv6, bytes, 128, &prefix);
+        return radix_matching_do(tree, &prefix);
+    });
+    const double radixString = measure(lookupCount, radixMatches, [&](size_t i) { return radixLookup(tree, strings[i]); });
+
+    printf("networks:      %zu (%zu ranges)\n", networks.size(), set.size());
+    printf("lookups:       %zu\n", lookupCount);
+    printf("build:         ip_set %.1f ms, radix %.1f ms\n", setBuild, radixBuild);
+    printf("ip_set:        %.1f ns per lookup, %.1f ns with parsing\n", setParsed, setString);
+    printf("radix:         %.1f ns per lookup, %.1f ns with inet_pton\n", radixParsed, radixString);
+    printf("matches:       %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64 "\n", setParsedMatches, setMatches, radixParsedMatches, radixMatches);
+
+    radix_free(tree);
+    return setMatches == radixMatches && setParsedMatches == radixParsedMatches ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,163 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+// Compares ddwaf_run_many to calling ddwaf_run on each item of a batch: the
+// batch is made of `batch` contexts, each provided a single short string on
+// the address of `rules` match_regex conditions which never match. Only the
+// calls to ddwaf_run and ddwaf_run_many are timed, the contexts are created
+// anew for every iteration.
+//
+// Usage: ddwaf_run_many_benchmark [batch] [rules] [iterations]
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "ddwaf.h"
+
+namespace
+{
+
+using clock_type = std::chrono::steady_clock;
+
+ddwaf_object buildRuleset(size_t ruleCount)
+{
+    ddwaf_object ruleset, rules, tmp;
+    ddwaf_object_map(&ruleset);
+    ddwaf_object_map_add(&ruleset, "version", ddwaf_object_string(&tmp, "2.1"));
+
+    ddwaf_object_array(&rules);
+    for (size_t i = 0; i < ruleCount; ++i)
+    {
+        const std::string id = std::to_string(i);
+
+        ddwaf_object tags;
+        ddwaf_object_map(&tags);
+        ddwaf_object_map_add(&tags, "type", ddwaf_object_string(&tmp, "flow1"));
+        ddwaf_object_map_add(&tags, "category", ddwaf_object_string(&tmp, "category1"));
+
+        ddwaf_object input, inputs;
+        ddwaf_object_map(&input);
+        ddwaf_object_map_add(&input, "address", ddwaf_object_string(&tmp, "arg"));
+        ddwaf_object_array(&inputs);
+        ddwaf_object_array_add(&inputs, &input);
+
+        const std::string regex = "^never_" + id + "_[0-9]+$";
+        ddwaf_object parameters;
+        ddwaf_object_map(&parameters);
+        ddwaf_object_map_add(&parameters, "inputs", &inputs);
+        ddwaf_object_map_add(&parameters, "regex", ddwaf_object_string(&tmp, regex.c_str()));
+
+        ddwaf_object condition, conditions;
+        ddwaf_object_map(&condition);
+        ddwaf_object_map_add(&condition, "operator", ddwaf_object_string(&tmp, "match_regex"));
+        ddwaf_object_map_add(&condition, "parameters", &parameters);
+        ddwaf_object_array(&conditions);
+        ddwaf_object_array_add(&conditions, &condition);
+
+        ddwaf_object rule;
+        ddwaf_object_map(&rule);
+        ddwaf_object_map_add(&rule, "id", ddwaf_object_string(&tmp, id.c_str()));
+        ddwaf_object_map_add(&rule, "name", ddwaf_object_string(&tmp, ("rule" + id).c_str()));
+        ddwaf_object_map_add(&rule, "tags", &tags);
+        ddwaf_object_map_add(&rule, "conditions", &conditions);
+        ddwaf_object_array_add(&rules, &rule);
+    }
+
+    ddwaf_object_map_add(&ruleset, "rules", &rules);
+    return ruleset;
+}
+
+// Returns the time spent in the runs, in nanoseconds
+double runBatch(ddwaf_handle handle, std::vector<ddwaf_object>& data, bool many, uint64_t& failures)
+{
+    // The contexts don't own the data, it's reused by every iteration
+    std::vector<ddwaf_context> contexts(data.size());
+    for (ddwaf_context& context : contexts)
+    {
+        context = ddwaf_context_init(handle, nullptr);
+    }
+
+    const auto start = clock_type::now();
+    if (many)
+    {
+        if (ddwaf_run_many(contexts.data(), data.data(), nullptr, data.size(), 10000000) != DDWAF_GOOD)
+            failures += 1;
+    }
+    else
+    {
+        for (size_t i = 0; i < data.size(); ++i)
+        {
+            if (ddwaf_run(contexts[i], &data[i], nullptr, 10000000) != DDWAF_GOOD)
+                failures += 1;
+        }
+    }
+    const double elapsed = std::chrono::duration<double, std::nano>(clock_type::now() - start).count();
+
+    for (ddwaf_context context : contexts)
+    {
+        ddwaf_context_destroy(context);
+    }
+    return elapsed;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t batch        = argc > 1 ? strtoull(argv[1], nullptr, 10) : 64;
+    const size_t ruleCount    = argc > 2 ? strtoull(argv[2], nullptr, 10) : 4;
+    const uint64_t iterations = argc > 3 ? strtoull(argv[3], nullptr, 10) : 2000;
+    if (batch == 0 || ruleCount == 0 || iterations == 0)
+    {
+        fprintf(stderr, "Usage: %s [batch] [rules] [iterations]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    ddwaf_object ruleset = buildRuleset(ruleCount);
+    ddwaf_handle handle  = ddwaf_init(&ruleset, nullptr);
+    ddwaf_object_free(&ruleset);
+    if (handle == nullptr)
+    {
+        fprintf(stderr, "Failed to load the ruleset\n");
+        return EXIT_FAILURE;
+    }
+
+    std::vector<ddwaf_object> data(batch);
+    for (size_t i = 0; i < batch; ++i)
+    {
+        const std::string value = "value " + std::to_string(i);
+        ddwaf_object tmp;
+        ddwaf_object_map(&data[i]);
+        ddwaf_object_map_add(&data[i], "arg", ddwaf_object_string(&tmp, value.c_str()));
+    }
+
+    // Interleaved, so that both are equally affected by the state of the machine
+    uint64_t failures = 0;
+    double runTime    = 0, manyTime = 0;
+    for (uint64_t iteration = 0; iteration < iterations; ++iteration)
+    {
+        runTime += runBatch(handle, data, false, failures);
+        manyTime += runBatch(handle, data, true, failures);
+    }
+
+    const double items = (double) (batch * iterations);
+    printf("batch:      %zu items x %zu rules x %" PRIu64 " iterations\n", batch, ruleCount, iterations);
+    printf("ddwaf_run:  %.3f ns per item\n", runTime / items);
+    printf("run_many:   %.3f ns per item (%.1f%%)\n", manyTime / items, 100.0 * (manyTime - runTime) / runTime);
+    printf("failures:   %" PRIu64 "\n", failures);
+
+    for (ddwaf_object& item : data)
+    {
+        ddwaf_object_free(&item);
+    }
+    ddwaf_destroy(handle);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
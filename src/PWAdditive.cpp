@@ -8,6 +8,7 @@
 
 #include <PWAdditive.hpp>
 #include <PWRet.hpp>
+#include <algorithm>
 #include <tuple>
 #include <utils.h>
 
@@ -15,22 +16,127 @@ PWAdditive::PWAdditive(std::shared_ptr<PowerWAF> _wafReference)
     : wafReference(_wafReference),
       wafHandle(_wafReference.get()),
       retriever(wafHandle->manifest, wafHandle->maxMapDepth, wafHandle->maxArrayLength),
-      processor(retriever, wafHandle->rules),
+      processor(retriever, wafHandle->rules, wafHandle->targetIndex),
       obj_free(ddwaf_object_free)
 {
     argCache.reserve(ADDITIVE_BUFFER_PREALLOC);
+    initShards();
 }
 
 PWAdditive::PWAdditive(const ddwaf_handle _waf, ddwaf_object_free_fn free_fn)
     : wafHandle((const PowerWAF*) _waf),
       retriever(wafHandle->manifest, wafHandle->maxMapDepth, wafHandle->maxArrayLength),
-      processor(retriever, wafHandle->rules),
+      processor(retriever, wafHandle->rules, wafHandle->targetIndex),
       obj_free(free_fn)
 {
     argCache.reserve(ADDITIVE_BUFFER_PREALLOC);
+    initShards();
 }
 
-ddwaf_result PWAdditive::run(ddwaf_object newParameters, uint64_t timeLeft)
+PWAdditive::flow_shard::flow_shard(const PowerWAF& waf)
+    : retriever(waf.manifest, waf.maxMapDepth, waf.maxArrayLength),
+      processor(retriever, waf.rules, waf.targetIndex)
+{
+}
+
+void PWAdditive::initShards()
+{
+    if (!wafHandle->workers)
+    {
+        return;
+    }
+
+    const ddwaf::flow_vector& flows = wafHandle->flows;
+    const size_t count              = std::min(wafHandle->workers->size() + 1, flows.size());
+    if (count <= 1)
+    {
+        return;
+    }
+
+    for (size_t i = 1; i < count; ++i)
+    {
+        shards.emplace_back(std::make_unique<flow_shard>(*wafHandle));
+    }
+
+    // Balance the number of rules, largest flows first. The assignment must
+    // stay the same for the whole context as the caches live in the processors.
+    std::vector<size_t> order(flows.size());
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&flows](size_t left, size_t right) {
+        return flows[left].second.size() > flows[right].second.size();
+    });
+
+    std::vector<size_t> load(count, 0);
+    for (const size_t flow : order)
+    {
+        const size_t lane = (size_t) std::distance(load.begin(), std::min_element(load.begin(), load.end()));
+        load[lane] += flows[flow].second.size();
+        (lane == 0 ? ownFlows : shards[lane - 1]->flows).push_back(flow);
+    }
+
+    processor.restrictTo(flows, ownFlows);
+    for (auto& shard : shards)
+    {
+        shard->processor.restrictTo(flows, shard->flows);
+    }
+
+    flowManagers.reserve(flows.size());
+    for (size_t i = 0; i < flows.size(); ++i)
+    {
+        flowManagers.emplace_back(std::make_unique<PWRetManager>(wafHandle->maxTimeStore, wafHandle->resultFormat));
+    }
+}
+
+bool PWAdditive::isFirstRun() const
+{
+    return processor.isFirstRun() && std::all_of(shards.begin(), shards.end(), [](const auto& shard) {
+               return shard->processor.isFirstRun();
+           });
+}
+
+void PWAdditive::runShards(const SQPowerWAF::monotonic_clock::time_point& deadline, PWRetManager& retManager)
+{
+    const ddwaf::flow_vector& flows = wafHandle->flows;
+
+    for (auto& shard : shards)
+    {
+        shard->processor.startNewRun(deadline);
+    }
+
+    // Merge in the order of the flows, as the serial evaluation reports them.
+    // The managers are emptied even if a lane threw, as the next run reuses them.
+    const auto mergeFlows = [&]() {
+        for (auto& manager : flowManagers)
+        {
+            retManager.merge(*manager);
+        }
+    };
+
+    try
+    {
+        wafHandle->workers->run(shards.size() + 1, [&](size_t lane) {
+            PWProcessor& laneProcessor          = lane == 0 ? processor : shards[lane - 1]->processor;
+            const std::vector<size_t>& laneFlow = lane == 0 ? ownFlows : shards[lane - 1]->flows;
+            for (const size_t flow : laneFlow)
+            {
+                laneProcessor.runFlow(flows[flow].first, flows[flow].second, *flowManagers[flow]);
+            }
+        });
+    }
+    catch (...)
+    {
+        mergeFlows();
+        throw;
+    }
+
+    mergeFlows();
+}
+
+ddwaf_result PWAdditive::run(ddwaf_object newParameters, uint64_t timeLeft, ddwaf_object* matches,
+                             SQPowerWAF::monotonic_clock::time_point* start)
 {
     if (!retriever.addParameter(newParameters))
     {
@@ -45,6 +151,11 @@ ddwaf_result PWAdditive::run(ddwaf_object newParameters, uint64_t timeLeft)
     // Take ownership of newParameters
     argCache.emplace_back(newParameters);
 
+    for (auto& shard : shards)
+    {
+        shard->retriever.addParameter(newParameters, false);
+    }
+
     // If the timeout provided is 0, we need to ensure the parameters are owned
     // by the additive to ensure that the semantics of DDWAF_ERR_TIMEOUT are
     // consistent across all possible timeout scenarios.
@@ -53,27 +164,39 @@ ddwaf_result PWAdditive::run(ddwaf_object newParameters, uint64_t timeLeft)
         return returnErrorCode(DDWAF_ERR_TIMEOUT);
     }
 
-    const SQPowerWAF::monotonic_clock::time_point now      = SQPowerWAF::monotonic_clock::now();
+    const SQPowerWAF::monotonic_clock::time_point now      = start != nullptr ? *start : SQPowerWAF::monotonic_clock::now();
     const SQPowerWAF::monotonic_clock::time_point deadline = now + std::chrono::microseconds(timeLeft);
 
     // If this is a new run but no rule care about those new params, let's skip the run
-    if (!processor.isFirstRun() && !retriever.hasNewArgs())
+    if (!isFirstRun() && !retriever.hasNewArgs())
     {
         return returnErrorCode(DDWAF_GOOD);
     }
 
     processor.startNewRun(deadline);
 
-    PWRetManager retManager(wafHandle->maxTimeStore, processor.getGlobalAllocator());
-    for (const auto& [key, flow] : wafHandle->flows)
+    PWRetManager retManager(wafHandle->maxTimeStore, wafHandle->resultFormat);
+    if (shards.empty())
     {
-        processor.runFlow(key, flow, retManager);
+        for (const auto& [key, flow] : wafHandle->flows)
+        {
+            processor.runFlow(key, flow, retManager);
+        }
+    }
+    else
+    {
+        runShards(deadline, retManager);
     }
 
-    ddwaf_result output = retManager.synthetize();
+    ddwaf_result output = retManager.synthetize(matches);
 
-    const SQPowerWAF::monotonic_clock::duration runTime = SQPowerWAF::monotonic_clock::now() - now;
+    const SQPowerWAF::monotonic_clock::time_point end    = SQPowerWAF::monotonic_clock::now();
+    const SQPowerWAF::monotonic_clock::duration runTime = end - now;
     output.perfTotalRuntime                             = (uint32_t) std::min(runTime.count() / 1000, SQPowerWAF::monotonic_clock::duration::rep(UINT32_MAX));
+    if (start != nullptr)
+    {
+        *start = end;
+    }
 
     return output;
 }
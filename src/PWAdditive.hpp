@@ -25,18 +25,44 @@ class PWAdditive
     PWProcessor processor;
     ddwaf_object_free_fn obj_free;
 
+    // Parallel evaluation: the flows are split between the processor above and
+    // the shards, each with its own retriever so that no state is shared
+    struct flow_shard
+    {
+        PWRetriever retriever;
+        PWProcessor processor;
+        std::vector<size_t> flows;
+
+        flow_shard(const PowerWAF& waf);
+    };
+
+    std::vector<size_t> ownFlows;
+    std::vector<std::unique_ptr<flow_shard>> shards;
+    // One per flow, emptied in the result of the run once the lanes are done
+    std::vector<std::unique_ptr<PWRetManager>> flowManagers;
+
+    void initShards();
+    bool isFirstRun() const;
+    void runShards(const SQPowerWAF::monotonic_clock::time_point& deadline, PWRetManager& retManager);
+
 public:
     PWAdditive(std::shared_ptr<PowerWAF>);
     PWAdditive(const ddwaf_handle, ddwaf_object_free_fn free_fn);
 
     PWAdditive(const PWAdditive&) = delete;
 
-    ddwaf_result run(ddwaf_object, uint64_t);
+    // The matches of DDWAF_RESULT_OBJECT are moved to matches, if provided.
+    // With start, the run is timed from *start, which is then set to the end
+    // of the run if the rules were evaluated: a batch reads the clock once
+    // between two runs.
+    ddwaf_result run(ddwaf_object, uint64_t, ddwaf_object* matches = nullptr,
+                     SQPowerWAF::monotonic_clock::time_point* start = nullptr);
 
     void flushCaches();
 
 #ifdef TESTING
     FRIEND_TEST(TestPWProcessor, TestCache);
+    FRIEND_TEST(TestPWProcessor, TestArena);
     FRIEND_TEST(TestPWManifest, TestUnknownArgID);
 #endif
 };
@@ -6,40 +6,64 @@
 
 #include <PWProcessor.hpp>
 #include <PWRet.hpp>
+#include <algorithm>
 #include <ddwaf.h>
 #include <iostream>
 #include <log.hpp>
 
 using status = ddwaf::condition::status;
 
-PWProcessor::PWProcessor(PWRetriever& input, const ddwaf::rule_map& rules_)
-    : parameters(input), rules(rules_), runCount(0)
+PWProcessor::PWProcessor(PWRetriever& input, const ddwaf::rule_vector& rules_, const ddwaf::target_index& targetIndex_)
+    : parameters(input), rules(rules_), targetIndex(targetIndex_), runCount(0),
+      ranCache(rules_.size(), 0), matchedCache(rules_.size(), false),
+      slotResults(targetIndex_.slotCount), walkerTarget(1), walker(input),
+      flowStops(targetIndex_.flowCount)
 {
-    ranCache.reserve(rules.size());
     matchCache.reserve(16);
-    document.SetArray();
+}
+
+PWProcessor::~PWProcessor()
+{
+    for (auto& [index, match] : matchCache)
+    {
+        ddwaf_object_free(&match);
+    }
 }
 
 void PWProcessor::startNewRun(const SQPowerWAF::monotonic_clock::time_point& _deadline)
 {
-    document.GetArray().Clear();
+    slotMatches.clear();
+    pendingGatherers.clear();
+    transformCache.clear();
+    runArena.reset();
     deadline = _deadline;
     runCount += 1;
 }
 
-bool PWProcessor::hasCacheHit(const std::string& ruleID, bool& hadNegativeMatch, bool& hitFromThisRun) const
+void PWProcessor::restrictTo(const ddwaf::flow_vector& flows, const std::vector<size_t>& subset)
+{
+    ownedRules.assign(rules.size(), false);
+    for (const size_t flow : subset)
+    {
+        for (const ddwaf::rule_index index : flows[flow].second)
+        {
+            ownedRules[index] = true;
+        }
+    }
+}
+
+bool PWProcessor::hasCacheHit(ddwaf::rule_index index, bool& hadNegativeMatch, bool& hitFromThisRun) const
 {
-    const auto cacheHit    = ranCache.find(ruleID);
-    const bool hasCacheHit = cacheHit != ranCache.end();
-    if (hasCacheHit)
+    const uint64_t lastRun = ranCache[index];
+    if (lastRun != 0)
     {
-        if (cacheHit->second.first)
+        if (matchedCache[index])
         {
             return true;
         }
 
         hadNegativeMatch = true;
-        hitFromThisRun   = cacheHit->second.second == runCount;
+        hitFromThisRun   = lastRun == runCount;
     }
 
     return false;
@@ -59,7 +83,216 @@ bool PWProcessor::shouldIgnoreCacheHit(const std::vector<ddwaf::condition>& cond
     return false;
 }
 
-void PWProcessor::runFlow(const std::string& name, const std::vector<std::string>& flow, PWRetManager& retManager)
+bool PWProcessor::isRulePending(ddwaf::rule_index index) const
+{
+    // Mirror the cache logic of runFlow to find whether the rule may run
+    bool cachedNegativeMatch = false, hitFromThisRun = false;
+    if (hasCacheHit(index, cachedNegativeMatch, hitFromThisRun))
+    {
+        return false;
+    }
+
+    return !cachedNegativeMatch || (!hitFromThisRun && shouldIgnoreCacheHit(rules[index].conditions));
+}
+
+bool PWProcessor::isPastFlowStop(ddwaf::rule_index index) const
+{
+    const auto& [flow, position] = targetIndex.flowPositions[index];
+    const FlowStop& stop         = flowStops[flow];
+    return position > stop.matched || (stop.run == runCount && position > stop.expected);
+}
+
+bool PWProcessor::expectFlowStop(ddwaf::rule_index index)
+{
+    const auto& [flow, position] = targetIndex.flowPositions[index];
+    FlowStop& stop               = flowStops[flow];
+    if (stop.run != runCount)
+    {
+        stop.run      = runCount;
+        stop.expected = UINT32_MAX;
+    }
+
+    if (position >= stop.expected)
+        return false;
+
+    stop.expected = position;
+    return true;
+}
+
+bool PWProcessor::walkTarget(PWManifest::ARG_ID target, const ddwaf::target_index::entry& requester)
+{
+    const bool isNewTarget = parameters.isKeyInLastBatch(target);
+
+    // Beyond the requester, feed the items to the first condition of every
+    // rule which may run, later conditions only run if the previous matched
+    pendingEntries.clear();
+    pendingEntries.push_back(&requester);
+    for (const ddwaf::target_index::entry& entry : targetIndex.conditions[target])
+    {
+        if (entry.condition != 0 || entry.slot == requester.slot || slotResults[entry.slot].run == runCount)
+            continue;
+
+        if (!ownedRules.empty() && !ownedRules[entry.rule])
+            continue;
+
+        const ddwaf::rule& rule = rules[entry.rule];
+        if (!rule.conditions[entry.condition].supportsTargetIndex() || !isRulePending(entry.rule) || isPastFlowStop(entry.rule))
+            continue;
+
+        // After a negative match, single condition rules only run on new targets
+        if (!isNewTarget && ranCache[entry.rule] != 0 && rule.conditions.size() == 1)
+            continue;
+
+        // The condition already matched on one of its previous targets
+        const uint32_t base = entry.slot - entry.position;
+        bool matchedBefore  = false;
+        for (uint32_t slot = base; slot < entry.slot && !matchedBefore; ++slot)
+        {
+            matchedBefore = slotResults[slot].run == runCount && slotResults[slot].match >= 0;
+        }
+
+        if (!matchedBefore)
+            pendingEntries.push_back(&entry);
+    }
+
+    const SQPowerWAF::monotonic_clock::time_point start = SQPowerWAF::monotonic_clock::now();
+
+    walkerTarget[0] = target;
+    walker.reset(walkerTarget);
+    parameters.moveIteratorForward(walker, false);
+
+    const bool resolved = !walker.isOver();
+    for (const ddwaf::target_index::entry* entry : pendingEntries)
+    {
+        slotResults[entry->slot] = { runCount, resolved, -1, entry != &requester };
+    }
+
+    if (resolved && !feedWalker(pendingEntries.size()))
+        return false;
+
+    // Split the cost of the walk evenly between the slots evaluated, the ones
+    // dropped by feedWalker are walked again if they're needed after all
+    size_t evaluated = 0;
+    for (const ddwaf::target_index::entry* entry : pendingEntries)
+    {
+        evaluated += slotResults[entry->slot].run == runCount ? 1 : 0;
+    }
+
+    const auto share = (SQPowerWAF::monotonic_clock::now() - start) / evaluated;
+    for (const ddwaf::target_index::entry* entry : pendingEntries)
+    {
+        slotResults[entry->slot].cost = share;
+    }
+
+    timeAdjustment -= share * (evaluated - 1);
+    return true;
+}
+
+bool PWProcessor::feedWalker(size_t remaining)
+{
+    // A gatherer is only moved to slotMatches on a match, after which its
+    // entry isn't fed anymore
+    pendingGatherers.clear();
+    for (const ddwaf::target_index::entry* entry : pendingEntries)
+    {
+        pendingGatherers.emplace_back(rules[entry->rule].conditions[entry->condition].createGatherer(&runArena));
+    }
+
+    size_t counter = 0;
+    do
+    {
+        // Only check the time every 16 runs
+        if ((++counter & 0xf) == 0 && deadline <= SQPowerWAF::monotonic_clock::now())
+            return false;
+
+        for (size_t i = 0; i < pendingEntries.size(); ++i)
+        {
+            const ddwaf::target_index::entry* entry = pendingEntries[i];
+            SlotResult& result                      = slotResults[entry->slot];
+            if (result.match >= 0 || result.run != runCount)
+                continue;
+
+            const ddwaf::condition& cond = rules[entry->rule].conditions[entry->condition];
+            MatchGatherer& gather        = pendingGatherers[i];
+            if (cond.matchCurrentItem(parameters, walker, gather, &transformCache, &runArena))
+            {
+                result.match = (int32_t) slotMatches.size();
+                slotMatches.emplace_back(std::move(gather));
+
+                if (--remaining == 0)
+                    return true;
+
+                // A rule with a single condition is bound to match, the rules
+                // past it in its flow won't be evaluated during this run
+                if (rules[entry->rule].conditions.size() == 1 && expectFlowStop(entry->rule))
+                {
+                    // The requester, first, comes before the stop of its flow
+                    for (size_t j = 1; j < pendingEntries.size(); ++j)
+                    {
+                        SlotResult& other = slotResults[pendingEntries[j]->slot];
+                        if (other.match >= 0 || other.run != runCount || !isPastFlowStop(pendingEntries[j]->rule))
+                            continue;
+
+                        other.run = 0;
+                        if (--remaining == 0)
+                            return true;
+                    }
+                }
+            }
+            else
+            {
+                gather.clear();
+            }
+        }
+    } while (parameters.moveIteratorForward(walker));
+
+    return true;
+}
+
+status PWProcessor::matchCondition(ddwaf::rule_index index, uint32_t condIndex, bool runOnNewOnly, PWRetManager& retManager)
+{
+    const ddwaf::condition& cond = rules[index].conditions[condIndex];
+    if (!cond.supportsTargetIndex())
+    {
+        return cond.performMatching(parameters, deadline, retManager, &transformCache, &runArena);
+    }
+
+    const auto& targets = cond.getTargets();
+    const uint32_t base = targetIndex.slots[index][condIndex];
+
+    bool resolved = false;
+    for (uint32_t position = 0; position < targets.size(); ++position)
+    {
+        const PWManifest::ARG_ID target = targets[position];
+        if (runOnNewOnly && !parameters.isKeyInLastBatch(target))
+            continue;
+
+        // A duplicate target has no slot of its own and can't change the outcome
+        if (std::find(targets.begin(), targets.begin() + position, target) != targets.begin() + position)
+            continue;
+
+        const SlotResult& result = slotResults[base + position];
+        if (result.run != runCount)
+        {
+            const ddwaf::target_index::entry requester { index, condIndex, position, base + position };
+            if (!walkTarget(target, requester))
+                return status::timeout;
+        }
+
+        if (result.eager)
+        {
+            timeAdjustment += result.cost;
+        }
+
+        resolved |= result.resolved;
+        if (result.match >= 0)
+            return cond.finalizeMatching(true, &slotMatches[result.match], retManager);
+    }
+
+    return cond.finalizeMatching(resolved, nullptr, retManager);
+}
+
+void PWProcessor::runFlow(const std::string& name, const std::vector<ddwaf::rule_index>& flow, PWRetManager& retManager)
 {
     SQPowerWAF::monotonic_clock::time_point past = SQPowerWAF::monotonic_clock::now();
     SQPowerWAF::monotonic_clock::time_point now  = past;
@@ -81,36 +314,26 @@ void PWProcessor::runFlow(const std::string& name, const std::vector<std::string
 
     bool didMatch = false, skippedRule = true;
 
-    ddwaf::rule_map::const_iterator ruleMatched;
+    ddwaf::rule_index ruleMatched = 0;
 
     retManager.startRule();
 
     //Process each rule we have to run for this step of the flow
-    for (const std::string& ruleID : flow)
+    for (const ddwaf::rule_index index : flow)
     {
+        const ddwaf::rule& rule   = rules[index];
+        const std::string& ruleID = rule.id;
         DDWAF_DEBUG("Running the WAF on rule %s", ruleID.c_str());
 
         //Have we already ran this rule?
         bool cachedNegativeMatch = false, hitFromThisRun = false;
-        if (hasCacheHit(ruleID, cachedNegativeMatch, hitFromThisRun))
+        if (hasCacheHit(index, cachedNegativeMatch, hitFromThisRun))
         {
             didMatch = false;
             break;
         }
 
-        // Let's fetch the filters for the rule
-        auto it = rules.find(ruleID);
-        if (it == rules.end())
-        {
-            // This shouldn't happen
-            DDWAF_ERROR("Invalid rule (%s) in flow (%s), this is a bug",
-                        ruleID.c_str(), name.c_str());
-            skippedRule = true;
-            continue;
-        }
-
-        const ddwaf::rule& rule = it->second;
-        didMatch                = false;
+        didMatch = false;
 
         // If we had a negative match in the past, let's check if we have a reason to run again
         if (cachedNegativeMatch && (hitFromThisRun || !shouldIgnoreCacheHit(rule.conditions)))
@@ -123,16 +346,17 @@ void PWProcessor::runFlow(const std::string& name, const std::vector<std::string
         {
             past = SQPowerWAF::monotonic_clock::now();
         }
+        timeAdjustment = SQPowerWAF::monotonic_clock::duration(0);
 
         // Actually execute the rule
         //	We tell the PWRetriever to skip old parameters if this is safe to do so
-        parameters.resetMatchSession(cachedNegativeMatch && rule.conditions.size() == 1);
+        const bool runOnNewOnly = cachedNegativeMatch && rule.conditions.size() == 1;
+        parameters.resetMatchSession(runOnNewOnly);
 
-        size_t filter = 0;
-        for (const ddwaf::condition& cond : rule.conditions)
+        for (uint32_t filter = 0; filter < rule.conditions.size(); ++filter)
         {
-            parameters.setActiveFilter(filter++);
-            status matchingStatus = cond.performMatching(parameters, deadline, retManager);
+            parameters.setActiveFilter(filter);
+            status matchingStatus = matchCondition(index, filter, runOnNewOnly, retManager);
 
             //Stop if we didn't matched any of the parameters (2) or that the parameter couldn't be found
             if (matchingStatus == status::no_match || matchingStatus == status::missing_arg)
@@ -157,22 +381,19 @@ void PWProcessor::runFlow(const std::string& name, const std::vector<std::string
         }
 
         //Store the result of the rule in the cache
-        if (cachedNegativeMatch)
-        {
-            // If we bypassed the cache, then we need to overwrite the entry
-            ranCache.at(ruleID) = { didMatch, runCount };
-        }
-        else
-        {
-            // If that's the first execution, insert the cache entry
-            ranCache.insert({ ruleID, { didMatch, runCount } });
-        }
+        ranCache[index]     = runCount;
+        matchedCache[index] = didMatch;
+        ranAnyRule          = true;
 
-        // Collect the match payload
+        // Collect the match payload, the rules past this one won't run anymore
         if (didMatch)
         {
-            auto pair = std::pair<std::string, rapidjson::Value>(ruleID, retManager.fetchRuleCollector().GetArray());
-            matchCache.insert(std::move(pair));
+            const auto& [flow, position] = targetIndex.flowPositions[index];
+            flowStops[flow].matched      = std::min(flowStops[flow].matched, position);
+
+            ddwaf_object& match = matchCache[index];
+            ddwaf_object_free(&match);
+            match = retManager.fetchRuleCollector();
         }
 
         // Update the time measurement, and check the deadline while we're at it
@@ -180,13 +401,13 @@ void PWProcessor::runFlow(const std::string& name, const std::vector<std::string
         now = SQPowerWAF::monotonic_clock::now();
         if (retManager.shouldRecordTime())
         {
-            retManager.recordTime(ruleID, now - past);
+            retManager.recordTime(ruleID, std::max(now - past + timeAdjustment, SQPowerWAF::monotonic_clock::duration(0)));
             past = now;
         }
 
         if (didMatch)
         {
-            ruleMatched = it;
+            ruleMatched = index;
             break;
         }
 
@@ -203,11 +424,12 @@ void PWProcessor::runFlow(const std::string& name, const std::vector<std::string
     {
         DDWAF_RET_CODE code = DDWAF_MONITOR;
         // This should always be the case but let's be carefull
-        const auto& match = matchCache.find(ruleMatched->first);
+        const auto& match = matchCache.find(ruleMatched);
         if (match != matchCache.end())
         {
-            retManager.reportMatch(ruleMatched->first, name,
-                                   ruleMatched->second.category, ruleMatched->second.name, match->second);
+            const ddwaf::rule& rule = rules[ruleMatched];
+            retManager.reportMatch(rule.id, name, rule.category, rule.name, match->second);
+            matchCache.erase(match);
         }
         retManager.recordResult(code);
     }
@@ -215,10 +437,5 @@ void PWProcessor::runFlow(const std::string& name, const std::vector<std::string
 
 bool PWProcessor::isFirstRun() const
 {
-    return ranCache.empty();
-}
-
-rapidjson::Document::AllocatorType& PWProcessor::getGlobalAllocator()
-{
-    return document.GetAllocator();
+    return !ranAnyRule;
 }
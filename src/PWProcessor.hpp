@@ -7,39 +7,99 @@
 #ifndef PWProcessor_hpp
 #define PWProcessor_hpp
 
-#include <rapidjson/document.h>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 struct PWProcessor;
 
 #include <Clock.hpp>
 #include <PWRet.hpp>
 #include <PWRetriever.hpp>
+#include <arena.hpp>
 #include <rule.hpp>
+#include <transformation_cache.hpp>
 
 struct PWProcessor
 {
-    rapidjson::Document document;
     PWRetriever& parameters;
-    const ddwaf::rule_map& rules;
+    const ddwaf::rule_vector& rules;
+    const ddwaf::target_index& targetIndex;
 
     SQPowerWAF::monotonic_clock::time_point deadline;
     uint64_t runCount;
 
-    std::unordered_map<std::string, std::pair<bool, uint64_t>> ranCache;
-    std::unordered_map<std::string, rapidjson::Value> matchCache;
+    // Indexed by rule: run during which the rule was last evaluated (0 if never)
+    std::vector<uint64_t> ranCache;
+    // Indexed by rule: whether the last evaluation of the rule matched
+    std::vector<bool> matchedCache;
+    bool ranAnyRule { false };
+    // Rules this processor may evaluate, empty if it evaluates all of them
+    std::vector<bool> ownedRules;
 
-    bool hasCacheHit(const std::string& ruleID, bool& hadNegativeMatch, bool& hitFromThisRun) const;
+    // Match payload of the rules, owned until reported
+    std::unordered_map<ddwaf::rule_index, ddwaf_object> matchCache;
+    // Backs the transformed copies and the match gatherers, reset every run
+    ddwaf::arena runArena;
+    // Outputs of the transformer chains, only valid for the current run
+    ddwaf::transformation_cache transformCache;
+
+    // Address-major evaluation: outcome of each (condition, target) slot of the
+    // target index, only valid if it was evaluated during the current run
+    struct SlotResult
+    {
+        uint64_t run { 0 };
+        bool resolved { false };
+        int32_t match { -1 }; // Index in slotMatches
+        // Set if the slot was evaluated on behalf of another rule, in which
+        // case its share of the walk is billed to its own rule when consumed
+        bool eager { false };
+        SQPowerWAF::monotonic_clock::duration cost { 0 };
+    };
+
+    std::vector<SlotResult> slotResults;
+    std::vector<MatchGatherer> slotMatches;
+    std::vector<const ddwaf::target_index::entry*> pendingEntries;
+    // Gatherer of each pending entry, reset between the items of the walk
+    std::vector<MatchGatherer> pendingGatherers;
+    std::vector<PWManifest::ARG_ID> walkerTarget;
+    PWRetriever::Iterator walker;
+    // Indexed by flow: position of the first rule of the flow which matched in
+    // a previous run, and of the first one bound to match in the current run as
+    // its only condition matched during a walk. The rules past them aren't
+    // evaluated, so the walks don't feed their conditions.
+    struct FlowStop
+    {
+        uint32_t matched { UINT32_MAX };
+        uint64_t run { 0 };
+        uint32_t expected { UINT32_MAX };
+    };
+    std::vector<FlowStop> flowStops;
+    // Correction applied to the runtime of the rule being evaluated
+    SQPowerWAF::monotonic_clock::duration timeAdjustment { 0 };
+
+    bool hasCacheHit(ddwaf::rule_index index, bool& hadNegativeMatch, bool& hitFromThisRun) const;
     bool shouldIgnoreCacheHit(const std::vector<ddwaf::condition>& rules) const;
+    bool isRulePending(ddwaf::rule_index index) const;
+    bool isPastFlowStop(ddwaf::rule_index index) const;
+    bool expectFlowStop(ddwaf::rule_index index);
+
+    bool walkTarget(PWManifest::ARG_ID target, const ddwaf::target_index::entry& requester);
+    bool feedWalker(size_t remaining);
+    ddwaf::condition::status matchCondition(ddwaf::rule_index index, uint32_t condIndex, bool runOnNewOnly, PWRetManager& retManager);
 
 public:
-    PWProcessor(PWRetriever& input, const ddwaf::rule_map& rules);
+    PWProcessor(PWRetriever& input, const ddwaf::rule_vector& rules, const ddwaf::target_index& targetIndex);
+    PWProcessor(const PWProcessor&) = delete;
+    PWProcessor& operator=(const PWProcessor&) = delete;
+    ~PWProcessor();
     void startNewRun(const SQPowerWAF::monotonic_clock::time_point& _deadline);
-    void runFlow(const std::string& name, const std::vector<std::string>& flow, PWRetManager& manager);
+    // Only evaluate the rules of these flows, other processors take care of the rest
+    void restrictTo(const ddwaf::flow_vector& flows, const std::vector<size_t>& subset);
+    void runFlow(const std::string& name, const std::vector<ddwaf::rule_index>& flow, PWRetManager& manager);
 
     bool isFirstRun() const;
-    rapidjson::Document::AllocatorType& getGlobalAllocator();
+    const ddwaf::arena::counters& getArenaStats() const { return runArena.stats(); }
 };
 
 #endif /* PWProcessor_hpp */
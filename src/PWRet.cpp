@@ -13,6 +13,7 @@
 #include <rapidjson/document.h>
 #include <rapidjson/prettywriter.h>
 #include <string>
+#include <string_view>
 
 ddwaf_result returnErrorCode(DDWAF_RET_CODE code)
 {
@@ -26,12 +27,62 @@ ddwaf_result returnErrorCode(DDWAF_RET_CODE code)
     return output;
 }
 
-PWRetManager::PWRetManager(uint32_t slotsToSaveTimeFor, rapidjson::Document::AllocatorType& alloc) : allocator(alloc), roomInTimeStore(slotsToSaveTimeFor)
+// Streams a ddwaf_object tree as JSON, without building an intermediary DOM
+template <typename Writer>
+static bool serializeObject(const ddwaf_object& object, Writer& writer)
 {
-    outputDocument.SetArray();
+    switch (object.type)
+    {
+        case DDWAF_OBJ_STRING:
+            return writer.String(object.stringValue, static_cast<rapidjson::SizeType>(object.nbEntries));
+        case DDWAF_OBJ_UNSIGNED:
+            return writer.Uint64(object.uintValue);
+        case DDWAF_OBJ_SIGNED:
+            return writer.Int64(object.intValue);
+        case DDWAF_OBJ_ARRAY:
+            writer.StartArray();
+            for (uint64_t i = 0; i < object.nbEntries; ++i)
+            {
+                if (!serializeObject(object.array[i], writer))
+                    return false;
+            }
+            return writer.EndArray();
+        case DDWAF_OBJ_MAP:
+            writer.StartObject();
+            for (uint64_t i = 0; i < object.nbEntries; ++i)
+            {
+                const ddwaf_object& child = object.array[i];
+                writer.Key(child.parameterName, static_cast<rapidjson::SizeType>(child.parameterNameLength));
+                if (!serializeObject(child, writer))
+                    return false;
+            }
+            return writer.EndObject();
+        default:
+            return false;
+    }
+}
+
+static void addString(ddwaf_object& map, const char* key, std::string_view value)
+{
+    ddwaf_object tmp;
+    // An empty string_view may not point anywhere
+    const char* data = value.data() != nullptr ? value.data() : "";
+    ddwaf_object_map_add(&map, key, ddwaf_object_stringl(&tmp, data, value.size()));
+}
+
+PWRetManager::PWRetManager(uint32_t slotsToSaveTimeFor, DDWAF_RESULT_FORMAT format_) : format(format_), roomInTimeStore(slotsToSaveTimeFor)
+{
+    ddwaf_object_array(&outputDocument);
+    ddwaf_object_array(&ruleCollector);
     timeStore.resize(slotsToSaveTimeFor);
 }
 
+PWRetManager::~PWRetManager()
+{
+    ddwaf_object_free(&outputDocument);
+    ddwaf_object_free(&ruleCollector);
+}
+
 bool PWRetManager::shouldRecordTime() const
 {
     return roomInTimeStore != 0;
@@ -45,13 +96,18 @@ void PWRetManager::recordResult(DDWAF_RET_CODE code)
 
 void PWRetManager::recordTime(const std::string& ruleName, SQPowerWAF::monotonic_clock::duration _duration)
 {
-    // Check if this is a slow enough run to be worth storing
     const uint32_t duration = (uint32_t) std::min(_duration.count() / 1000, SQPowerWAF::monotonic_clock::duration::rep(UINT32_MAX));
+    recordTime(ruleName.c_str(), ruleName.size(), duration);
+}
+
+void PWRetManager::recordTime(const char* ruleName, size_t length, uint32_t duration)
+{
+    // Check if this is a slow enough run to be worth storing
     if (duration <= lowestTime || roomInTimeStore == 0)
         return;
 
     // If yes, store it
-    timeStore[lowestTimeIndex] = std::make_pair(std::make_pair(ruleName.c_str(), ruleName.size()), duration);
+    timeStore[lowestTimeIndex] = std::make_pair(std::make_pair(ruleName, length), duration);
     lowestTime                 = duration;
 
     // Find the next quickest rule for eviction
@@ -67,39 +123,31 @@ void PWRetManager::recordTime(const std::string& ruleName, SQPowerWAF::monotonic
 
 void PWRetManager::startRule()
 {
-    ruleCollector = rapidjson::Value();
-    ruleCollector.SetArray();
+    ddwaf_object_free(&ruleCollector);
+    ddwaf_object_array(&ruleCollector);
 }
 
 void PWRetManager::recordRuleMatch(const std::unique_ptr<IPWRuleProcessor>& processor, const MatchGatherer& gather)
 {
-    rapidjson::Value output;
-    output.SetObject();
-
-    auto op = processor->operatorName();
-    output.AddMember("operator",
-                     rapidjson::GenericStringRef<char>(op.data(),
-                                                       static_cast<rapidjson::SizeType>(op.size())),
-                     allocator);
+    ddwaf_object output, parameters, param, key_path, highlight, tmp;
+    ddwaf_object_map(&output);
 
+    addString(output, "operator", processor->operatorName());
     if (processor->hasStringRepresentation())
     {
-        output.AddMember("operator_value", processor->getStringRepresentation(), allocator);
+        addString(output, "operator_value", processor->getStringRepresentation());
     }
     else
     {
-        output.AddMember("operator_value", "", allocator);
+        addString(output, "operator_value", "");
     }
 
-    rapidjson::Value parameters, param, key_path;
-    parameters.SetArray();
+    ddwaf_object_map(&param);
+    addString(param, "address", gather.dataSource);
 
-    param.SetObject();
-    param.AddMember("address", gather.dataSource, allocator);
-    key_path.SetArray();
+    ddwaf_object_array(&key_path);
     for (const ddwaf_object& key : gather.keyPath)
     {
-        rapidjson::Value jsonKey;
         if (key.type == DDWAF_OBJ_STRING)
         {
             if (key.stringValue == nullptr || key.nbEntries == 0)
@@ -107,63 +155,96 @@ void PWRetManager::recordRuleMatch(const std::unique_ptr<IPWRuleProcessor>& proc
                 // This shouldn't happen
                 continue;
             }
-            jsonKey.SetString(key.stringValue, static_cast<rapidjson::SizeType>(key.nbEntries), allocator);
+            ddwaf_object_stringl(&tmp, key.stringValue, key.nbEntries);
         }
         else
         {
-            jsonKey.SetUint64(key.uintValue);
+            ddwaf_object_unsigned_force(&tmp, key.uintValue);
         }
-        key_path.PushBack(jsonKey, allocator);
+        ddwaf_object_array_add(&key_path, &tmp);
     }
-    param.AddMember("key_path", key_path, allocator);
-    param.AddMember("value", gather.resolvedValue, allocator);
-    rapidjson::Value highlight, matchedValue;
-    highlight.SetArray();
+    ddwaf_object_map_add(&param, "key_path", &key_path);
+
+    addString(param, "value", gather.resolvedValue);
+
+    ddwaf_object_array(&highlight);
     if (!gather.matchedValue.empty())
     {
-        matchedValue.SetString(gather.matchedValue, allocator);
-        highlight.PushBack(matchedValue, allocator);
+        ddwaf_object_array_add(&highlight, ddwaf_object_stringl(&tmp, gather.matchedValue.data(), gather.matchedValue.size()));
     }
-    param.AddMember("highlight", highlight, allocator);
-    parameters.PushBack(param, allocator);
-    output.AddMember("parameters", parameters, allocator);
+    ddwaf_object_map_add(&param, "highlight", &highlight);
+
+    ddwaf_object_array(&parameters);
+    ddwaf_object_array_add(&parameters, &param);
+    ddwaf_object_map_add(&output, "parameters", &parameters);
 
-    ruleCollector.PushBack(output, allocator);
+    ddwaf_object_array_add(&ruleCollector, &output);
 }
 
-rapidjson::Value PWRetManager::fetchRuleCollector()
+ddwaf_object PWRetManager::fetchRuleCollector()
 {
-    // This will actually move the content of the ruleCollector: We're now an empty shell
-    return ruleCollector.GetArray();
+    // Hand over the content of the ruleCollector: We're now an empty shell
+    ddwaf_object collector = ruleCollector;
+    ddwaf_object_array(&ruleCollector);
+    return collector;
 }
 
 void PWRetManager::reportMatch(const std::string& id,
                                const std::string& type, const std::string& category,
-                               const std::string& name, const rapidjson::Value& filters)
+                               const std::string& name, ddwaf_object& filters)
 {
-    rapidjson::Value output, ruleValue, tagsValue;
+    ddwaf_object output, ruleValue, tagsValue;
 
-    output.SetObject();
+    ddwaf_object_map(&tagsValue);
+    addString(tagsValue, "type", type);
+    addString(tagsValue, "category", category);
 
-    tagsValue.SetObject();
-    tagsValue.AddMember("type", type, allocator);
-    tagsValue.AddMember("category", category, allocator);
+    ddwaf_object_map(&ruleValue);
+    addString(ruleValue, "id", id);
+    addString(ruleValue, "name", name);
+    ddwaf_object_map_add(&ruleValue, "tags", &tagsValue);
 
-    ruleValue.SetObject();
-    ruleValue.AddMember("id", id, allocator);
-    ruleValue.AddMember("name", name, allocator);
-    ruleValue.AddMember("tags", tagsValue, allocator);
+    ddwaf_object_map(&output);
+    ddwaf_object_map_add(&output, "rule", &ruleValue);
 
-    output.AddMember("rule", ruleValue, allocator);
+    // We take ownership of the filters, they're either moved in the output or freed
+    if (filters.type == DDWAF_OBJ_ARRAY && filters.nbEntries > 0)
+    {
+        ddwaf_object_map_add(&output, "rule_matches", &filters);
+    }
+    else
+    {
+        ddwaf_object_free(&filters);
+    }
+    ddwaf_object_invalid(&filters);
+
+    ddwaf_object_array_add(&outputDocument, &output);
+}
+
+void PWRetManager::merge(PWRetManager& other)
+{
+    recordResult(other.worstCode);
+    other.worstCode = DDWAF_GOOD;
 
-    if (filters.IsArray() && filters.GetArray().Size())
+    ddwaf_object* entries = const_cast<ddwaf_object*>(other.outputDocument.array);
+    for (uint64_t i = 0; i < other.outputDocument.nbEntries; ++i)
     {
-        rapidjson::Value array;
-        array.CopyFrom(filters, allocator);
-        output.AddMember("rule_matches", array, allocator);
+        ddwaf_object_array_add(&outputDocument, &entries[i]);
     }
+    // The entries now belong to us, only release the container
+    free(entries);
+    ddwaf_object_array(&other.outputDocument);
+
+    for (const auto& timeRecord : other.timeStore)
+    {
+        if (timeRecord.second == 0)
+            break;
 
-    outputDocument.PushBack(output, allocator);
+        recordTime(timeRecord.first.first, timeRecord.first.second, timeRecord.second);
+    }
+    other.timeStore.assign(other.timeStore.size(), {});
+    other.lowestTime      = 0;
+    other.lowestTimeIndex = 0;
 }
 
 void PWRetManager::synthetizeTimeSlots(rapidjson::Document& timeSlotDocument) const
@@ -214,18 +295,30 @@ void PWRetManager::synthetizeTimeSlots(rapidjson::Document& timeSlotDocument) co
     timeSlotDocument.AddMember("topRuleRuntime", recordCollector, timeSlotDocument.GetAllocator());
 }
 
-ddwaf_result PWRetManager::synthetize() const
+ddwaf_result PWRetManager::synthetize(ddwaf_object* matches)
 {
     ddwaf_result output = returnErrorCode(worstCode);
 
-    if (outputDocument.GetArray().Size() > 0)
+    if (outputDocument.nbEntries > 0)
     {
-        rapidjson::StringBuffer buffer;
-        buffer.Clear();
+        if (format == DDWAF_RESULT_OBJECT)
+        {
+            // The caller now owns the matches, they're freed with the manager otherwise
+            if (matches != nullptr)
+            {
+                *matches = outputDocument;
+                ddwaf_object_array(&outputDocument);
+            }
+        }
+        else
+        {
+            rapidjson::StringBuffer buffer;
+            buffer.Clear();
 
-        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-        if (outputDocument.Accept(writer))
-            output.data = strdup(buffer.GetString());
+            rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+            if (serializeObject(outputDocument, writer))
+                output.data = strdup(buffer.GetString());
+        }
     }
 
     // If we wrote anything, either the lowest value, or the index of the lowest value has to change (their both 0 by default)
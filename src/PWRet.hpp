@@ -20,9 +20,10 @@ class PWRetManager;
 
 class PWRetManager
 {
-    rapidjson::Document outputDocument;
-    rapidjson::Document::AllocatorType& allocator;
-    rapidjson::Value ruleCollector;
+    // Both are DDWAF_OBJ_ARRAY, owned by the manager until handed over
+    ddwaf_object outputDocument;
+    ddwaf_object ruleCollector;
+    const DDWAF_RESULT_FORMAT format;
 
     DDWAF_RET_CODE worstCode = DDWAF_GOOD;
 
@@ -33,9 +34,13 @@ class PWRetManager
     std::vector<std::pair<std::pair<const char*, size_t>, uint32_t>> timeStore;
 
     void synthetizeTimeSlots(rapidjson::Document& timeSlotCollector) const;
+    void recordTime(const char* ruleName, size_t length, uint32_t duration);
 
 public:
-    PWRetManager(uint32_t slotsToSaveTimeFor, rapidjson::Document::AllocatorType& allocator);
+    PWRetManager(uint32_t slotsToSaveTimeFor, DDWAF_RESULT_FORMAT format = DDWAF_RESULT_JSON);
+    PWRetManager(const PWRetManager&) = delete;
+    PWRetManager& operator=(const PWRetManager&) = delete;
+    ~PWRetManager();
 
     bool shouldRecordTime() const;
 
@@ -47,13 +52,18 @@ public:
 
     void reportMatch(const std::string& id,
                      const std::string& type, const std::string& category,
-                     const std::string& name, const rapidjson::Value& filters);
+                     const std::string& name, ddwaf_object& filters);
 
-    rapidjson::Value fetchRuleCollector();
+    ddwaf_object fetchRuleCollector();
 
     void removeResultFlow(const std::string& flow);
 
-    ddwaf_result synthetize() const;
+    // Take over the matches, result and timings of another manager, which is
+    // left empty and can be reused
+    void merge(PWRetManager& other);
+
+    // With DDWAF_RESULT_OBJECT, the matches are moved to matches, if any
+    ddwaf_result synthetize(ddwaf_object* matches = nullptr);
 
 #ifdef TESTING
     FRIEND_TEST(TestPWProcessor, TestCache);
@@ -100,7 +100,7 @@ bool PWRetriever::PWArgsWrapper::_validate_object(const ddwaf_object& input, uin
 
 PWRetriever::PWArgsWrapper::PWArgsWrapper(uint64_t _maxMapDepth, uint64_t _maxArrayLength) : maxArrayLength(_maxArrayLength), maxMapDepth(_maxMapDepth) {}
 
-bool PWRetriever::PWArgsWrapper::addParameter(const ddwaf_object input)
+bool PWRetriever::PWArgsWrapper::addParameter(const ddwaf_object input, bool validate)
 {
     DDWAF_TRACE("Sanitizing WAF parameters");
 
@@ -127,7 +127,7 @@ bool PWRetriever::PWArgsWrapper::addParameter(const ddwaf_object input)
 
     // Sanitize the parameters, and if they're all good, insert them in the array
     const ddwaf_object* mainArray = input.array;
-    for (size_t i = 0; i < input.nbEntries; ++i)
+    for (size_t i = 0; validate && i < input.nbEntries; ++i)
     {
         const char* parameterName = mainArray[i].parameterName;
 
@@ -360,7 +360,7 @@ const ddwaf_object* PWRetriever::ArgsIterator::getActiveItem() const
     return state.activeItem;
 }
 
-void PWRetriever::ArgsIterator::getKeyPath(std::vector<ddwaf_object>& keyPath) const
+void PWRetriever::ArgsIterator::getKeyPath(ddwaf::arena_vector<ddwaf_object>& keyPath) const
 {
     keyPath.reserve(state.stack.size() + 2);
 
@@ -597,10 +597,10 @@ bool PWRetriever::Iterator::matchIterOnPath(const std::set<std::string>& path, b
 
 PWRetriever::PWRetriever(const PWManifest& _manifest, uint64_t _maxMapDepth, uint64_t _maxArrayLength) : manifest(_manifest), wrapper(_maxMapDepth, _maxArrayLength), internalIterator(*this) {}
 
-bool PWRetriever::addParameter(const ddwaf_object input)
+bool PWRetriever::addParameter(const ddwaf_object input, bool validate)
 {
     newestBatch.clear();
-    if (!wrapper.addParameter(input))
+    if (!wrapper.addParameter(input, validate))
         return false;
 
     if (input.nbEntries)
@@ -694,37 +694,6 @@ bool PWRetriever::moveIteratorForward(Iterator& iter, bool shouldIncrementFirst)
     return false;
 }
 
-bool PWRetriever::runIterOnLambda(const PWRetriever::Iterator& iterator, const bool saveOnMatch, const std::function<ruleCallback>& lambda)
-{
-    const ddwaf_object* input = *iterator;
-    //Do we have data?
-#ifndef TESTING
-    //This should be impossible with messing with the Iterator context and we can't call this function directly as it'll break the coverage
-    // I'd still like the keep the test in just to be on the safe side
-    if (input == nullptr)
-        return false;
-#endif
-
-    //We match the key of the ddwaf_object if it exists
-    if (iterator.shouldMatchKey() && lambda(input, DDWAF_OBJ_STRING, true, true))
-    {
-        if (saveOnMatch)
-            registerMatch(input->parameterName, input->parameterNameLength);
-
-        return true;
-    }
-
-    if (iterator.shouldMatchValue() && lambda(input, input->type, false, true))
-    {
-        if (saveOnMatch && input->type == DDWAF_OBJ_STRING)
-            registerMatch(input->stringValue, input->nbEntries);
-
-        return true;
-    }
-
-    return false;
-}
-
 PWRetriever::MatchHistory::MatchHistory()
 {
     matchSession.reserve(8);
@@ -738,7 +707,7 @@ void PWRetriever::registerMatch(const char* value, uint64_t length)
 void PWRetriever::commitMatch(MatchGatherer& gather)
 {
     history.saveSubmatches(std::move(gather.submatches));
-    history.commitMatch(std::move(gather.dataSource), std::move(gather.manifestKey), std::move(gather.keyPath));
+    history.commitMatch(gather.dataSource, gather.manifestKey, std::move(gather.keyPath));
     gather.clear();
 }
 
@@ -784,12 +753,12 @@ void PWRetriever::MatchHistory::saveSubmatches(submatchType&& submatches)
     }
 }
 
-void PWRetriever::MatchHistory::commitMatch(std::string&& dataSource, std::string&& manifestKey, std::vector<ddwaf_object>&& keyPath)
+void PWRetriever::MatchHistory::commitMatch(std::string_view dataSource, std::string_view manifestKey, ddwaf::arena_vector<ddwaf_object>&& keyPath)
 {
     if (currentMatch.hasSubMatch || currentMatch.hasFullMatch)
     {
-        currentMatch.dataSource  = std::move(dataSource);
-        currentMatch.manifestKey = std::move(manifestKey);
+        currentMatch.dataSource  = dataSource;
+        currentMatch.manifestKey = manifestKey;
         currentMatch.keyPath     = std::move(keyPath);
         matchSession.emplace_back(std::make_pair(currentFilter, std::move(currentMatch)));
     }
@@ -7,7 +7,6 @@
 #ifndef PWArgsWrapper_h
 #define PWArgsWrapper_h
 
-#include <functional>
 #include <set>
 #include <stdint.h>
 #include <string>
@@ -35,7 +34,7 @@ public:
         const uint64_t maxMapDepth;
 
         PWArgsWrapper(uint64_t _maxMapDepth, uint64_t _maxArrayLength);
-        bool addParameter(const ddwaf_object input);
+        bool addParameter(const ddwaf_object input, bool validate = true);
         const ddwaf_object* getParameter(const std::string& paramName) const;
         bool isValid() const;
 
@@ -74,7 +73,7 @@ public:
         void gotoNext(bool skipIncrement = false);
         void reset(const ddwaf_object* args);
         const ddwaf_object* getActiveItem() const;
-        void getKeyPath(std::vector<ddwaf_object>& keyPath) const;
+        void getKeyPath(ddwaf::arena_vector<ddwaf_object>& keyPath) const;
         bool isOver() const;
 
         bool matchIterOnPath(const std::set<std::string>& path, bool isAllowList, size_t& blockDepth) const;
@@ -125,7 +124,7 @@ public:
 
     struct MatchHistory
     {
-        using submatchType = std::vector<std::pair<uint8_t, std::string>>;
+        using submatchType = decltype(MatchGatherer::submatches);
 
         struct Match
         {
@@ -138,9 +137,9 @@ public:
             bool hasSubMatch = false;
             submatchType subMatch;
 
-            std::string dataSource;
-            std::string manifestKey;
-            std::vector<ddwaf_object> keyPath;
+            std::string_view dataSource;
+            std::string_view manifestKey;
+            ddwaf::arena_vector<ddwaf_object> keyPath;
 
             void reset();
         };
@@ -156,7 +155,7 @@ public:
 
         void saveFullMatch(const char* value, size_t length);
         void saveSubmatches(submatchType&& submatches);
-        void commitMatch(std::string&& dataSource, std::string&& manifestKey, std::vector<ddwaf_object>&& keyPath);
+        void commitMatch(std::string_view dataSource, std::string_view manifestKey, ddwaf::arena_vector<ddwaf_object>&& keyPath);
 
         void reset();
     };
@@ -173,11 +172,10 @@ private:
 
     bool _matchIterOnPath(const Iterator& _iter, const std::vector<ddwaf_object>& path, bool isAllowList, size_t& blockDepth) const;
 
-    using ruleCallback = bool(const ddwaf_object*, DDWAF_OBJ_TYPE, bool, bool);
-
 public:
     PWRetriever(const PWManifest& _manifest, uint64_t _maxMapDepth, uint64_t _maxArrayLength);
-    bool addParameter(const ddwaf_object input);
+    // Validation can be skipped if the input was already accepted by another retriever
+    bool addParameter(const ddwaf_object input, bool validate = true);
     bool hasNewArgs() const;
     bool isKeyInLastBatch(PWManifest::ARG_ID key) const;
 
@@ -187,7 +185,10 @@ public:
 
     bool moveIteratorForward(Iterator& iter, bool shouldIncrementFirst = true);
 
-    bool runIterOnLambda(const PWRetriever::Iterator& iterator, const bool saveOnMatch, const std::function<ruleCallback>& lambda);
+    // Called for every item of every condition: the callback is a template parameter so that it can be inlined.
+    // It's called as bool(const ddwaf_object* input, DDWAF_OBJ_TYPE type, bool runOnKey, bool isReadOnlyArg)
+    template <typename Callback>
+    bool runIterOnLambda(const PWRetriever::Iterator& iterator, const bool saveOnMatch, Callback&& lambda);
 
     void registerMatch(const char* value, uint64_t length);
     void commitMatch(MatchGatherer& gather);
@@ -204,4 +205,36 @@ public:
 #endif
 };
 
+template <typename Callback>
+bool PWRetriever::runIterOnLambda(const PWRetriever::Iterator& iterator, const bool saveOnMatch, Callback&& lambda)
+{
+    const ddwaf_object* input = *iterator;
+    //Do we have data?
+#ifndef TESTING
+    //This should be impossible with messing with the Iterator context and we can't call this function directly as it'll break the coverage
+    // I'd still like the keep the test in just to be on the safe side
+    if (input == nullptr)
+        return false;
+#endif
+
+    //We match the key of the ddwaf_object if it exists
+    if (iterator.shouldMatchKey() && lambda(input, DDWAF_OBJ_STRING, true, true))
+    {
+        if (saveOnMatch)
+            registerMatch(input->parameterName, input->parameterNameLength);
+
+        return true;
+    }
+
+    if (iterator.shouldMatchValue() && lambda(input, input->type, false, true))
+    {
+        if (saveOnMatch && input->type == DDWAF_OBJ_STRING)
+            registerMatch(input->stringValue, input->nbEntries);
+
+        return true;
+    }
+
+    return false;
+}
+
 #endif /* PWArgsWrapper_h */
@@ -13,15 +13,19 @@
 
 #include <PWTransformer.h>
 
+#include <simd.hpp>
 #include <utils.h>
 
 static uint8_t fromHex(char c);
 PROD_STATIC uint8_t codepointToUTF8(uint32_t codepoint, char* utf8_buffer);
 static uint8_t writeCodePoint(uint32_t codepoint, char* utf8_buffer, uint64_t lengthLeft);
-static bool replaceIfMatch(char* array, uint64_t& readHead, uint64_t& writeHead, uint64_t readLengthLeft, const char* token, uint32_t tokenLength, char decodedToken);
 static bool decodeBase64(char* array, uint64_t& length);
 
-bool PWTransformer::runTransform(ddwaf_object* parameter, const std::function<transformer>& transformer, bool readOnly)
+// Bytes outside of the base64 alphabet, padding included
+static constexpr auto nonBase64 = ddwaf::simd::byte_set().with_range('A', 'Z').with_range('a', 'z').with_range('0', '9').with("+/").invert();
+
+template <typename Transformer>
+bool PWTransformer::runTransform(ddwaf_object* parameter, Transformer&& transformer, bool readOnly)
 {
     if (parameter->type != DDWAF_OBJ_STRING || parameter->stringValue == NULL)
         return false;
@@ -39,21 +43,15 @@ bool PWTransformer::transformLowerCase(ddwaf_object* parameter, bool readOnly)
 {
     return runTransform(
         parameter, [](char* array, uint64_t& length, bool readOnly) -> bool {
-            size_t pos = 0;
-
             //First loop looking for the first non-lowercase char
-            for (; pos < length && (array[pos] < 'A' || array[pos] > 'Z'); ++pos) {}
+            const size_t pos = ddwaf::simd::find_range(array, length, 'A', 'Z');
 
             //	If we're checking whether we need to do change, finding such a char mean we need to do so (we return true if we need to update)
             if (readOnly)
                 return pos != length;
 
             //	If we're mutating the string, then we have the starting offset
-            for (; pos < length; ++pos)
-            {
-                if (array[pos] >= 'A' && array[pos] <= 'Z')
-                    array[pos] += 'a' - 'A';
-            }
+            ddwaf::simd::lowercase(array + pos, length - pos);
 
             return true;
         },
@@ -65,21 +63,24 @@ bool PWTransformer::transformNoNull(ddwaf_object* parameter, bool readOnly)
     return runTransform(
         parameter, [](char* array, uint64_t& length, bool readOnly) -> bool {
             //First loop looking for the first null char
-            uint64_t read = 0;
-            for (; read < length && array[read]; ++read) {}
+            uint64_t read = ddwaf::simd::find_byte(array, length, 0);
 
             //	If we're checking whether we need to do change, finding such a char mean we need to do so (we return true if we need to update)
             if (readOnly)
                 return read != length;
 
             //	If we're mutating the string, then we have the starting offset
+            //	Skip the null chars and move the runs between them in one go
             uint64_t write = read;
-            for (; read < length; ++read)
+            while (read < length)
             {
-                if (!array[read])
-                    continue;
+                while (read < length && !array[read])
+                    ++read;
 
-                array[write++] = array[read];
+                const uint64_t next = read + ddwaf::simd::find_byte(array + read, length - read, 0);
+                memmove(&array[write], &array[read], next - read);
+                write += next - read;
+                read = next;
             }
 
             if (write < length)
@@ -98,30 +99,26 @@ bool PWTransformer::transformCompressWhiteSpace(ddwaf_object* parameter, bool re
     return runTransform(
         parameter, [](char* array, uint64_t& length, bool readOnly) -> bool {
             //First loop looking for the first two consecutives space char
-            uint64_t read = 1;
-            for (; read < length && (array[read] != ' ' || array[read - 1] != ' '); ++read) {}
+            uint64_t read = ddwaf::simd::find_pair(array, length, ' ');
 
             //	If we're checking whether we need to do change, finding such a chain mean we need to do so (we return true if we need to update)
             if (readOnly)
                 return read < length;
 
             //	If we're mutating the string, then we have the starting offset
+            //	The first space of a chain was already commited, we skip over the others
+            //	and move everything up to the next chain in one go
             uint64_t write = read;
             while (read < length)
             {
-                //When we find two consecutive spaces, we skip over them
-                // We check with read - 1 to make sure at least one space is commited
-                if (array[read] == ' ' && array[read - 1] == ' ')
-                {
-                    // Skip ahead
-                    while (++read < length && array[read] == ' ') {}
-
-                    // Should we run the end of the loop?
-                    if (read == length)
-                        break;
-                }
+                while (read < length && array[read] == ' ')
+                    ++read;
 
-                array[write++] = array[read++];
+                // No chain can start on a non-space char, the next one is after read
+                const uint64_t next = read + ddwaf::simd::find_pair(array + read, length - read, ' ');
+                memmove(&array[write], &array[read], next - read);
+                write += next - read;
+                read = next;
             }
 
             if (write < length)
@@ -166,8 +163,18 @@ bool PWTransformer::transformNormalize(ddwaf_object* parameter, bool readOnly)
             //	- `/.` and we thus erase the last directory
             while (read < length)
             {
-                // Everything is cool, writing away
-                if (array[read] != '.' || (read + 1 != length && array[read + 1] != '/'))
+                // Everything is cool, writing away up to the next `.`
+                if (array[read] != '.')
+                {
+                    const uint64_t next = read + ddwaf::simd::find_byte(array + read, length - read, '.');
+                    if (write != read)
+                        memmove(&array[write], &array[read], next - read);
+                    write += next - read;
+                    read = next;
+                    continue;
+                }
+
+                if (read + 1 != length && array[read + 1] != '/')
                 {
                     array[write++] = array[read++];
                     continue;
@@ -234,8 +241,7 @@ bool PWTransformer::transformNormalizeWin(ddwaf_object* parameter, bool readOnly
         return false;
 
     // Look for any backslash
-    uint64_t pos = 0;
-    for (; pos < parameter->nbEntries && parameter->stringValue[pos] != '\\'; ++pos) {}
+    uint64_t pos = ddwaf::simd::find_byte(parameter->stringValue, parameter->nbEntries, '\\');
 
     // If it found one, then that mean we will need to transform this string
     if (pos < parameter->nbEntries)
@@ -267,21 +273,22 @@ bool PWTransformer::transformDecodeURL(ddwaf_object* parameter, bool readOnly, b
 	 */
     return runTransform(
         parameter, [readIIS](char* array, uint64_t& length, bool readOnly) -> bool {
-            uint64_t read = 0;
-
-            // Fast forward to a space or an hex encode char
-            for (; read < length && array[read] != '+'; ++read)
+            // Only a space or a valid escape sequence will be decoded, the rest is copied as is
+            auto isEscape = [readIIS, array, length](uint64_t pos) -> bool {
+                if (pos + 2 < length && isxdigit(array[pos + 1]) && isxdigit(array[pos + 2]))
+                    return true;
+
+                return readIIS && pos + 5 < length && (array[pos + 1] | 0x20) == 'u'
+                    && isxdigit(array[pos + 2]) && isxdigit(array[pos + 3])
+                    && isxdigit(array[pos + 4]) && isxdigit(array[pos + 5]);
+            };
+
+            // Fast forward to a space or an hex encode char, jumping between the candidates
+            uint64_t read = ddwaf::simd::find_either(array, length, '%', '+');
+            while (read < length && array[read] == '%' && !isEscape(read))
             {
-                // Is there an hex encoded char?
-                if (read + 2 < length && array[read] == '%' && isxdigit(array[read + 1]) && isxdigit(array[read + 2]))
-                    break;
-
-                if (readIIS && read + 5 < length && array[read] == '%' && (array[read + 1] | 0x20) == 'u'
-                    && isxdigit(array[read + 2]) && isxdigit(array[read + 3])
-                    && isxdigit(array[read + 4]) && isxdigit(array[read + 5]))
-                {
-                    break;
-                }
+                read += 1;
+                read += ddwaf::simd::find_either(array + read, length - read, '%', '+');
             }
 
             if (readOnly)
@@ -291,47 +298,50 @@ bool PWTransformer::transformDecodeURL(ddwaf_object* parameter, bool readOnly, b
 
             while (read < length)
             {
+                // Copy the run of literal bytes up to the next candidate in one go
+                const uint64_t literal = ddwaf::simd::find_either(array + read, length - read, '%', '+');
+                if (literal != 0)
+                {
+                    memmove(&array[write], &array[read], literal);
+                    write += literal;
+                    read += literal;
+
+                    if (read == length)
+                        break;
+                }
+
                 if (array[read] == '+')
                 {
                     array[write++] = ' ';
                     read += 1;
                 }
-                else if (array[read] == '%')
+                // Normal URL encoding
+                else if (read + 2 < length && isxdigit(array[read + 1]) && isxdigit(array[read + 2]))
                 {
-                    // Normal URL encoding
-                    if (read + 2 < length && isxdigit(array[read + 1]) && isxdigit(array[read + 2]))
-                    {
-                        // TODO: we'll need to perform normalization here too
-                        const uint8_t highBits = fromHex(array[read + 1]);
-                        const uint8_t lowBits  = fromHex(array[read + 2]);
-                        array[write++]         = (char) (highBits << 4u | lowBits);
-                        read += 3;
-                    }
-                    // IIS-encoded wide characters
-                    else if (readIIS && read + 5 < length && (array[read + 1] | 0x20) == 'u'
-                             && isxdigit(array[read + 2]) && isxdigit(array[read + 3])
-                             && isxdigit(array[read + 4]) && isxdigit(array[read + 5]))
-                    {
-                        // Rebuild the codepoint from the hex
-                        const uint16_t codepoint = (uint16_t)(fromHex(array[read + 2]) << 12u | fromHex(array[read + 3]) << 8u | fromHex(array[read + 4]) << 4u | fromHex(array[read + 5]));
+                    // TODO: we'll need to perform normalization here too
+                    const uint8_t highBits = fromHex(array[read + 1]);
+                    const uint8_t lowBits  = fromHex(array[read + 2]);
+                    array[write++]         = (char) (highBits << 4u | lowBits);
+                    read += 3;
+                }
+                // IIS-encoded wide characters
+                else if (isEscape(read))
+                {
+                    // Rebuild the codepoint from the hex
+                    const uint16_t codepoint = (uint16_t)(fromHex(array[read + 2]) << 12u | fromHex(array[read + 3]) << 8u | fromHex(array[read + 4]) << 4u | fromHex(array[read + 5]));
 
-                        read += 6;
+                    read += 6;
 
-                        if (codepoint <= 0x7f)
-                        {
-                            array[write++] = (char) codepoint;
-                        }
-                        else
-                        {
-                            write += writeCodePoint(codepoint, &array[write], read - write);
-                        }
+                    if (codepoint <= 0x7f)
+                    {
+                        array[write++] = (char) codepoint;
                     }
-                    // Fallback
                     else
                     {
-                        array[write++] = array[read++];
+                        write += writeCodePoint(codepoint, &array[write], read - write);
                     }
                 }
+                // Fallback
                 else
                 {
                     array[write++] = array[read++];
@@ -557,6 +567,175 @@ bool PWTransformer::transformDecodeJS(ddwaf_object* parameter, bool readOnly)
         readOnly);
 }
 
+// Named character references, matched case insensitively and only when followed
+// by a semicolon. The lookup table below is computed by the compiler, adding a
+// reference only takes a new entry here.
+struct HTMLEntity
+{
+    const char* name;
+    uint8_t length;
+    char decoded;
+};
+
+static constexpr HTMLEntity htmlEntities[] = {
+    { "lt", 2, '<' },
+    { "gt", 2, '>' },
+    { "amp", 3, '&' },
+    { "quot", 4, '"' },
+    { "nbsp", 4, (char) 160 },
+};
+
+static constexpr size_t htmlEntityCount = sizeof(htmlEntities) / sizeof(htmlEntities[0]);
+static constexpr size_t htmlEntitySlots = 16;
+static_assert(htmlEntityCount <= htmlEntitySlots / 2, "Too many HTML entities for the lookup table");
+
+static constexpr uint8_t computeHTMLEntityMaxLength()
+{
+    uint8_t maxLength = 0;
+    for (const HTMLEntity& entity : htmlEntities)
+    {
+        maxLength = entity.length > maxLength ? entity.length : maxLength;
+    }
+    return maxLength;
+}
+
+static constexpr uint8_t htmlEntityMaxLength = computeHTMLEntityMaxLength();
+
+// Hash of a lowercase name from its length and its first and last letters
+static constexpr uint32_t hashHTMLEntity(uint32_t seed, uint8_t first, uint8_t last, size_t length)
+{
+    return (((uint32_t) first << 16 | (uint32_t) last << 8 | (uint32_t) length) * seed) >> 28;
+}
+static_assert(htmlEntitySlots == 1u << (32 - 28), "The hash must cover the lookup table");
+
+struct HTMLEntityTable
+{
+    uint32_t seed;
+    int8_t slots[htmlEntitySlots];
+};
+
+// Look for a seed for which the hash is perfect, i.e. doesn't have any collision on our names
+static constexpr HTMLEntityTable buildHTMLEntityTable()
+{
+    for (uint32_t seed = 1; seed < 0x100000; seed += 2)
+    {
+        HTMLEntityTable table { seed, {} };
+        for (int8_t& slot : table.slots)
+        {
+            slot = -1;
+        }
+
+        bool collision = false;
+        for (size_t index = 0; index < htmlEntityCount && !collision; ++index)
+        {
+            const HTMLEntity& entity = htmlEntities[index];
+            const uint32_t hash      = hashHTMLEntity(seed, (uint8_t) entity.name[0], (uint8_t) entity.name[entity.length - 1], entity.length);
+
+            collision         = table.slots[hash] != -1;
+            table.slots[hash] = (int8_t) index;
+        }
+
+        if (!collision)
+            return table;
+    }
+
+    return { 0, {} };
+}
+
+static constexpr HTMLEntityTable htmlEntityTable = buildHTMLEntityTable();
+static_assert(htmlEntityTable.seed != 0, "No perfect hash found for the HTML entities");
+
+// Value of the hexadecimal digits, 0xff for any other byte
+struct HTMLDigitTable
+{
+    uint8_t values[256];
+
+    constexpr HTMLDigitTable() : values()
+    {
+        for (uint32_t c = 0; c < 256; ++c)
+        {
+            values[c] = 0xff;
+        }
+        for (uint8_t c = 0; c < 10; ++c)
+        {
+            values['0' + c] = c;
+        }
+        for (uint8_t c = 0; c < 6; ++c)
+        {
+            values['a' + c] = values['A' + c] = 0xa + c;
+        }
+    }
+};
+
+static constexpr HTMLDigitTable htmlDigits;
+
+// Match the named reference starting right after a `&`, semicolon included
+static const HTMLEntity* matchHTMLEntity(const char* array, uint64_t lengthLeft, uint64_t& consumed)
+{
+    // Case insensitive match: `| 0x20` maps the letters to lowercase
+    uint64_t nameLength = 0;
+    for (; nameLength < lengthLeft; ++nameLength)
+    {
+        const uint8_t c = (uint8_t) array[nameLength] | 0x20;
+        if (c == ';')
+            break;
+
+        if (c < 'a' || c > 'z' || nameLength == htmlEntityMaxLength)
+            return nullptr;
+    }
+
+    if (nameLength == 0 || nameLength == lengthLeft)
+        return nullptr;
+
+    const uint32_t hash = hashHTMLEntity(htmlEntityTable.seed, (uint8_t) array[0] | 0x20, (uint8_t) array[nameLength - 1] | 0x20, nameLength);
+    const int8_t slot   = htmlEntityTable.slots[hash];
+    if (slot < 0 || htmlEntities[slot].length != nameLength)
+        return nullptr;
+
+    const HTMLEntity& entity = htmlEntities[slot];
+    for (uint64_t pos = 0; pos < nameLength; ++pos)
+    {
+        if (((uint8_t) array[pos] | 0x20) != (uint8_t) entity.name[pos])
+            return nullptr;
+    }
+
+    consumed = nameLength + 1;
+    return &entity;
+}
+
+// Parse the numeric reference at read, right after a `&#`. On success, read is moved past the digits
+static bool parseHTMLCodePoint(const char* array, uint64_t length, uint64_t& read, uint32_t& codePoint)
+{
+    uint32_t base = 10;
+    uint64_t pos  = read;
+
+    if (pos + 1 < length && (array[pos] | 0x20) == 'x' && htmlDigits.values[(uint8_t) array[pos + 1]] < 16)
+    {
+        base = 16;
+        pos += 1; // Skip the x
+    }
+    else if (pos >= length || htmlDigits.values[(uint8_t) array[pos]] >= 10)
+    {
+        return false;
+    }
+
+    //Compute the codepoint. We need to compute an arbitrary number of digits because browsers do too :(
+    codePoint = 0;
+    for (; pos < length; ++pos)
+    {
+        const uint8_t digit = htmlDigits.values[(uint8_t) array[pos]];
+        if (digit >= base)
+            break;
+
+        //Once out of range, the remaining digits are only skipped. We don't want to risk an overflow
+        if (codePoint <= 0x10ffff)
+            codePoint = codePoint * base + digit;
+    }
+
+    read = pos;
+    return true;
+}
+
 bool PWTransformer::transformDecodeHTML(ddwaf_object* parameter, bool readOnly)
 {
     return runTransform(
@@ -565,140 +744,59 @@ bool PWTransformer::transformDecodeHTML(ddwaf_object* parameter, bool readOnly)
             if (length < 3)
                 return readOnly ? 0 : length;
 
-            uint64_t read = 0;
-
             //There are three kinds of escape in HTML:
             //	&#XXXXX; where XX are numerical digits
             //	&#xYYY; or &#XYYY; where YYY is an hex-encoded codepoint
             //	&ZZZZ; where ZZZZ is an alphanumerical name for the character
-            // In practice, the semicolon is optional
-
-            if (readOnly)
-            {
-                // We're doing a quick sweep for the codepoints tags. They're easier to detect than character references
-                // This also let us avoid cluttering the main codepath
-                for (; read < length - 2; ++read)
-                {
-                    if (array[read] == '&' && array[read + 1] == '#')
-                    {
-                        if (array[read + 2] == 'x' || array[read + 2] == 'X')
-                        {
-                            if (read + 3 < length && isxdigit(array[read + 3]))
-                            {
-                                return true;
-                            }
-
-                            read += 1;
-                        }
-                        else if (isdigit(array[read + 2]))
-                        {
-                            return true;
-                        }
-
-                        read += 2;
-                    }
-                }
-            }
-
-            // We skip ahead looking for a `&`. That's not enough to know for sure if we need to edit but it's a decent shortcut nonetheless
-            for (read = 0; read < length && array[read] != '&'; ++read)
-                ;
+            // In practice, the semicolon is optional for the codepoints
 
+            // Everything but the references is left as is, so we jump from `&` to `&`
+            uint64_t read  = ddwaf::simd::find_byte(array, length, '&');
             uint64_t write = read;
 
             while (read < length)
             {
-                if (array[read] != '&' || read == length - 1)
+                if (array[read] != '&')
                 {
-                    array[write++] = array[read++];
+                    const uint64_t next = read + ddwaf::simd::find_byte(array + read, length - read, '&');
+                    if (!readOnly && write != read)
+                        memmove(array + write, array + read, next - read);
+
+                    write += next - read;
+                    read = next;
                     continue;
                 }
 
-                read += 1; // Skip the &
+                uint64_t end = read + 2;
+                uint32_t codePoint;
+                uint64_t consumed;
+
                 //Codepoint
-                if (array[read] == '#')
+                if (read + 1 < length && array[read + 1] == '#' && parseHTMLCodePoint(array, length, end, codePoint))
                 {
-                    read += 1; // Skip the #
-
-                    uint32_t codePoint = 0;
-
-                    // Hexadecimal codepoint
-                    if (read < length - 1 && (array[read] == 'x' || array[read] == 'X') && isxdigit(array[read + 1]))
-                    {
-                        read += 1; // Skip the x
-
-                        //Compute the codepoint. We need to compute an arbitrary number of hex chars because browsers do too :(
-                        while (read < length && isxdigit(array[read]))
-                        {
-                            codePoint <<= 4;
-                            codePoint |= fromHex(array[read++]);
-
-                            //If we go out of range, move the read head to the end and abort immediately. We don't want to risk an overflow
-                            if (codePoint > 0x10ffff)
-                            {
-                                for (; read < length && isxdigit(array[read]); read += 1) {}
-                            }
-                        }
-                    }
-                    // Numeric codepoint
-                    else if (read < length && isdigit(array[read]))
-                    {
-                        //Compute the codepoint. We need to compute an arbitrary number of digits because browsers do too :(
-                        while (read < length && isdigit(array[read]))
-                        {
-                            codePoint *= 10;
-                            codePoint += (uint32_t) array[read++] - '0';
-
-                            //If we go out of range, move the read head to the end and abort immediately. We don't want to risk an overflow
-                            if (codePoint > 0x10ffff)
-                            {
-                                for (; read < length && isdigit(array[read]); read += 1) {}
-                            }
-                        }
-                    }
-                    // Accidental match
-                    else
-                    {
-                        array[write++] = '&';
-                        array[write++] = '#';
-                        continue;
-                    }
-
-                    //We extracted the codepoint (or bailed out). Now, we can transcribe it
-                    write += writeCodePoint(codePoint, &array[write], read - write);
+                    if (readOnly)
+                        return true;
 
-                    if (read < length && array[read] == ';')
-                        read += 1;
+                    write += writeCodePoint(codePoint, &array[write], end - write);
+                    read = end < length && array[end] == ';' ? end + 1 : end;
                 }
                 // Named character references
-                else if (isalnum(array[read]))
+                else if (const HTMLEntity* entity = matchHTMLEntity(&array[read + 1], length - read - 1, consumed))
                 {
-                    const uint64_t lengthLeft = length - read;
-                    const char oldWriteChar   = array[write];
-
-                    // Try to decode a few known references
-                    if (!replaceIfMatch(array, read, write, lengthLeft, "lt;", 3, '<')
-                        && !replaceIfMatch(array, read, write, lengthLeft, "gt;", 3, '>')
-                        && !replaceIfMatch(array, read, write, lengthLeft, "amp;", 4, '&')
-                        && !replaceIfMatch(array, read, write, lengthLeft, "quot;", 5, '"')
-                        && !replaceIfMatch(array, read, write, lengthLeft, "nbsp;", 5, (char) 160))
-                    {
-                        //If none work, write the & we skipped
-                        array[write++] = '&';
-                    }
-                    // If this is a read only check, we covered the codepoint path but not this one!
-                    else if (readOnly)
-                    {
-                        // If we're here, one `replaceIfMatch` worked and replaced a character from the original input.
-                        // We're not supposed to modify anything in the readOnly loop, but this avoid duplicating a lot of code
-                        // Instead, we're just hidding our mistake
-                        array[--write] = oldWriteChar;
+                    if (readOnly)
                         return true;
-                    }
+
+                    array[write++] = entity->decoded;
+                    read += 1 + consumed;
                 }
+                // Not a reference after all, the `&` is kept
                 else
                 {
-                    array[write++] = '&';
+                    if (!readOnly)
+                        array[write] = '&';
+
+                    write += 1;
+                    read += 1;
                 }
             }
 
@@ -725,29 +823,27 @@ bool PWTransformer::transformDecodeBase64RFC4648(ddwaf_object* parameter, bool r
             if (!readOnly)
                 return decodeBase64(array, length);
 
-            // All characters must be valid
-            for (uint64_t pos = 0; pos < length; ++pos)
+            // All characters must be valid, we jump from one invalid character to the next
+            for (uint64_t pos = ddwaf::simd::find_set(array, length, nonBase64); pos < length;
+                 pos += 1 + ddwaf::simd::find_set(array + pos + 1, length - pos - 1, nonBase64))
             {
-                if (!isalnum(array[pos]) && array[pos] != '+' && array[pos] != '/')
+                // If it's not a valid base64, it must be the trailing =
+                if (array[pos] == '=')
                 {
-                    // If it's not a valid base64, it must be the trailing =
-                    if (array[pos] == '=')
+                    uint64_t equalCount = 0;
+                    while (pos + equalCount < length && array[pos + equalCount] == '=')
                     {
-                        uint64_t equalCount = 0;
-                        while (pos + equalCount < length && array[pos + equalCount] == '=')
-                        {
-                            equalCount += 1;
-                        }
-
-                        // The = must go to the end, and there musn't be too many
-                        const uint64_t maxPaddingNeeded = 4 - (pos % 4);
-                        if (pos + equalCount == length && equalCount <= 3 && equalCount <= maxPaddingNeeded)
-                            continue;
+                        equalCount += 1;
                     }
 
-                    // Anything wrong -> nope
-                    return false;
+                    // The = must go to the end, and there musn't be too many
+                    const uint64_t maxPaddingNeeded = 4 - (pos % 4);
+                    if (pos + equalCount == length && equalCount <= 3 && equalCount <= maxPaddingNeeded)
+                        continue;
                 }
+
+                // Anything wrong -> nope
+                return false;
             }
 
             return true;
@@ -765,37 +861,34 @@ bool PWTransformer::transformDecodeBase64RFC2045(ddwaf_object* parameter, bool r
             uint64_t validChars = 0;
             for (uint64_t pos = 0; pos < length; ++pos)
             {
-                // Something outside the valid range?
-                if (!isalnum(array[pos]) && array[pos] != '+' && array[pos] != '/')
+                // We want to make sure there is at least something to decode, the valid characters up to
+                // the next one outside the valid range are counted in one go
+                const uint64_t next = pos + ddwaf::simd::find_set(array + pos, length - pos, nonBase64);
+                validChars += next - pos;
+                pos = next;
+
+                // Let's count the equals
+                if (pos < length && array[pos] == '=')
                 {
-                    // Let's count the equals
-                    if (array[pos] == '=')
+                    uint64_t equalCount = 0;
+                    while (pos + equalCount < length && array[pos + equalCount] == '=')
                     {
-                        uint64_t equalCount = 0;
-                        while (pos + equalCount < length && array[pos + equalCount] == '=')
-                        {
-                            equalCount += 1;
-                        }
+                        equalCount += 1;
+                    }
 
-                        // If that's the final padding, we need to make sure there is enough of it. Otherwise we ignore it
-                        if (pos + equalCount == length)
-                        {
-                            const uint64_t minPaddingNeeded = 4 - (validChars % 4);
-                            if (minPaddingNeeded == 4 || minPaddingNeeded <= equalCount)
-                                validChars += equalCount;
+                    // If that's the final padding, we need to make sure there is enough of it. Otherwise we ignore it
+                    if (pos + equalCount == length)
+                    {
+                        const uint64_t minPaddingNeeded = 4 - (validChars % 4);
+                        if (minPaddingNeeded == 4 || minPaddingNeeded <= equalCount)
+                            validChars += equalCount;
 
-                            break;
-                        }
-                        else
-                        {
-                            pos += equalCount - 1;
-                        }
+                        break;
+                    }
+                    else
+                    {
+                        pos += equalCount - 1;
                     }
-                }
-                else
-                {
-                    // We want to make sure there is at least something to decode
-                    validChars += 1;
                 }
             }
 
@@ -839,22 +932,9 @@ bool PWTransformer::transformEncodeBase64(ddwaf_object* parameter, bool readOnly
         '4', '5', '6', '7', '8', '9', '+', '-'
     };
 
-    uint64_t read = 0, write = 0;
-
-    for (; read + 2 < originalLength; read += 3)
-    {
-        const uint8_t quartet[4] = {
-            oldString[read] >> 2,
-            (oldString[read] & 0x3) << 4 | (oldString[read + 1] >> 4),
-            (oldString[read + 1] & 0xf) << 2 | oldString[read + 2] >> 6,
-            oldString[read + 2] & 0x3f
-        };
-
-        newString[write++] = b64Encoding[quartet[0]];
-        newString[write++] = b64Encoding[quartet[1]];
-        newString[write++] = b64Encoding[quartet[2]];
-        newString[write++] = b64Encoding[quartet[3]];
-    }
+    // The whole triplets are encoded by blocks, at most two bytes are left
+    uint64_t read  = ddwaf::simd::base64_encode(reinterpret_cast<const char*>(oldString), (size_t) originalLength, newString);
+    uint64_t write = read / 3 * 4;
 
     if (read != originalLength)
     {
@@ -1300,6 +1380,21 @@ bool PWTransformer::transformURLQueryString(ddwaf_object* parameter, bool readOn
 }
 
 // If the transformer is called with readOnly, it needs to return
+bool PWTransformer::transformsInPlace(PW_TRANSFORM_ID transformID)
+{
+    switch (transformID)
+    {
+        // Those free the string to replace it
+        case PWT_LENGTH:
+        case PWT_ENCODE_BASE64:
+        case PWT_NUMERIZE:
+            return false;
+
+        default:
+            return true;
+    }
+}
+
 bool PWTransformer::transform(PW_TRANSFORM_ID transformID, ddwaf_object* parameter, bool readOnly)
 {
     switch (transformID)
@@ -1424,11 +1519,87 @@ PW_TRANSFORM_ID PWTransformer::getIDForString(std::string_view str)
     return PWT_INVALID;
 }
 
+bool PWTransformer::triggerBytes(PW_TRANSFORM_ID transformID, ddwaf::simd::byte_set& triggers)
+{
+    using ddwaf::simd::byte_set;
+
+    static constexpr byte_set uppercase   = byte_set().with_range('A', 'Z');
+    static constexpr byte_set nulls       = byte_set().with((uint8_t) 0);
+    static constexpr byte_set spaces      = byte_set().with(" ");
+    static constexpr byte_set dots        = byte_set().with(".");
+    static constexpr byte_set windowsPath = byte_set().with(".\\");
+    static constexpr byte_set urlEscapes  = byte_set().with("%+");
+    static constexpr byte_set backslashes = byte_set().with("\\");
+    static constexpr byte_set ampersands  = byte_set().with("&");
+    static constexpr byte_set comments    = byte_set().with("<-#/");
+    // Any space as per isspace, the separators and the characters removed or lowercased
+    static constexpr byte_set cmdLine = byte_set().with(" \t\n\v\f\r,;\\\"'^").with_range('A', 'Z');
+
+    switch (transformID)
+    {
+        case PWT_LOWERCASE:
+            triggers = uppercase;
+            return true;
+        case PWT_NONULL:
+            triggers = nulls;
+            return true;
+        case PWT_COMPRESS_WHITE:
+            triggers = spaces;
+            return true;
+        case PWT_NORMALIZE:
+            triggers = dots;
+            return true;
+        case PWT_NORMALIZE_WIN:
+            triggers = windowsPath;
+            return true;
+        case PWT_DECODE_URL:
+        case PWT_DECODE_URL_IIS:
+            triggers = urlEscapes;
+            return true;
+        case PWT_DECODE_CSS:
+        case PWT_DECODE_JS:
+            triggers = backslashes;
+            return true;
+        case PWT_DECODE_HTML:
+            triggers = ampersands;
+            return true;
+        case PWT_CMDLINE:
+            triggers = cmdLine;
+            return true;
+        case PWT_REMOVE_COMMENTS:
+            triggers = comments;
+            return true;
+
+        // Those may change strings made of any byte
+        default:
+            return false;
+    }
+}
+
 bool PWTransformer::doesNeedTransform(const std::vector<PW_TRANSFORM_ID>& transformIDs, ddwaf_object* parameter)
 {
     if (parameter == NULL)
         return false;
 
+    // A single classification pass tells whether any transformer of the chain has something to act on
+    if (parameter->type == DDWAF_OBJ_STRING && parameter->stringValue != NULL)
+    {
+        ddwaf::simd::byte_set triggers, chainTriggers;
+        bool bounded = true;
+        for (const PW_TRANSFORM_ID& transformID : transformIDs)
+        {
+            if (!triggerBytes(transformID, triggers))
+            {
+                bounded = false;
+                break;
+            }
+            chainTriggers = chainTriggers.merge(triggers);
+        }
+
+        if (bounded && ddwaf::simd::find_set(parameter->stringValue, parameter->nbEntries, chainTriggers) == parameter->nbEntries)
+            return false;
+    }
+
     for (const PW_TRANSFORM_ID& transformID : transformIDs)
     {
         if (transform(transformID, parameter, true))
@@ -1520,23 +1691,6 @@ static uint8_t writeCodePoint(uint32_t codepoint, char* utf8_buffer, uint64_t le
     return codepointToUTF8(codepoint, utf8_buffer);
 }
 
-static bool replaceIfMatch(char* array, uint64_t& readHead, uint64_t& writeHead, uint64_t readLengthLeft, const char* token, uint32_t tokenLength, char decodedToken)
-{
-    if (readLengthLeft < tokenLength)
-        return false;
-
-    // Case incensitive match (assume the token is lowercase)
-    for (uint32_t pos = 0; pos < tokenLength; ++pos)
-    {
-        if ((array[readHead + pos] | 0x20) != *token++)
-            return false;
-    }
-
-    array[writeHead++] = decodedToken;
-    readHead += tokenLength;
-    return true;
-}
-
 static bool decodeBase64(char* array, uint64_t& length)
 {
     /*
@@ -1566,6 +1720,12 @@ static bool decodeBase64(char* array, uint64_t& length)
 
     while (read < length)
     {
+        // Runs of valid characters are decoded by blocks, only the quartets with
+        // something to skip or the final padding go through the loop below
+        size_t consumed;
+        write += ddwaf::simd::base64_decode(array + read, (size_t) (length - read), array + write, consumed);
+        read += consumed;
+
         // Read the next 4 b64 bytes
         char quartet[4] = { 0 };
         uint8_t pos     = 0;
@@ -7,9 +7,11 @@
 #ifndef IPWRuleTransformer_h
 #define IPWRuleTransformer_h
 
-#include <functional>
+#include <string_view>
+#include <vector>
 
 #include <ddwaf.h>
+#include <simd.hpp>
 
 enum PW_TRANSFORM_ID
 {
@@ -45,8 +47,9 @@ enum PW_TRANSFORM_ID
 
 class PWTransformer
 {
-    using transformer = bool(char*, uint64_t&, bool);
-    static bool runTransform(ddwaf_object* parameter, const std::function<transformer>& transformer, bool readOnly);
+    // The transformer is called as bool(char* array, uint64_t& length, bool readOnly)
+    template <typename Transformer>
+    static bool runTransform(ddwaf_object* parameter, Transformer&& transformer, bool readOnly);
     static bool transformLowerCase(ddwaf_object* parameter, bool readOnly);
     static bool transformNoNull(ddwaf_object* parameter, bool readOnly);
     static bool transformCompressWhiteSpace(ddwaf_object* parameter, bool readOnly);
@@ -71,6 +74,11 @@ class PWTransformer
 public:
     static PW_TRANSFORM_ID getIDForString(std::string_view str);
     static bool transform(PW_TRANSFORM_ID transformID, ddwaf_object* parameter, bool readOnly = false);
+    // Whether the transformer works within the buffer of the string, which then doesn't have to come from malloc
+    static bool transformsInPlace(PW_TRANSFORM_ID transformID);
+    // Bytes the transformer acts on: if none of them is in the string, it's left unchanged.
+    // Return false if the transformer may change any string.
+    static bool triggerBytes(PW_TRANSFORM_ID transformID, ddwaf::simd::byte_set& triggers);
     static bool doesNeedTransform(const std::vector<PW_TRANSFORM_ID>& transformIDs, ddwaf_object* parameter);
 };
 #endif /* IPWRuleTransformer_h */
@@ -5,6 +5,11 @@
 // Copyright 2021 Datadog, Inc.
 
 #include <algorithm>
+#include <cinttypes>
+#include <map>
+#include <memory>
+#include <set>
+#include <tuple>
 #include <unordered_map>
 
 #include "Clock.hpp"
@@ -24,12 +29,237 @@
 using namespace ddwaf;
 using namespace std::literals;
 
-PowerWAF::PowerWAF(PWManifest&& manifest_, rule_map&& rules_,
-                   flow_map&& flows_, const ddwaf_config* config)
+namespace
+{
+
+// Lower the parsed ruleset into its compiled form. Rules are moved into a
+// contiguous vector and each flow becomes a vector of indices into it, which
+// allows contexts to use dense caches rather than maps keyed by rule ID.
+void compile(rule_map& parsed_rules, flow_map& parsed_flows,
+             rule_vector& rules, flow_vector& flows)
+{
+    rules.reserve(parsed_rules.size());
+    flows.reserve(parsed_flows.size());
+
+    for (auto& [name, ids] : parsed_flows)
+    {
+        std::vector<rule_index> indices;
+        indices.reserve(ids.size());
+
+        for (const std::string& id : ids)
+        {
+            auto node = parsed_rules.extract(id);
+            if (node.empty())
+            {
+                // This shouldn't happen, a rule belongs to exactly one flow
+                DDWAF_ERROR("Invalid rule (%s) in flow (%s), this is a bug",
+                            id.c_str(), name.c_str());
+                continue;
+            }
+
+            node.mapped().id = std::move(node.key());
+            indices.push_back(static_cast<rule_index>(rules.size()));
+            rules.emplace_back(std::move(node.mapped()));
+        }
+
+        flows.emplace_back(name, std::move(indices));
+    }
+}
+
+// Give each distinct transformer chain an identifier, allowing contexts to
+// share the output of a chain between the conditions using it. The chains are
+// compiled once into a trie so that shared prefixes are only applied once.
+void assign_transformer_chains(rule_vector& rules)
+{
+    std::set<std::vector<PW_TRANSFORM_ID>> chains;
+    for (rule& rule : rules)
+    {
+        for (condition& cond : rule.conditions)
+        {
+            const auto& transformers = cond.getTransformers();
+            if (transformers.empty())
+                continue;
+
+            chains.insert(transformers);
+
+            // Every intermediary representation is matched, so every prefix needs a node
+            if (cond.getMatchInterTransformer())
+            {
+                for (auto end = transformers.begin() + 1; end < transformers.end(); ++end)
+                    chains.emplace(transformers.begin(), end);
+            }
+        }
+    }
+
+    auto trie = std::make_shared<const transformer_trie>(std::vector<std::vector<PW_TRANSFORM_ID>>(chains.begin(), chains.end()));
+    for (rule& rule : rules)
+    {
+        for (condition& cond : rule.conditions)
+        {
+            if (!cond.getTransformers().empty())
+                cond.setTransformerChain(trie, trie->find(cond.getTransformers()));
+        }
+    }
+}
+
+// Conditions using the same processor type and sharing their targets,
+// transformers and processor specific discriminant are fed the same inputs.
+using group_key = std::tuple<std::vector<PWManifest::ARG_ID>, std::vector<PW_TRANSFORM_ID>, bool>;
+
+template <typename T, typename Discriminant>
+std::map<group_key, std::vector<T*>> group_conditions(rule_vector& rules, Discriminant&& discriminant)
+{
+    std::map<group_key, std::vector<T*>> groups;
+    for (rule& rule : rules)
+    {
+        for (condition& cond : rule.conditions)
+        {
+            auto* processor = dynamic_cast<T*>(&cond.getProcessor());
+            if (processor != nullptr)
+            {
+                groups[{ cond.getTargets(), cond.getTransformers(), discriminant(*processor) }].push_back(processor);
+            }
+        }
+    }
+
+    return groups;
+}
+
+// Combine the lists of such phrase matches in a single automaton so that each
+// input is only scanned once regardless of the number of lists.
+void merge_phrase_matches(rule_vector& rules)
+{
+    auto groups = group_conditions<PerfMatch>(rules, [](const PerfMatch&) { return false; });
+    for (auto& [key, members] : groups)
+    {
+        if (members.size() < 2)
+            continue;
+
+        std::vector<const std::vector<std::string>*> lists;
+        lists.reserve(members.size());
+        for (const PerfMatch* member : members)
+        {
+            lists.push_back(&member->getPatterns());
+        }
+
+        auto group = std::make_shared<const PerfMatchGroup>(lists);
+        for (uint32_t i = 0; i < members.size(); ++i)
+        {
+            members[i]->joinGroup(group, i);
+        }
+
+        DDWAF_DEBUG("Merged %zu phrase_match conditions in an automaton of %u states",
+                    members.size(), group->stateCount());
+    }
+}
+
+// Prefilter such regular expressions, with the same case sensitivity, by the
+// literals they require or through a RE2::Set, so that only the candidates run
+// their capturing match.
+//
+// The memory budget, if any, covers the regular expressions, the copies held
+// by the prefilters and the sets. A regular expression running on its own gets
+// four shares of it. A grouped one, only running on the candidates of its
+// group, gets one share and adds another to the budget of the prefilter. The
+// regular expressions which don't fit in their share get the smallest budget
+// they compile in, the total is then reported.
+void merge_regex_matches(rule_vector& rules, uint64_t budget)
+{
+    auto groups = group_conditions<RE2Manager>(rules, [](const RE2Manager& processor) {
+        return processor.getRegex().options().case_sensitive();
+    });
+
+    uint64_t shares = 0;
+    for (const auto& [key, members] : groups)
+    {
+        shares += members.size() < 2 ? 4 : 2 * members.size();
+    }
+
+    const int64_t share = budget == 0 || shares == 0 ? 0 : (int64_t) std::clamp<uint64_t>(budget / shares, 1, INT64_MAX / 4);
+
+    uint64_t total = 0;
+    for (auto& [key, members] : groups)
+    {
+        if (members.size() < 2)
+        {
+            if (share != 0)
+                total += (uint64_t) members[0]->fitMaxMemory(4 * share);
+            continue;
+        }
+
+        std::vector<const re2::RE2*> regexes;
+        regexes.reserve(members.size());
+        for (RE2Manager* member : members)
+        {
+            if (share != 0)
+                total += (uint64_t) member->fitMaxMemory(share);
+            regexes.push_back(&member->getRegex());
+        }
+
+        try
+        {
+            auto group = std::make_shared<const RE2ManagerGroup>(regexes, std::get<2>(key), share * (int64_t) members.size());
+            for (uint32_t i = 0; i < members.size(); ++i)
+            {
+                members[i]->joinGroup(group, i);
+            }
+            total += (uint64_t) group->maxMemory();
+
+            DDWAF_DEBUG("Merged %zu match_regex conditions, %u prefiltered by %u atoms",
+                        members.size(), group->prefilteredCount(), group->atomCount());
+        }
+        catch (const std::exception& e)
+        {
+            // The conditions can still run on their own
+            DDWAF_WARN("%s", e.what());
+        }
+    }
+
+    if (total > budget && budget != 0)
+    {
+        DDWAF_WARN("The regular expressions need %" PRIu64 " bytes, over their budget of %" PRIu64 " bytes",
+                   total, budget);
+    }
+}
+
+// Build the DFA states of the regular expressions, and of the sets merging
+// them, that most requests go through rather than on the first requests.
+void warm_up_regexes(const rule_vector& rules)
+{
+    std::set<const RE2ManagerGroup*> groups;
+    for (const rule& rule : rules)
+    {
+        for (const condition& cond : rule.conditions)
+        {
+            const auto* processor = dynamic_cast<const RE2Manager*>(&cond.getProcessor());
+            if (processor == nullptr)
+                continue;
+
+            processor->warmUp();
+            if (processor->getGroup() != nullptr && groups.insert(processor->getGroup().get()).second)
+            {
+                processor->getGroup()->warmUp();
+            }
+        }
+    }
+}
+
+}
+
+PowerWAF::PowerWAF(PWManifest&& manifest_, rule_vector&& rules_,
+                   flow_vector&& flows_, const ddwaf_config* config,
+                   const ddwaf_options& options)
     : manifest(std::move(manifest_)),
       rules(std::move(rules_)),
       flows(std::move(flows_))
 {
+    targetIndex.build(rules, flows);
+
+    if (options.resultFormat == DDWAF_RESULT_OBJECT)
+    {
+        resultFormat = DDWAF_RESULT_OBJECT;
+    }
+
     if (config != nullptr)
     {
         if (config->maxArrayLength != 0)
@@ -47,19 +277,53 @@ PowerWAF::PowerWAF(PWManifest&& manifest_, rule_map&& rules_,
             maxTimeStore = config->maxTimeStore;
         }
     }
+
+    if (options.maxStringLength != 0)
+    {
+        maxStringLength = options.maxStringLength;
+        for (rule& rule : rules)
+        {
+            for (condition& cond : rule.conditions)
+            {
+                cond.getProcessor().setMaxStringLength(maxStringLength);
+            }
+        }
+    }
+
+    // The calling thread takes part in the evaluation, and a flow can't
+    // be split across threads
+    const size_t threads = std::min<size_t>(options.workerThreads, flows.size());
+    if (threads > 1)
+    {
+        workers = std::make_unique<ddwaf::worker_pool>(threads - 1);
+    }
 }
 
-PowerWAF* PowerWAF::fromConfig(const ddwaf_object ruleset, const ddwaf_config* config)
+PowerWAF* PowerWAF::fromConfig(const ddwaf_object ruleset, const ddwaf_config* config, const ddwaf_options& options)
 {
     PWManifest manifest;
-    rule_map rules;
-    flow_map flows;
+    rule_map parsed_rules;
+    flow_map parsed_flows;
 
     try
     {
-        parser::parse(ruleset, rules, manifest, flows);
+        parser::parse(ruleset, parsed_rules, manifest, parsed_flows);
+
+        rule_vector rules;
+        flow_vector flows;
+        compile(parsed_rules, parsed_flows, rules, flows);
+        assign_transformer_chains(rules);
+        merge_phrase_matches(rules);
+
+        merge_regex_matches(rules, options.maxRegexMemory);
+
+        if (options.warmUpRegexes)
+        {
+            warm_up_regexes(rules);
+        }
+
         return new PowerWAF(std::move(manifest), std::move(rules),
-                            std::move(flows), config);
+                            std::move(flows), config, options);
     }
     catch (const std::exception& e)
     {
@@ -68,3 +332,49 @@ PowerWAF* PowerWAF::fromConfig(const ddwaf_object ruleset, const ddwaf_config* c
 
     return nullptr;
 }
+
+uint64_t PowerWAF::regexMemory() const
+{
+    uint64_t memory = 0;
+    std::set<const RE2ManagerGroup*> groups;
+    for (const rule& rule : rules)
+    {
+        for (const condition& cond : rule.conditions)
+        {
+            const auto* processor = dynamic_cast<const RE2Manager*>(&cond.getProcessor());
+            if (processor == nullptr)
+                continue;
+
+            memory += (uint64_t) processor->getRegex().options().max_mem();
+            if (processor->getGroup() != nullptr && groups.insert(processor->getGroup().get()).second)
+            {
+                memory += (uint64_t) processor->getGroup()->maxMemory();
+            }
+        }
+    }
+
+    return memory;
+}
+
+uint64_t PowerWAF::regexFallbacks() const
+{
+    uint64_t fallbacks = 0;
+    std::set<const RE2ManagerGroup*> groups;
+    for (const rule& rule : rules)
+    {
+        for (const condition& cond : rule.conditions)
+        {
+            const auto* processor = dynamic_cast<const RE2Manager*>(&cond.getProcessor());
+            if (processor == nullptr)
+                continue;
+
+            fallbacks += processor->dfaFallbacks();
+            if (processor->getGroup() != nullptr && groups.insert(processor->getGroup().get()).second)
+            {
+                fallbacks += processor->getGroup()->dfaFallbacks();
+            }
+        }
+    }
+
+    return fallbacks;
+}
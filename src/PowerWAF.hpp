@@ -7,26 +7,42 @@
 #ifndef pw_hpp
 #define pw_hpp
 
+#include <memory>
+
 #include <PWManifest.h>
 #include <rule.hpp>
 #include <utils.h>
+#include <worker_pool.hpp>
 
 struct PowerWAF
 {
     uint64_t maxMapDepth { DDWAF_MAX_MAP_DEPTH };
     uint64_t maxArrayLength { DDWAF_MAX_ARRAY_LENGTH };
+    uint64_t maxStringLength { DDWAF_MAX_STRING_LENGTH };
 
     // Maximum number of rules to report the time for
     uint32_t maxTimeStore { TIME_STORE_DEFAULT };
 
+    DDWAF_RESULT_FORMAT resultFormat { DDWAF_RESULT_JSON };
+
     PWManifest manifest;
-    ddwaf::rule_map rules;
-    ddwaf::flow_map flows;
+    ddwaf::rule_vector rules;
+    ddwaf::flow_vector flows;
+    ddwaf::target_index targetIndex;
+
+    // Only set if the flows of a run are evaluated in parallel
+    std::unique_ptr<ddwaf::worker_pool> workers;
+
+    PowerWAF(PWManifest&& manifest_, ddwaf::rule_vector&& rules_,
+             ddwaf::flow_vector&& flows_, const ddwaf_config* config,
+             const ddwaf_options& options);
 
-    PowerWAF(PWManifest&& manifest_, ddwaf::rule_map&& rules_,
-             ddwaf::flow_map&& flows_, const ddwaf_config* config);
+    static PowerWAF* fromConfig(const ddwaf_object rules, const ddwaf_config* config, const ddwaf_options& options);
 
-    static PowerWAF* fromConfig(const ddwaf_object rules, const ddwaf_config* config);
+    // Regular expression searches which ran out of DFA memory since the init
+    uint64_t regexFallbacks() const;
+    // Memory budget of the regular expressions, their prefilters and sets included
+    uint64_t regexMemory() const;
 
     static constexpr ddwaf_version waf_version { 1, 0, 14 };
 };
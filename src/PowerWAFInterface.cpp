@@ -4,6 +4,8 @@
 // This product includes software developed at Datadog (https://www.datadoghq.com/).
 // Copyright 2021 Datadog, Inc.
 
+#include <algorithm>
+#include <cstring>
 #include <memory>
 #include <mutex>
 #include <shared_mutex>
@@ -43,16 +45,82 @@ const char* log_level_to_str(DDWAF_LOG_LEVEL level)
 }
 }
 #endif
+
+namespace
+{
+// The options past the size known by the caller keep their default
+ddwaf_options readOptions(const ddwaf_options* options)
+{
+    ddwaf_options output {};
+    if (options != nullptr)
+    {
+        memcpy(&output, options, std::min<size_t>(options->size, sizeof(output)));
+    }
+    output.size = sizeof(output);
+    return output;
+}
+
+DDWAF_RET_CODE runContext(ddwaf_context context, ddwaf_object* data, ddwaf_result* result, ddwaf_object* matches, uint64_t timeout)
+{
+    DDWAF_RET_CODE code = DDWAF_ERR_INTERNAL;
+    if (matches != nullptr)
+    {
+        ddwaf_object_invalid(matches);
+    }
+
+    try
+    {
+        ddwaf_result res;
+        if (context == nullptr || data == nullptr)
+        {
+            DDWAF_WARN("Illegal WAF call: context or data was null");
+            res = returnErrorCode(DDWAF_ERR_INVALID_ARGUMENT);
+        }
+        else
+        {
+            PWAdditive* additive = reinterpret_cast<PWAdditive*>(context);
+            res                  = additive->run(*data, timeout, matches);
+        }
+
+        code = res.action;
+        if (result != nullptr)
+        {
+            *result = res;
+        }
+        else
+        {
+            ddwaf_result_free(&res);
+        }
+    }
+    catch (const std::exception& e)
+    {
+        // catch-all to avoid std::terminate
+        DDWAF_ERROR("%s", e.what());
+    }
+    catch (...)
+    {
+        DDWAF_ERROR("unknown exception");
+    }
+
+    return code;
+}
+}
+
 // explicit instantiation declaration to suppress warning
 extern "C"
 {
     ddwaf_handle ddwaf_init(const ddwaf_object* rule, const ddwaf_config* config)
+    {
+        return ddwaf_init_with_options(rule, config, nullptr);
+    }
+
+    ddwaf_handle ddwaf_init_with_options(const ddwaf_object* rule, const ddwaf_config* config, const ddwaf_options* options)
     {
         try
         {
             if (rule != nullptr)
             {
-                PowerWAF* waf = PowerWAF::fromConfig(*rule, config);
+                PowerWAF* waf = PowerWAF::fromConfig(*rule, config, readOptions(options));
                 return reinterpret_cast<ddwaf_handle>(waf);
             }
         }
@@ -107,6 +175,16 @@ extern "C"
         return addresses.data();
     }
 
+    uint64_t ddwaf_regex_fallbacks(const ddwaf_handle handle)
+    {
+        if (handle == nullptr)
+        {
+            return 0;
+        }
+
+        return reinterpret_cast<PowerWAF*>(handle)->regexFallbacks();
+    }
+
     ddwaf_context ddwaf_context_init(const ddwaf_handle handle, ddwaf_object_free_fn obj_free)
     {
         ddwaf_context output = nullptr;
@@ -131,42 +209,83 @@ extern "C"
 
     DDWAF_RET_CODE ddwaf_run(ddwaf_context context, ddwaf_object* data, ddwaf_result* result, uint64_t timeout)
     {
-        DDWAF_RET_CODE code = DDWAF_ERR_INTERNAL;
-        try
+        return runContext(context, data, result, nullptr, timeout);
+    }
+
+    DDWAF_RET_CODE ddwaf_run_with_matches(ddwaf_context context, ddwaf_object* data, ddwaf_result* result, ddwaf_object* matches, uint64_t timeout)
+    {
+        return runContext(context, data, result, matches, timeout);
+    }
+
+    DDWAF_RET_CODE ddwaf_run_many(ddwaf_context* contexts, ddwaf_object* data, ddwaf_result* results, size_t count, uint64_t timeout)
+    {
+        if (contexts == nullptr || data == nullptr)
         {
-            ddwaf_result res;
-            if (context == nullptr || data == nullptr)
-            {
-                DDWAF_WARN("Illegal WAF call: context or data was null");
-                res = returnErrorCode(DDWAF_ERR_INVALID_ARGUMENT);
-            }
-            else
+            DDWAF_WARN("Illegal WAF call: contexts or data was null");
+            return DDWAF_ERR_INVALID_ARGUMENT;
+        }
+
+        // The errors are negative, the first one is reported over any match
+        DDWAF_RET_CODE worstCode = DDWAF_GOOD;
+        const auto recordItem    = [&](size_t i, ddwaf_result& res) {
+            if (worstCode >= DDWAF_GOOD && (res.action < DDWAF_GOOD || res.action > worstCode))
             {
-                PWAdditive* additive = reinterpret_cast<PWAdditive*>(context);
-                res                  = additive->run(*data, timeout);
+                worstCode = res.action;
             }
 
-            code = res.action;
-            if (result != nullptr)
+            if (results != nullptr)
             {
-                *result = res;
+                results[i] = res;
             }
             else
             {
                 ddwaf_result_free(&res);
             }
-        }
-        catch (const std::exception& e)
-        {
-            // catch-all to avoid std::terminate
-            DDWAF_ERROR("%s", e.what());
-        }
-        catch (...)
+        };
+
+        // The clock is read once between two items: the end of an item is the
+        // start of the next one. An item throwing is reported and skipped, the
+        // rest of the batch goes on from a new read of the clock.
+        SQPowerWAF::monotonic_clock::time_point now = SQPowerWAF::monotonic_clock::now();
+        size_t i                                    = 0;
+        while (i < count)
         {
-            DDWAF_ERROR("unknown exception");
+            try
+            {
+                for (; i < count; ++i)
+                {
+                    ddwaf_result res;
+                    if (contexts[i] == nullptr)
+                    {
+                        DDWAF_WARN("Illegal WAF call: context was null");
+                        res = returnErrorCode(DDWAF_ERR_INVALID_ARGUMENT);
+                    }
+                    else
+                    {
+                        PWAdditive* additive = reinterpret_cast<PWAdditive*>(contexts[i]);
+                        res                  = additive->run(data[i], timeout, nullptr, &now);
+                    }
+                    recordItem(i, res);
+                }
+            }
+            catch (const std::exception& e)
+            {
+                // catch-all to avoid std::terminate
+                DDWAF_ERROR("%s", e.what());
+                ddwaf_result res = returnErrorCode(DDWAF_ERR_INTERNAL);
+                recordItem(i++, res);
+                now = SQPowerWAF::monotonic_clock::now();
+            }
+            catch (...)
+            {
+                DDWAF_ERROR("unknown exception");
+                ddwaf_result res = returnErrorCode(DDWAF_ERR_INTERNAL);
+                recordItem(i++, res);
+                now = SQPowerWAF::monotonic_clock::now();
+            }
         }
 
-        return code;
+        return worstCode;
     }
 
     void ddwaf_context_destroy(ddwaf_context context)
@@ -0,0 +1,95 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+#include <arena.hpp>
+
+namespace ddwaf
+{
+
+namespace
+{
+// Blocks retained between runs are capped, a single huge request shouldn't
+// pin its memory for the lifetime of the context
+constexpr size_t maxRetainedSize = 1024 * 1024;
+
+std::atomic<uint64_t> generationCounter { 0 };
+}
+
+arena::arena(size_t initialSize) : currentGeneration(++generationCounter)
+{
+    grow(initialSize);
+}
+
+arena::~arena()
+{
+    for (const block& b : blocks)
+    {
+        free(b.data);
+    }
+}
+
+void arena::grow(size_t minimum)
+{
+    const size_t size = std::max(minimum, blocks.empty() ? 0 : blocks.back().size * 2);
+    char* data        = (char*) malloc(size);
+    if (data == nullptr)
+        throw std::bad_alloc();
+
+    blocks.push_back({ data, size });
+    offset = 0;
+    total.blocks += 1;
+}
+
+void* arena::allocate(size_t size, size_t alignment)
+{
+    size_t start = (offset + alignment - 1) & ~(alignment - 1);
+    if (start + size > blocks.back().size)
+    {
+        grow(size + alignment);
+        start = 0;
+    }
+
+    offset = start + size;
+    used += size;
+
+    total.allocations += 1;
+    total.bytes += size;
+
+    return blocks.back().data + start;
+}
+
+char* arena::copy(const char* str, size_t length)
+{
+    char* output = (char*) allocate(length + 1, 1);
+    memcpy(output, str, length);
+    output[length] = 0;
+    return output;
+}
+
+void arena::reset()
+{
+    if (blocks.size() > 1)
+    {
+        for (const block& b : blocks)
+        {
+            free(b.data);
+        }
+        blocks.clear();
+
+        grow(std::min(used, maxRetainedSize));
+    }
+
+    offset            = 0;
+    used              = 0;
+    currentGeneration = ++generationCounter;
+}
+
+}
@@ -0,0 +1,108 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace ddwaf
+{
+
+// Bump allocator backing the short-lived allocations of a context: copies of
+// the inputs to transform, strings and key paths of the match gatherers...
+// Nothing is freed individually, the memory is reclaimed when the arena is
+// reset at the beginning of each run.
+class arena
+{
+public:
+    struct counters
+    {
+        uint64_t allocations { 0 }; // Allocations served by the arena
+        uint64_t bytes { 0 };       // Bytes served by the arena
+        uint64_t blocks { 0 };      // Blocks requested to the system allocator
+    };
+
+    explicit arena(size_t initialSize = 4096);
+    ~arena();
+
+    arena(const arena&) = delete;
+    arena& operator=(const arena&) = delete;
+
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+    // Nul terminated copy of the string
+    char* copy(const char* str, size_t length);
+
+    // Forget every allocation. If the last run needed more than one block,
+    // they are replaced by a single one large enough for such a run.
+    void reset();
+
+    const counters& stats() const { return total; }
+    // Changes at each reset and is never shared with another arena: what is
+    // read during a run can be told apart from what was read during another
+    uint64_t generation() const { return currentGeneration; }
+
+protected:
+    struct block
+    {
+        char* data;
+        size_t size;
+    };
+
+    void grow(size_t minimum);
+
+    std::vector<block> blocks;
+    size_t offset { 0 }; // Within the last block
+    size_t used { 0 };   // Since the last reset
+    counters total;
+    uint64_t currentGeneration;
+};
+
+// Allocator for the standard containers, falling back to the global allocator
+// when no arena is provided.
+template <typename T>
+class arena_allocator
+{
+public:
+    using value_type = T;
+
+    arena_allocator() noexcept = default;
+    arena_allocator(arena* owner_) noexcept : owner(owner_) {}
+    template <typename U>
+    arena_allocator(const arena_allocator<U>& other) noexcept : owner(other.owner) {}
+
+    T* allocate(size_t n)
+    {
+        if (owner == nullptr)
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        return static_cast<T*>(owner->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, size_t) noexcept
+    {
+        if (owner == nullptr)
+            ::operator delete(p);
+    }
+
+    template <typename U>
+    bool operator==(const arena_allocator<U>& other) const noexcept { return owner == other.owner; }
+    template <typename U>
+    bool operator!=(const arena_allocator<U>& other) const noexcept { return owner != other.owner; }
+
+    arena* owner { nullptr };
+};
+
+using arena_string = std::basic_string<char, std::char_traits<char>, arena_allocator<char>>;
+template <typename T>
+using arena_vector = std::vector<T, arena_allocator<T>>;
+
+}
+
+#endif /* ARENA_H */
@@ -0,0 +1,363 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include <algorithm>
+#include <limits>
+
+#include <ip_set.hpp>
+
+namespace ddwaf
+{
+
+namespace
+{
+
+constexpr uint64_t allOnes = std::numeric_limits<uint64_t>::max();
+
+// Bounds of ::ffff:0:0/96
+constexpr ip_address firstMappedIPv4 { 0, 0xffff00000000 };
+constexpr ip_address lastMappedIPv4 { 0, 0xffffffffffff };
+
+// Most buckets in the lookup tables, 2^16 IPv4 buckets being 256KiB
+constexpr uint32_t maxBucketBits = 16;
+
+bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+int8_t fromHex(char c)
+{
+    if (isDigit(c))
+        return (int8_t) (c - '0');
+
+    c = (char) (c | 0x20);
+    if (c >= 'a' && c <= 'f')
+        return (int8_t) (c - 'a' + 0xa);
+
+    return -1;
+}
+
+// Four decimal parts of up to three digits, without leading zeros
+bool parseIPv4(std::string_view str, uint32_t& address)
+{
+    uint32_t value = 0;
+    uint32_t parts = 0;
+    size_t pos     = 0;
+    while (true)
+    {
+        uint32_t part   = 0;
+        uint32_t digits = 0;
+        for (; pos < str.size() && isDigit(str[pos]); ++pos)
+        {
+            if (digits == 3 || (digits == 1 && part == 0))
+                return false;
+
+            part = part * 10 + (uint32_t) (str[pos] - '0');
+            ++digits;
+        }
+
+        if (digits == 0 || part > 255)
+            return false;
+
+        value = value << 8 | part;
+        if (++parts == 4 || pos == str.size() || str[pos] != '.')
+            break;
+        ++pos;
+    }
+
+    address = value;
+    return parts == 4 && pos == str.size();
+}
+
+// Up to eight groups of up to four hexadecimal digits, :: standing for the
+// missing groups, the last two groups being possibly written as an IPv4
+bool parseIPv6(std::string_view str, ip_address& address)
+{
+    uint16_t groups[8] = { 0 };
+    uint32_t count     = 0;
+    uint32_t gap       = 8;
+    size_t pos         = 0;
+
+    if (str.size() >= 2 && str[0] == ':' && str[1] == ':')
+    {
+        gap = 0;
+        pos = 2;
+    }
+
+    while (pos < str.size())
+    {
+        const size_t start = pos;
+        uint32_t value     = 0;
+        for (int8_t digit; pos < str.size() && (digit = fromHex(str[pos])) >= 0; ++pos)
+        {
+            if (pos - start == 4)
+                return false;
+            value = value << 4 | (uint32_t) digit;
+        }
+
+        if (pos == start)
+            return false;
+
+        if (pos < str.size() && str[pos] == '.')
+        {
+            uint32_t ipv4;
+            if (count > 6 || !parseIPv4(str.substr(start), ipv4))
+                return false;
+
+            groups[count++] = (uint16_t) (ipv4 >> 16);
+            groups[count++] = (uint16_t) ipv4;
+            break;
+        }
+
+        if (count == 8)
+            return false;
+        groups[count++] = (uint16_t) value;
+
+        if (pos == str.size())
+            break;
+
+        if (str[pos++] != ':' || pos == str.size())
+            return false;
+
+        if (str[pos] == ':')
+        {
+            if (gap != 8)
+                return false;
+            gap = count;
+            ++pos;
+        }
+    }
+
+    if (gap == 8 ? count != 8 : count > 7)
+        return false;
+
+    // Move the groups following :: to the end
+    if (gap != 8)
+    {
+        const uint32_t missing = 8 - count;
+        for (uint32_t i = count; i-- > gap;)
+        {
+            groups[i + missing] = groups[i];
+            groups[i]           = 0;
+        }
+    }
+
+    address.hi = 0;
+    address.lo = 0;
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        address.hi = address.hi << 16 | groups[i];
+        address.lo = address.lo << 16 | groups[i + 4];
+    }
+
+    return true;
+}
+
+ip_address successor(const ip_address& address)
+{
+    return { address.lo == allOnes ? address.hi + 1 : address.hi, address.lo + 1 };
+}
+
+// Leading 64 bits of the key
+uint64_t head(uint32_t key)
+{
+    return (uint64_t) key << 32;
+}
+
+uint64_t head(const ip_address& key)
+{
+    return key.hi;
+}
+
+constexpr uint32_t headBits(uint32_t)
+{
+    return 32;
+}
+
+constexpr uint32_t headBits(const ip_address&)
+{
+    return 64;
+}
+
+}
+
+bool parse_ip(std::string_view str, ip_address& address)
+{
+    if (str.find(':') != std::string_view::npos)
+        return parseIPv6(str, address);
+
+    uint32_t ipv4;
+    if (!parseIPv4(str, ipv4))
+        return false;
+
+    address = { firstMappedIPv4.hi, firstMappedIPv4.lo | ipv4 };
+    return true;
+}
+
+bool parse_cidr(std::string_view str, ip_address& first, ip_address& last)
+{
+    const size_t slash        = str.find('/');
+    const std::string_view ip = str.substr(0, slash);
+    if (!parse_ip(ip, first))
+        return false;
+
+    uint32_t prefix = 128;
+    if (slash != std::string_view::npos)
+    {
+        const std::string_view digits = str.substr(slash + 1);
+        if (digits.empty() || digits.size() > 3)
+            return false;
+
+        uint32_t length = 0;
+        for (char c : digits)
+        {
+            if (!isDigit(c))
+                return false;
+            length = length * 10 + (uint32_t) (c - '0');
+        }
+
+        // The prefix of an IPv4 network applies to the mapped address
+        const bool isIPv4 = ip.find(':') == std::string_view::npos;
+        if (length > (isIPv4 ? 32 : 128))
+            return false;
+
+        prefix = isIPv4 ? length + 96 : length;
+    }
+
+    const uint64_t hiMask = prefix >= 64 ? allOnes : (prefix == 0 ? 0 : allOnes << (64 - prefix));
+    const uint64_t loMask = prefix <= 64 ? 0 : (prefix == 128 ? allOnes : allOnes << (128 - prefix));
+
+    first.hi &= hiMask;
+    first.lo &= loMask;
+    last = { first.hi | ~hiMask, first.lo | ~loMask };
+    return true;
+}
+
+template <typename Key>
+void ip_set::range_table<Key>::build(const std::vector<std::pair<Key, Key>>& ranges)
+{
+    starts.clear();
+    ends.clear();
+    starts.reserve(ranges.size());
+    ends.reserve(ranges.size());
+    for (const auto& [first, last] : ranges)
+    {
+        starts.push_back(first);
+        ends.push_back(last);
+    }
+
+    skip = bits = 0;
+    index.clear();
+    if (ranges.empty())
+        return;
+
+    // Every key between the first and the last range shares their leading
+    // bits, the buckets are indexed by the following ones
+    const uint64_t common = head(starts.front()) ^ head(ends.back());
+    while (skip < headBits(Key()) && (common >> (63 - skip) & 1) == 0)
+    {
+        ++skip;
+    }
+
+    while (bits < maxBucketBits && bits + skip < headBits(Key()) && (size_t(1) << bits) < ranges.size())
+    {
+        ++bits;
+    }
+
+    index.assign((size_t(1) << bits) + 1, 0);
+    for (const Key& end : ends)
+    {
+        index[bucket(end) + 1] += 1;
+    }
+
+    for (size_t i = 1; i < index.size(); ++i)
+    {
+        index[i] += index[i - 1];
+    }
+}
+
+template <typename Key>
+uint32_t ip_set::range_table<Key>::bucket(const Key& key) const
+{
+    if (bits == 0)
+        return 0;
+    return (uint32_t) ((head(key) << skip) >> (64 - bits));
+}
+
+template <typename Key>
+bool ip_set::range_table<Key>::contains(const Key& key) const
+{
+    if (ends.empty() || key < starts.front() || ends.back() < key)
+        return false;
+
+    // The first range ending at or after the key is in the bucket, or is the
+    // first one of the next bucket
+    const uint32_t current = bucket(key);
+    const auto first       = ends.begin() + index[current];
+    const auto last        = ends.begin() + std::min<size_t>(index[current + 1] + 1, ends.size());
+
+    const auto it = std::lower_bound(first, last, key);
+    return starts[(size_t) (it - ends.begin())] <= key;
+}
+
+ip_set::ip_set(const std::vector<std::string_view>& networks)
+{
+    std::vector<std::pair<ip_address, ip_address>> ranges;
+    ranges.reserve(networks.size());
+    for (std::string_view network : networks)
+    {
+        ip_address first, last;
+        if (!parse_cidr(network, first, last))
+        {
+            ++invalidCount;
+            continue;
+        }
+        ranges.emplace_back(first, last);
+    }
+
+    std::sort(ranges.begin(), ranges.end());
+
+    // Merge the overlapping and adjacent ranges
+    std::vector<std::pair<ip_address, ip_address>> merged;
+    for (const auto& range : ranges)
+    {
+        if (!merged.empty() && (range.first <= merged.back().second || range.first == successor(merged.back().second)))
+        {
+            merged.back().second = std::max(merged.back().second, range.second);
+            continue;
+        }
+        merged.push_back(range);
+    }
+
+    // IPv4 addresses are looked up among the mapped part of the ranges
+    std::vector<std::pair<uint32_t, uint32_t>> mapped;
+    for (const auto& [first, last] : merged)
+    {
+        if (last < firstMappedIPv4 || lastMappedIPv4 < first)
+            continue;
+
+        mapped.emplace_back((uint32_t) std::max(first, firstMappedIPv4).lo, (uint32_t) std::min(last, lastMappedIPv4).lo);
+    }
+
+    ipv4.build(mapped);
+    ipv6.build(merged);
+}
+
+bool ip_set::contains(std::string_view ip) const
+{
+    ip_address address;
+    return parse_ip(ip, address) && contains(address);
+}
+
+bool ip_set::contains(const ip_address& address) const
+{
+    if (address.isMappedIPv4())
+        return ipv4.contains((uint32_t) address.lo);
+    return ipv6.contains(address);
+}
+
+}
@@ -0,0 +1,89 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#ifndef IP_SET_H
+#define IP_SET_H
+
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace ddwaf
+{
+
+// IPv6 address, IPv4 being mapped in ::ffff:0:0/96
+struct ip_address
+{
+    uint64_t hi { 0 };
+    uint64_t lo { 0 };
+
+    bool isMappedIPv4() const { return hi == 0 && (lo >> 32) == 0xffff; }
+
+    bool operator==(const ip_address& other) const { return hi == other.hi && lo == other.lo; }
+    bool operator<(const ip_address& other) const { return hi < other.hi || (hi == other.hi && lo < other.lo); }
+    bool operator<=(const ip_address& other) const { return !(other < *this); }
+};
+
+// Same syntax as inet_pton, IPv4 addresses being mapped to IPv6
+bool parse_ip(std::string_view str, ip_address& address);
+// An address, or a network written as address/prefix length, as the range
+// [first, last] of addresses it covers
+bool parse_cidr(std::string_view str, ip_address& first, ip_address& last);
+
+// Set of IPv4 and IPv6 networks, flattened into sorted disjoint ranges.
+//
+// A lookup is a binary search over the ends of the ranges, narrowed down by a
+// table indexed by the leading bits of the address. The table has about one
+// bucket per range, so that a lookup only touches a couple of cache lines
+// regardless of the number of networks. IPv4 addresses, which make most of
+// the lists, have their own ranges of 32-bit keys.
+class ip_set
+{
+public:
+    ip_set() = default;
+    // Entries which aren't valid addresses or networks are skipped
+    explicit ip_set(const std::vector<std::string_view>& networks);
+
+    bool contains(std::string_view ip) const;
+    bool contains(const ip_address& address) const;
+
+    // Number of disjoint ranges
+    size_t size() const { return ipv6.size(); }
+    // Number of networks skipped
+    size_t invalid() const { return invalidCount; }
+
+protected:
+    template <typename Key>
+    class range_table
+    {
+    public:
+        // The ranges are sorted and disjoint
+        void build(const std::vector<std::pair<Key, Key>>& ranges);
+        bool contains(const Key& key) const;
+        size_t size() const { return ends.size(); }
+
+    protected:
+        uint32_t bucket(const Key& key) const;
+
+        std::vector<Key> starts;
+        std::vector<Key> ends;
+        // Leading bits common to every range, and bits indexing the buckets
+        uint32_t skip { 0 };
+        uint32_t bits { 0 };
+        // Ranges ending before the bucket i: the range containing a key of
+        // the bucket i, if any, is in [index[i], index[i + 1]]
+        std::vector<uint32_t> index;
+    };
+
+    range_table<uint32_t> ipv4;
+    range_table<ip_address> ipv6;
+    size_t invalidCount { 0 };
+};
+
+}
+
+#endif /* IP_SET_H */
@@ -21,6 +21,23 @@ using ddwaf::parser::at;
 namespace
 {
 
+// Strings are compared bytewise, integers on their value
+template <typename T>
+std::unique_ptr<IPWRuleProcessor> parseCompare(const parameter& value)
+{
+    switch (value.type)
+    {
+        case DDWAF_OBJ_STRING:
+            return std::make_unique<T>(std::string_view(value.stringValue, value.nbEntries));
+        case DDWAF_OBJ_SIGNED:
+            return std::make_unique<T>(value.intValue);
+        case DDWAF_OBJ_UNSIGNED:
+            return std::make_unique<T>(value.uintValue);
+        default:
+            throw ddwaf::parsing_error("compared value not a string or an integer");
+    }
+}
+
 ddwaf::condition parseCondition(parameter::map& rule, PWManifest& manifest,
                                 std::vector<PW_TRANSFORM_ID>& transformers)
 {
@@ -52,6 +69,44 @@ ddwaf::condition parseCondition(parameter::map& rule, PWManifest& manifest,
 
         processor = std::make_unique<PerfMatch>(patterns, lengths);
     }
+    else if (operation == "exact_match")
+    {
+        auto list = at<parameter::vector>(params, "list");
+
+        std::vector<std::string_view> values;
+        values.reserve(list.size());
+
+        for (auto& value : list)
+        {
+            if (value.type != DDWAF_OBJ_STRING)
+            {
+                throw ddwaf::parsing_error("exact_match list item not a string");
+            }
+
+            values.emplace_back(value.stringValue, value.nbEntries);
+        }
+
+        processor = std::make_unique<ExactMatch>(values);
+    }
+    else if (operation == "ip_match")
+    {
+        auto list = at<parameter::vector>(params, "list");
+
+        std::vector<std::string_view> ips;
+        ips.reserve(list.size());
+
+        for (auto& ip : list)
+        {
+            if (ip.type != DDWAF_OBJ_STRING)
+            {
+                throw ddwaf::parsing_error("ip_match list item not a string");
+            }
+
+            ips.emplace_back(ip.stringValue, ip.nbEntries);
+        }
+
+        processor = std::make_unique<IPMatch>(ips);
+    }
     else if (operation == "match_regex")
     {
         auto regex = at<std::string>(params, "regex");
@@ -70,6 +125,38 @@ ddwaf::condition parseCondition(parameter::map& rule, PWManifest& manifest,
         // TODO support min length
         processor = std::make_unique<RE2Manager>(regex, case_sensitive);
     }
+    else if (operation == "equals")
+    {
+        processor = parseCompare<Equal>(at<parameter>(params, "value"));
+    }
+    else if (operation == "greater_than")
+    {
+        processor = parseCompare<GreaterThan>(at<parameter>(params, "value"));
+    }
+    else if (operation == "greater_than_or_equal")
+    {
+        processor = parseCompare<GreaterOrEqual>(at<parameter>(params, "value"));
+    }
+    else if (operation == "less_than")
+    {
+        processor = parseCompare<LessThan>(at<parameter>(params, "value"));
+    }
+    else if (operation == "less_than_or_equal")
+    {
+        processor = parseCompare<LessOrEqual>(at<parameter>(params, "value"));
+    }
+    else if (operation == "begins_with")
+    {
+        processor = std::make_unique<BeginsWith>(at<std::string_view>(params, "value"));
+    }
+    else if (operation == "contains")
+    {
+        processor = std::make_unique<Contains>(at<std::string_view>(params, "value"));
+    }
+    else if (operation == "ends_with")
+    {
+        processor = std::make_unique<EndsWith>(at<std::string_view>(params, "value"));
+    }
     else if (operation == "is_xss")
     {
         processor = std::make_unique<LibInjectionXSS>();
@@ -15,11 +15,72 @@
 namespace ddwaf
 {
 
-bool condition::matchWithTransformer(const ddwaf_object* baseInput, MatchGatherer& gatherer, bool onKey, bool readOnlyArg) const
+namespace
+{
+// Copies of the input made for the duration of a match, or inputs transformed
+// in place, may have the address of an input scanned earlier in the run: the
+// operators mustn't reuse the results of their previous scans for them.
+class uncached_scans
+{
+public:
+    uncached_scans(MatchGatherer& gatherer_, bool active = true) : gatherer(gatherer_), run(gatherer_.run)
+    {
+        if (active)
+            gatherer.run = 0;
+    }
+
+    ~uncached_scans() { gatherer.run = run; }
+
+    uncached_scans(const uncached_scans&) = delete;
+    uncached_scans& operator=(const uncached_scans&) = delete;
+
+protected:
+    MatchGatherer& gatherer;
+    const uint64_t run;
+};
+}
+
+bool condition::matchWithTransformer(const ddwaf_object* baseInput, MatchGatherer& gatherer, bool onKey, bool readOnlyArg, transformation_cache* cache, arena* allocator) const
 {
     const bool hasTransformation        = !transformation.empty();
     const bool canRunTransformation     = onKey || (baseInput->type == DDWAF_OBJ_STRING);
     bool transformationWillChangeString = false;
+    const uncached_scans mutableInput(gatherer, !readOnlyArg);
+
+    // The final output of the chain can be shared with the other conditions using it
+    if (hasTransformation && canRunTransformation && readOnlyArg && !options.matchInterTransformer)
+    {
+        if (cache != nullptr && trie != nullptr)
+            return matchWithCachedTransformer(baseInput, gatherer, onKey, *cache, allocator);
+
+        // The fused pipeline only copies the input if it changes it
+        const uncached_scans transientCopy(gatherer);
+        const bool copyInArena   = allocator != nullptr && inPlaceTransformation;
+        ddwaf_object transformed = transformCopy(baseInput, onKey, copyInArena ? allocator : nullptr);
+        if (transformed.type == DDWAF_OBJ_INVALID)
+        {
+            if (onKey)
+                return processor->doesMatchKey(baseInput, gatherer);
+            return processor->doesMatch(baseInput, gatherer);
+        }
+
+        const bool matched = processor->doesMatch(&transformed, gatherer);
+        if (!copyInArena)
+            ddwaf_object_free(&transformed);
+        return matched;
+    }
+
+    // So can the intermediary representations, each prefix of the chain being a node of the trie.
+    // Without the cache of a context, they're only kept for the duration of the call.
+    if (hasTransformation && canRunTransformation && readOnlyArg && !prefixChains.empty())
+    {
+        if (cache != nullptr)
+            return matchWithIntermediates(baseInput, gatherer, onKey, *cache, allocator);
+
+        const uncached_scans transientCopies(gatherer);
+        transformation_cache scratch;
+        return matchWithIntermediates(baseInput, gatherer, onKey, scratch, allocator);
+    }
 
     if (hasTransformation && canRunTransformation)
     {
@@ -44,17 +105,22 @@ bool condition::matchWithTransformer(const ddwaf_object* baseInput, MatchGathere
         return processor->doesMatch(baseInput, gatherer);
     }
 
+    // The copy is transformed in place
+    const uncached_scans transientCopy(gatherer);
     ddwaf_object copyInput;
+    const bool copyInArena = readOnlyArg && allocator != nullptr && inPlaceTransformation;
     if (readOnlyArg)
     {
         // Copy the input. If we're running on the key, we copy it in the value as it's functionnaly equivalent
-        if (onKey)
+        const char* source    = onKey ? baseInput->parameterName : baseInput->stringValue;
+        const uint64_t length = onKey ? baseInput->parameterNameLength : baseInput->nbEntries;
+        if (copyInArena)
         {
-            ddwaf_object_stringl(&copyInput, (const char*) baseInput->parameterName, baseInput->parameterNameLength);
+            ddwaf_object_stringl_nc(&copyInput, allocator->copy(source, (size_t) length), length);
         }
         else
         {
-            ddwaf_object_stringl(&copyInput, (const char*) baseInput->stringValue, baseInput->nbEntries);
+            ddwaf_object_stringl(&copyInput, source, length);
         }
     }
     else
@@ -108,7 +174,7 @@ bool condition::matchWithTransformer(const ddwaf_object* baseInput, MatchGathere
     }
 
     // Otherwise, the caller is in charge of freeing the pointer
-    if (readOnlyArg)
+    if (readOnlyArg && !copyInArena)
     {
         ddwaf_object_free(&copyInput);
     }
@@ -116,12 +182,121 @@ bool condition::matchWithTransformer(const ddwaf_object* baseInput, MatchGathere
     return matched;
 }
 
-condition::status condition::_matchTargets(PWRetriever& retriever, const SQPowerWAF::monotonic_clock::time_point& deadline, PWRetManager& retManager) const
+bool condition::matchWithCachedTransformer(const ddwaf_object* baseInput, MatchGatherer& gatherer, bool onKey, transformation_cache& cache, arena* allocator) const
 {
-    PWRetriever::Iterator& iterator = retriever.getIterator(targets);
-    retriever.moveIteratorForward(iterator, false);
+    bool failed;
+    const ddwaf_object* transformed = trie->evaluate(chain, baseInput, onKey, cache, allocator, failed);
+    if (transformed != nullptr)
+        return processor->doesMatch(transformed, gatherer);
+
+    if (onKey)
+        return processor->doesMatchKey(baseInput, gatherer);
+    return processor->doesMatch(baseInput, gatherer);
+}
 
-    if (iterator.isOver())
+bool condition::matchWithIntermediates(const ddwaf_object* baseInput, MatchGatherer& gatherer, bool onKey, transformation_cache& cache, arena* allocator) const
+{
+    // The representations are views of the input or of the outputs held by the cache
+    ddwaf_object current;
+    if (onKey)
+        ddwaf_object_stringl_nc(&current, baseInput->parameterName, baseInput->parameterNameLength);
+    else
+        ddwaf_object_stringl_nc(&current, baseInput->stringValue, baseInput->nbEntries);
+
+    bool matched = false, changed = false, failed = false;
+    for (transformation_cache::chain_id prefix : prefixChains)
+    {
+        const ddwaf_object* next = trie->evaluate(prefix, baseInput, onKey, cache, allocator, failed);
+        if (failed)
+            break;
+
+        // An output left unchanged by the transformer is the same object or string as its input
+        if (next == nullptr || (next->type == current.type && next->stringValue == current.stringValue))
+            continue;
+
+        // The representation before the transformer is matched, the final one is matched below
+        matched |= processor->doesMatch(&current, gatherer);
+        if (matched && !options.keepRunningOnMatch)
+            return true;
+
+        current = *next;
+        changed = true;
+    }
+
+    if (changed && !failed)
+        return processor->doesMatch(&current, gatherer) || matched;
+
+    if (onKey)
+        return processor->doesMatchKey(baseInput, gatherer) || matched;
+    return processor->doesMatch(baseInput, gatherer) || matched;
+}
+
+ddwaf_object condition::transformCopy(const ddwaf_object* baseInput, bool onKey, arena* allocator) const
+{
+    if (onKey)
+        return pipeline->transform(baseInput->parameterName, baseInput->parameterNameLength, allocator);
+    return pipeline->transform(baseInput->stringValue, baseInput->nbEntries, allocator);
+}
+
+void condition::setTransformerChain(std::shared_ptr<const transformer_trie> trie_, transformation_cache::chain_id chain_)
+{
+    chain    = chain_;
+    pipeline = trie_->pipeline(chain_);
+    trie     = std::move(trie_);
+
+    prefixChains.clear();
+    if (!options.matchInterTransformer)
+        return;
+
+    for (auto end = transformation.begin() + 1; end <= transformation.end(); ++end)
+    {
+        const transformation_cache::chain_id prefix = trie->find({ transformation.begin(), end });
+        if (prefix == transformation_cache::no_chain)
+        {
+            // Not built for matchInterTransformer, the transformers are then applied one by one
+            prefixChains.clear();
+            return;
+        }
+        prefixChains.push_back(prefix);
+    }
+}
+
+bool condition::matchCurrentItem(PWRetriever& retriever, const PWRetriever::Iterator& iterator, MatchGatherer& gather, transformation_cache* cache, arena* allocator) const
+{
+    bool didMatch = retriever.runIterOnLambda(iterator, saveParamOnMatch, [&gather, cache, allocator, this](const ddwaf_object* input, DDWAF_OBJ_TYPE type, bool runOnKey, bool isReadOnlyArg) -> bool {
+        if ((type & processor->expectedTypes()) == 0)
+            return false;
+
+        const uint64_t stringLength = runOnKey ? input->parameterNameLength : input->nbEntries;
+        if (type == DDWAF_OBJ_STRING && stringLength < options.minLength)
+            return false;
+
+        return matchWithTransformer(input, gather, runOnKey, isReadOnlyArg, cache, allocator);
+    });
+
+    if (didMatch)
+    {
+        DDWAF_TRACE("BA %d did match %s out of parameter value %s",
+                    iterator.getActiveTarget(),
+                    gather.matchedValue.c_str(),
+                    gather.resolvedValue.c_str());
+        iterator.argsIterator.getKeyPath(gather.keyPath);
+        gather.dataSource  = iterator.getDataSource();
+        gather.manifestKey = iterator.getManifestKey();
+    }
+
+    return didMatch;
+}
+
+condition::status condition::finalizeMatching(bool resolved, const MatchGatherer* match, PWRetManager& retManager) const
+{
+    if (match != nullptr)
+    {
+        retManager.recordRuleMatch(processor, *match);
+        return status::matched;
+    }
+
+    if (!resolved)
     {
         //If no BAs for this rule have resolved, we return MISSING_ARG
         //	(that is, unless the processor "match" in this case)
@@ -132,10 +307,38 @@ condition::status condition::_matchTargets(PWRetriever& retriever, const SQPower
         return status::matched;
     }
 
+    // Only @exist care about this branch, it's at the end to enable a better report when there is a real value
+    if (processor->matchAnyInput())
+    {
+        retManager.recordRuleMatch(processor, MatchGatherer(matchesToGather));
+        return status::matched;
+    }
+
+    //	If at least one resolved, but didn't matched, we return NO_MATCH
+    return status::no_match;
+}
+
+bool condition::supportsTargetIndex() const
+{
+    // Conditions collecting matches for a further filter or reporting every
+    // match need to see the items in their own iteration order
+    return !saveParamOnMatch && matchesToGather.empty() && !options.keepRunningOnMatch;
+}
+
+condition::status condition::_matchTargets(PWRetriever& retriever, const SQPowerWAF::monotonic_clock::time_point& deadline, PWRetManager& retManager, transformation_cache* cache, arena* allocator) const
+{
+    PWRetriever::Iterator& iterator = retriever.getIterator(targets);
+    retriever.moveIteratorForward(iterator, false);
+
+    if (iterator.isOver())
+    {
+        return finalizeMatching(false, nullptr, retManager);
+    }
+
     bool matched             = false;
     size_t counter           = 0;
     const bool savingMatches = saveParamOnMatch || !matchesToGather.empty();
-    MatchGatherer gather(matchesToGather);
+    MatchGatherer gather(matchesToGather, allocator);
 
     do
     {
@@ -143,28 +346,9 @@ condition::status condition::_matchTargets(PWRetriever& retriever, const SQPower
         if ((++counter & 0xf) == 0 && deadline <= SQPowerWAF::monotonic_clock::now())
             return status::timeout;
 
-        bool didMatch = retriever.runIterOnLambda(iterator, saveParamOnMatch, [&gather, this](const ddwaf_object* input, DDWAF_OBJ_TYPE type, bool runOnKey, bool isReadOnlyArg) -> bool {
-            if ((type & processor->expectedTypes()) == 0)
-                return false;
-
-            const uint64_t stringLength = runOnKey ? input->parameterNameLength : input->nbEntries;
-            if (type == DDWAF_OBJ_STRING && stringLength < options.minLength)
-                return false;
-
-            return matchWithTransformer(input, gather, runOnKey, isReadOnlyArg);
-        });
-
         //If this BA matched, we can stop processing
-        if (didMatch)
+        if (matchCurrentItem(retriever, iterator, gather, cache, allocator))
         {
-            DDWAF_TRACE("BA %d did match %s out of parameter value %s",
-                        iterator.getActiveTarget(),
-                        gather.matchedValue.c_str(),
-                        gather.resolvedValue.c_str());
-            iterator.argsIterator.getKeyPath(gather.keyPath);
-            gather.dataSource  = iterator.getDataSource();
-            gather.manifestKey = iterator.getManifestKey();
-
             retManager.recordRuleMatch(processor, gather);
 
             // Actually, we can only stop processing if we were not collecting matches for a further filter
@@ -177,22 +361,14 @@ condition::status condition::_matchTargets(PWRetriever& retriever, const SQPower
         }
     } while (retriever.moveIteratorForward(iterator));
 
-    // Only @exist care about this branch, it's at the end to enable a better report when there is a real value
-    if (!matched && processor->matchAnyInput())
-    {
-        retManager.recordRuleMatch(processor, MatchGatherer(matchesToGather));
-        return status::matched;
-    }
-
-    //	If at least one resolved, but didn't matched, we return NO_MATCH
-    return matched ? status::matched : status::no_match;
+    return matched ? status::matched : finalizeMatching(true, nullptr, retManager);
 }
 
-condition::status condition::performMatching(PWRetriever& retriever, const SQPowerWAF::monotonic_clock::time_point& deadline, PWRetManager& retManager) const
+condition::status condition::performMatching(PWRetriever& retriever, const SQPowerWAF::monotonic_clock::time_point& deadline, PWRetManager& retManager, transformation_cache* cache, arena* allocator) const
 {
     bool matched = false;
 
-    condition::status output = _matchTargets(retriever, deadline, retManager);
+    condition::status output = _matchTargets(retriever, deadline, retManager, cache, allocator);
 
     if (matched && (output == status::no_match || output == status::missing_arg))
         return status::matched;
@@ -211,4 +387,55 @@ bool condition::doesUseNewParameters(const PWRetriever& retriever) const
     return false;
 }
 
+void target_index::build(const rule_vector& rules, const flow_vector& flows)
+{
+    conditions.clear();
+    slots.clear();
+    slots.reserve(rules.size());
+    slotCount = 0;
+
+    flowPositions.assign(rules.size(), { 0, 0 });
+    flowCount = (uint32_t) flows.size();
+    for (uint32_t flow = 0; flow < flowCount; ++flow)
+    {
+        const std::vector<rule_index>& flowRules = flows[flow].second;
+        for (uint32_t position = 0; position < flowRules.size(); ++position)
+        {
+            flowPositions[flowRules[position]] = { flow, position };
+        }
+    }
+
+    for (rule_index ruleIndex = 0; ruleIndex < rules.size(); ++ruleIndex)
+    {
+        const std::vector<condition>& ruleConditions = rules[ruleIndex].conditions;
+        std::vector<uint32_t>& ruleSlots             = slots.emplace_back();
+        ruleSlots.reserve(ruleConditions.size());
+
+        for (uint32_t condIndex = 0; condIndex < ruleConditions.size(); ++condIndex)
+        {
+            const condition& cond = ruleConditions[condIndex];
+            const auto& targets   = cond.getTargets();
+
+            ruleSlots.push_back(slotCount);
+            for (uint32_t position = 0; position < targets.size(); ++position, ++slotCount)
+            {
+                const PWManifest::ARG_ID target = targets[position];
+                if (target >= conditions.size())
+                {
+                    conditions.resize(target + 1);
+                }
+
+                // A target listed twice by the same condition can't yield a different result
+                auto& entries = conditions[target];
+                if (!entries.empty() && entries.back().rule == ruleIndex && entries.back().condition == condIndex)
+                {
+                    continue;
+                }
+
+                entries.push_back({ ruleIndex, condIndex, position, slotCount });
+            }
+        }
+    }
+}
+
 }
@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -17,20 +18,36 @@
 #include <PWRet.hpp>
 #include <PWRetriever.hpp>
 #include <PWTransformer.h>
+#include <arena.hpp>
+#include <transformation_cache.hpp>
+#include <transformer_pipeline.hpp>
+#include <transformer_trie.hpp>
 
 // Expect `1 << (MAX_MATCH_COUNT - 1)` to fit in 16 bits
 
+#ifdef TESTING
+class TestRule_TestMatchInterTransformer_Test;
+#endif
+
 namespace ddwaf
 {
 
 class rule;
 class condition;
 
+// Ruleset representation produced by the parsers, keyed by rule ID
 using rule_map = std::unordered_map<std::string, rule>;
 using flow_map = std::unordered_map<std::string, std::vector<std::string>>;
 
+// Compiled ruleset representation: rules are stored contiguously and flows
+// reference them through their index.
+using rule_index  = uint32_t;
+using rule_vector = std::vector<rule>;
+using flow_vector = std::vector<std::pair<std::string, std::vector<rule_index>>>;
+
 struct rule
 {
+    std::string id;
     std::string name;
     std::string category;
     std::vector<condition> conditions;
@@ -52,23 +69,56 @@ public:
               std::vector<PW_TRANSFORM_ID>&& transformers,
               std::unique_ptr<IPWRuleProcessor>&& processor_) : targets(std::move(targets_)),
                                                                 transformation(std::move(transformers)),
-                                                                processor(std::move(processor_)) {}
+                                                                processor(std::move(processor_))
+    {
+        inPlaceTransformation = std::all_of(transformation.begin(), transformation.end(), PWTransformer::transformsInPlace);
+        if (!transformation.empty())
+            pipeline = std::make_shared<const transformer_pipeline>(transformation);
+    }
     condition(condition&&) = default;
     condition& operator=(condition&&) = default;
 
     condition(const condition&) = delete;
     condition& operator=(const condition&) = delete;
-    status performMatching(PWRetriever& retriever, const SQPowerWAF::monotonic_clock::time_point& deadline, PWRetManager& retManager) const;
-    bool matchWithTransformer(const ddwaf_object* baseInput, MatchGatherer& gatherer, bool onKey, bool readOnlyArg) const;
+    status performMatching(PWRetriever& retriever, const SQPowerWAF::monotonic_clock::time_point& deadline, PWRetManager& retManager, transformation_cache* cache = nullptr, arena* allocator = nullptr) const;
+    bool matchWithTransformer(const ddwaf_object* baseInput, MatchGatherer& gatherer, bool onKey, bool readOnlyArg, transformation_cache* cache = nullptr, arena* allocator = nullptr) const;
     bool doesUseNewParameters(const PWRetriever& retriever) const;
 
+    const std::vector<PW_TRANSFORM_ID>& getTransformers() const { return transformation; }
+    // Conditions sharing a chain also share its compiled pipeline, and the outputs
+    // of the prefixes they have in common with other chains
+    void setTransformerChain(std::shared_ptr<const transformer_trie> trie_, transformation_cache::chain_id chain_);
+    // Whether every intermediate representation along the chain is matched,
+    // in which case the trie is expected to hold every prefix of the chain
+    bool getMatchInterTransformer() const { return options.matchInterTransformer; }
+    IPWRuleProcessor& getProcessor() { return *processor; }
+    const IPWRuleProcessor& getProcessor() const { return *processor; }
+
+    // Address-major evaluation: the caller walks each target once, feeds every
+    // item to matchCurrentItem and reports the outcome through finalizeMatching
+    const std::vector<PWManifest::ARG_ID>& getTargets() const { return targets; }
+    bool supportsTargetIndex() const;
+    MatchGatherer createGatherer(arena* allocator = nullptr) const { return MatchGatherer(matchesToGather, allocator); }
+    bool matchCurrentItem(PWRetriever& retriever, const PWRetriever::Iterator& iterator, MatchGatherer& gather, transformation_cache* cache = nullptr, arena* allocator = nullptr) const;
+    status finalizeMatching(bool resolved, const MatchGatherer* match, PWRetManager& retManager) const;
+
 protected:
     status _matchPastMatches(PWRetriever& retriever, const SQPowerWAF::monotonic_clock::time_point& deadline, PWRetManager& retManager) const;
-    status _matchTargets(PWRetriever& retriever, const SQPowerWAF::monotonic_clock::time_point& deadline, PWRetManager& retManager) const;
+    status _matchTargets(PWRetriever& retriever, const SQPowerWAF::monotonic_clock::time_point& deadline, PWRetManager& retManager, transformation_cache* cache, arena* allocator) const;
+    bool matchWithCachedTransformer(const ddwaf_object* baseInput, MatchGatherer& gatherer, bool onKey, transformation_cache& cache, arena* allocator) const;
+    bool matchWithIntermediates(const ddwaf_object* baseInput, MatchGatherer& gatherer, bool onKey, transformation_cache& cache, arena* allocator) const;
+    ddwaf_object transformCopy(const ddwaf_object* baseInput, bool onKey, arena* allocator) const;
 
     bool initialized;
     std::vector<PWManifest::ARG_ID> targets;
     std::vector<PW_TRANSFORM_ID> transformation;
+    transformation_cache::chain_id chain { transformation_cache::no_chain };
+    std::shared_ptr<const transformer_pipeline> pipeline;
+    std::shared_ptr<const transformer_trie> trie;
+    // Nodes of the prefixes of the chain, shortest first, for matchInterTransformer
+    std::vector<transformation_cache::chain_id> prefixChains;
+    // Copies to transform can be allocated from the arena of the context
+    bool inPlaceTransformation;
     std::unique_ptr<IPWRuleProcessor> processor;
     std::vector<uint8_t> matchesToGather;
     bool saveParamOnMatch { false };
@@ -78,6 +128,42 @@ protected:
         bool keepRunningOnMatch    = false;
         bool matchInterTransformer = false;
     } options;
+
+#ifdef TESTING
+    friend class ::TestRule_TestMatchInterTransformer_Test;
+#endif
+};
+
+// Inverted index from targets to the conditions evaluating them, built once per
+// ruleset. Each (condition, target) pair is assigned a slot in which contexts
+// store the result of the condition on that target for the current run.
+struct target_index
+{
+    struct entry
+    {
+        rule_index rule;
+        uint32_t condition; // Position of the condition within the rule
+        uint32_t position;  // Position of the target within the condition
+        uint32_t slot;
+    };
+
+    // Indexed by ARG_ID
+    std::vector<std::vector<entry>> conditions;
+    // Indexed by rule and condition, slot of the first target of the condition
+    std::vector<std::vector<uint32_t>> slots;
+    uint32_t slotCount { 0 };
+
+    // Indexed by rule, the rules of a flow past the first one to match aren't
+    // evaluated
+    struct flow_position
+    {
+        uint32_t flow;
+        uint32_t position; // Position of the rule within the flow
+    };
+    std::vector<flow_position> flowPositions;
+    uint32_t flowCount { 0 };
+
+    void build(const rule_vector& rules, const flow_vector& flows);
 };
 
 }
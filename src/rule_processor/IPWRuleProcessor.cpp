@@ -6,7 +6,10 @@
 
 #include <IPWRuleProcessor.h>
 
-MatchGatherer::MatchGatherer(const std::vector<uint8_t>& matchToGather) : submatchToGather(matchToGather) {}
+MatchGatherer::MatchGatherer(const std::vector<uint8_t>& matchToGather, ddwaf::arena* arena)
+    : resolvedValue(arena), matchedValue(arena), submatches(arena),
+      submatchToGather(matchToGather), keyPath(arena),
+      run(arena != nullptr ? arena->generation() : 0) {}
 
 void MatchGatherer::clear()
 {
@@ -7,9 +7,11 @@
 #ifndef IPWRuleProcessor_h
 #define IPWRuleProcessor_h
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
+#include <arena.hpp>
 #include <ddwaf.h>
 #include <string_view>
 #include <utils.h>
@@ -21,17 +23,23 @@ typedef enum
     RUN_ON_NO_DATA = 1 << 1
 } OperatorCommand;
 
+// Backed by the arena of the context, if any, and thus only valid for the current run
 struct MatchGatherer
 {
-    std::string resolvedValue;
-    std::string matchedValue;
-    std::vector<std::pair<uint8_t, std::string>> submatches;
+    ddwaf::arena_string resolvedValue;
+    ddwaf::arena_string matchedValue;
+    ddwaf::arena_vector<std::pair<uint8_t, ddwaf::arena_string>> submatches;
     const std::vector<uint8_t>& submatchToGather;
-    std::vector<ddwaf_object> keyPath;
-    std::string dataSource;
-    std::string manifestKey;
+    ddwaf::arena_vector<ddwaf_object> keyPath;
+    // Owned by the manifest
+    std::string_view dataSource;
+    std::string_view manifestKey;
+    // Generation of the arena, 0 without one. Within a run, the inputs and
+    // the outputs of the transformers keep their address, the operators can
+    // thus key the results of their previous scans on it.
+    uint64_t run { 0 };
 
-    MatchGatherer(const std::vector<uint8_t>& matchToGather);
+    MatchGatherer(const std::vector<uint8_t>& matchToGather, ddwaf::arena* arena = nullptr);
 
     void clear();
 };
@@ -42,9 +50,34 @@ protected:
     bool wantMatch { true };
     bool runOnMissing { false };
     bool matchAny { false };
+    // Bytes of a string looked at by the operators bounding their input
+    uint64_t maxStringLength { DDWAF_MAX_STRING_LENGTH };
 
     virtual bool performMatch(const char* str, size_t length, MatchGatherer& gatherer) const = 0;
 
+    // Run match on windows of at most DDWAF_MAX_STRING_LENGTH bytes covering
+    // the first maxStringLength bytes of the string, until it returns true.
+    // Consecutive windows overlap by STRING_WINDOW_OVERLAP bytes.
+    template <typename Match>
+    bool matchWindows(const char* str, size_t length, Match&& match) const
+    {
+        length = findStringCutoff(str, length, (size_t) maxStringLength);
+        for (size_t start = 0;;)
+        {
+            size_t window = findStringCutoff(str + start, length - start);
+            if (window == 0)
+                window = std::min<size_t>(length - start, DDWAF_MAX_STRING_LENGTH);
+
+            if (match(str + start, window))
+                return true;
+
+            if (start + window >= length)
+                return false;
+
+            start = findNextWindow(str, start, start + window);
+        }
+    }
+
 public:
     IPWRuleProcessor()          = default;
     virtual ~IPWRuleProcessor() = default;
@@ -53,6 +86,7 @@ public:
     virtual bool doesMatchKey(const ddwaf_object* pattern, MatchGatherer& gatherer) const;
     bool matchIfMissing() const;
     bool matchAnyInput() const;
+    void setMaxStringLength(uint64_t length) { maxStringLength = length; }
     virtual uint64_t expectedTypes() const;
     virtual bool hasStringRepresentation() const;
     virtual const std::string getStringRepresentation() const;
@@ -77,6 +111,10 @@ public:
 #define OP_EXIST "@exist"
 #define OP_IPM "@ipMatch"
 
+#include "compare.hpp"
+#include "exact_match.hpp"
+#include "extremities.hpp"
+#include "ip_match.hpp"
 #include "libinjection.hpp"
 #include "perf_match.hpp"
 #include "re2.hpp"
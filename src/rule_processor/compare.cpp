@@ -5,189 +5,130 @@
 // Copyright 2021 Datadog, Inc.
 
 #include <algorithm>
+#include <charconv>
+#include <cstring>
 
 #include <IPWRuleProcessor.h>
-#include <utils.h>
 
-int Compare::performCompare(uint64_t data, uint64_t length, DDWAF_OBJ_TYPE type) const
-{
-    // The value should only be either a string or a number
-    if (internalValue.type == DDWAF_OBJ_STRING)
-    {
-        //Because of the definition of ddwaf_object, the agent is allowed to send 0 bytes in strings.
-        //	String may also not be 0-terminated
-        //	This logic need to check for that
+Compare::Compare(std::string_view value) : IPWRuleProcessor(), type(DDWAF_OBJ_STRING), stringValue(value) {}
 
-        size_t lengthSize = (size_t) length;
+Compare::Compare(int64_t value) : IPWRuleProcessor(), type(DDWAF_OBJ_SIGNED), signedValue(value) {}
 
-        //Will return a negative value if data is "lower" than internalValue
-        size_t internalLength = internalValue.stringValue.length();
-        int output            = memcmp((const void*) data, internalValue.stringValue.c_str(), std::min(lengthSize, internalLength));
-
-        // We only compare the strings up until the shortest string end.
-        //  If they match on this segment, we return the shortest string as the "lowest"
-        return output == 0 ? (int) (length - internalLength) : output;
-    }
+Compare::Compare(uint64_t value) : IPWRuleProcessor(), type(DDWAF_OBJ_UNSIGNED), unsignedValue(value) {}
 
-    // If it's a number, we have to deal with signedness fun
-    //	We quickly turn the encoded value into something easier to deal with
-    union
-    {
-        int64_t s;
-        uint64_t u;
-    } value;
-    value.u = data;
+int Compare::compareString(const char* str, size_t length) const
+{
+    //Strings may contain 0 bytes, and aren't necessarily 0-terminated
+    const size_t valueLength = stringValue.length();
+    const int output         = memcmp(str, stringValue.data(), std::min(length, valueLength));
+
+    // If the shortest string is a prefix of the other, it's the "lowest"
+    if (output != 0)
+        return output;
+    return length < valueLength ? -1 : (length > valueLength ? 1 : 0);
+}
 
-    // Then we see if the comparaison is possible
-    if (type == DDWAF_OBJ_SIGNED && internalValue.type != DDWAF_OBJ_SIGNED)
+int Compare::compareSigned(int64_t input) const
+{
+    if (type == DDWAF_OBJ_UNSIGNED)
     {
-        //Value is negative, and we're trying to compare to an unsigned value... we already know we're lower :)
-        if (value.s < 0)
+        //A negative input is lower than any unsigned value
+        if (input < 0)
             return -1;
-
-        type = DDWAF_OBJ_UNSIGNED;
+        return compareUnsigned((uint64_t) input);
     }
-    else if (type == DDWAF_OBJ_UNSIGNED && internalValue.type != DDWAF_OBJ_UNSIGNED)
-    {
-        // If the value is larger than the maximum encodable value in our signed storage, we can stop right now :)
-        if (value.u > INT64_MAX)
-            return 1;
 
-        type = DDWAF_OBJ_SIGNED;
-    }
+    return input < signedValue ? -1 : (input > signedValue ? 1 : 0);
+}
 
-    switch (type)
+int Compare::compareUnsigned(uint64_t input) const
+{
+    if (type == DDWAF_OBJ_SIGNED)
     {
-        case DDWAF_OBJ_SIGNED:
-        {
-            if (value.s > internalValue.signedInt)
-                return 1;
-            else if (value.s == internalValue.signedInt)
-                return 0;
-            else
-                return -1;
-        }
-
-        case DDWAF_OBJ_UNSIGNED:
-        {
-            if (value.u > internalValue.unsignedInt)
-                return 1;
-            else if (value.u == internalValue.unsignedInt)
-                return 0;
-            else
-                return -1;
-        }
-
-        default:
-            return false;
+        //Any unsigned input is greater than a negative value
+        if (signedValue < 0)
+            return 1;
+        return input < (uint64_t) signedValue ? -1 : (input > (uint64_t) signedValue ? 1 : 0);
     }
+
+    return input < unsignedValue ? -1 : (input > unsignedValue ? 1 : 0);
 }
 
-bool Compare::perform(uint64_t data, uint64_t length, DDWAF_OBJ_TYPE type, MatchGatherer& gatherer) const
+bool Compare::performMatch(const char* str, size_t length, MatchGatherer& gatherer) const
 {
-    bool didMatch = matchFromCompare(performCompare(data, length, type));
-    bool output   = didMatch == wantMatch;
+    if (str == nullptr)
+        return false;
 
-    if (output)
+    bool didMatch   = matchFromCompare(compareString(str, length));
+    bool didSucceed = didMatch == wantMatch;
+
+    if (didSucceed)
     {
-        switch (type)
+        gatherer.resolvedValue.assign(str, length);
+        if (didMatch)
         {
-            case DDWAF_OBJ_STRING:
-                gatherer.resolvedValue = std::string((const char*) data, (size_t) length);
-                break;
-
-            case DDWAF_OBJ_SIGNED:
-                gatherer.resolvedValue = std::to_string(((int64_t) data));
-                break;
-
-            case DDWAF_OBJ_UNSIGNED:
-                gatherer.resolvedValue = std::to_string(data);
-                break;
-
-            default:
-                output = false;
-                break;
+            gatherer.matchedValue = gatherer.resolvedValue;
         }
     }
 
-    return output;
+    return didSucceed;
 }
 
-Compare::Compare(const char* refName, uint64_t command) : IPWRuleProcessor(refName, command)
+template <typename T>
+bool Compare::performNumberMatch(T input, int compareResult, MatchGatherer& gatherer) const
 {
-    internalValue.type = DDWAF_OBJ_INVALID;
-}
+    bool didMatch   = matchFromCompare(compareResult);
+    bool didSucceed = didMatch == wantMatch;
 
-bool Compare::buildProcessor(const rapidjson::Value& value, bool)
-{
-    switch (value.GetType())
+    if (didSucceed)
     {
-        case rapidjson::kStringType:
+        // Large enough for any 64-bit integer and its sign
+        char buffer[24];
+        const auto result = std::to_chars(buffer, buffer + sizeof(buffer), input);
+        gatherer.resolvedValue.assign(buffer, (size_t) (result.ptr - buffer));
+        if (didMatch)
         {
-            internalValue.type        = DDWAF_OBJ_STRING;
-            internalValue.stringValue = std::string(value.GetString(), value.GetStringLength());
-            return true;
+            gatherer.matchedValue = gatherer.resolvedValue;
         }
+    }
 
-        case rapidjson::kNumberType:
-        {
-            if (value.IsDouble())
-            {
-                return false;
-            }
-            else if (value.IsUint64())
-            {
-                internalValue.type        = DDWAF_OBJ_UNSIGNED;
-                internalValue.unsignedInt = value.GetUint64();
-            }
-            else
-            {
-                internalValue.type      = DDWAF_OBJ_SIGNED;
-                internalValue.signedInt = value.GetInt64();
-            }
-            return true;
-        }
+    return didSucceed;
+}
 
-        case rapidjson::kTrueType:
-        {
-            internalValue.type        = DDWAF_OBJ_UNSIGNED;
-            internalValue.unsignedInt = 1;
-            return true;
-        }
+bool Compare::doesMatch(const ddwaf_object* pattern, MatchGatherer& gatherer) const
+{
+    switch (pattern->type)
+    {
+        case DDWAF_OBJ_STRING:
+            return type == DDWAF_OBJ_STRING && performMatch(pattern->stringValue, (size_t) pattern->nbEntries, gatherer);
 
-        case rapidjson::kFalseType:
-        {
-            internalValue.type        = DDWAF_OBJ_UNSIGNED;
-            internalValue.unsignedInt = 0;
-            return true;
-        }
+        case DDWAF_OBJ_SIGNED:
+            return type != DDWAF_OBJ_STRING && performNumberMatch(pattern->intValue, compareSigned(pattern->intValue), gatherer);
+
+        case DDWAF_OBJ_UNSIGNED:
+            return type != DDWAF_OBJ_STRING && performNumberMatch(pattern->uintValue, compareUnsigned(pattern->uintValue), gatherer);
 
         default:
             return false;
     }
 }
 
-bool Compare::doesMatch(const ddwaf_object* pattern, MatchGatherer& gatherer) const
-{
-    return perform(pattern->uintValue, pattern->nbEntries, pattern->type, gatherer);
-}
-
 bool Compare::doesMatchKey(const ddwaf_object* pattern, MatchGatherer& gatherer) const
 {
-    if (pattern->parameterName == nullptr || internalValue.type != DDWAF_OBJ_STRING)
+    // Keys are strings
+    if (type != DDWAF_OBJ_STRING)
         return false;
 
-    // Assume the pointer type is smaller or as large as uint64_t
-    return perform((uint64_t) pattern->parameterName, pattern->parameterNameLength, DDWAF_OBJ_STRING, gatherer);
+    return IPWRuleProcessor::doesMatchKey(pattern, gatherer);
 }
 
 uint64_t Compare::expectedTypes() const
 {
-    //Compatibility layer for mixed signedness
-    if (internalValue.type == DDWAF_OBJ_SIGNED || internalValue.type == DDWAF_OBJ_UNSIGNED)
+    //Numbers are compared whatever their signedness
+    if (type == DDWAF_OBJ_SIGNED || type == DDWAF_OBJ_UNSIGNED)
         return DDWAF_OBJ_SIGNED | DDWAF_OBJ_UNSIGNED;
 
-    return internalValue.type;
+    return DDWAF_OBJ_STRING;
 }
 
 bool Compare::hasStringRepresentation() const
@@ -197,47 +138,41 @@ bool Compare::hasStringRepresentation() const
 
 const std::string Compare::getStringRepresentation() const
 {
-    if (internalValue.type == DDWAF_OBJ_STRING)
+    if (type == DDWAF_OBJ_STRING)
     {
-        return internalValue.stringValue;
+        return stringValue;
     }
-    else if (internalValue.type == DDWAF_OBJ_SIGNED)
+    else if (type == DDWAF_OBJ_SIGNED)
     {
-        return std::to_string(internalValue.signedInt);
+        return std::to_string(signedValue);
     }
     else
     {
-        return std::to_string(internalValue.unsignedInt);
+        return std::to_string(unsignedValue);
     }
 }
 
-//Discard this function as it's too restricted for us
-bool Compare::performMatch(const char*, size_t, MatchGatherer&) const
-{
-    return false;
-}
-
-bool Equal::matchFromCompare(const int compareResult) const
+bool Equal::matchFromCompare(int compareResult) const
 {
     return compareResult == 0;
 }
 
-bool GreaterThan::matchFromCompare(const int compareResult) const
+bool GreaterThan::matchFromCompare(int compareResult) const
 {
     return compareResult > 0;
 }
 
-bool GreaterOrEqual::matchFromCompare(const int compareResult) const
+bool GreaterOrEqual::matchFromCompare(int compareResult) const
 {
     return compareResult >= 0;
 }
 
-bool LessThan::matchFromCompare(const int compareResult) const
+bool LessThan::matchFromCompare(int compareResult) const
 {
     return compareResult < 0;
 }
 
-bool LessOrEqual::matchFromCompare(const int compareResult) const
+bool LessOrEqual::matchFromCompare(int compareResult) const
 {
     return compareResult <= 0;
 }
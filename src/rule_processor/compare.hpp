@@ -7,62 +7,98 @@
 #ifndef compare_h
 #define compare_h
 
-struct Compare : public IPWRuleProcessor
+// Compare the input with a string, bytewise, or with a number. Numbers are
+// compared on their value regardless of the signedness of the input.
+class Compare : public IPWRuleProcessor
 {
-    struct ValueRepresentation
-    {
-        std::string stringValue;
-        union
-        {
-            int64_t signedInt;
-            uint64_t unsignedInt;
-        };
-        DDWAF_OBJ_TYPE type;
-    };
-
-    ValueRepresentation internalValue;
-
-    int performCompare(uint64_t data, uint64_t length, DDWAF_OBJ_TYPE type) const;
-    virtual bool matchFromCompare(const int compareResult) const = 0;
-    bool perform(uint64_t data, uint64_t length, DDWAF_OBJ_TYPE type, MatchGatherer& gatherer) const;
-    Compare(const char* refName, uint64_t command);
-    bool buildProcessor(const rapidjson::Value& value, bool) override;
+public:
+    explicit Compare(std::string_view value);
+    explicit Compare(int64_t value);
+    explicit Compare(uint64_t value);
+
     bool doesMatch(const ddwaf_object* pattern, MatchGatherer& gatherer) const override;
     bool doesMatchKey(const ddwaf_object* pattern, MatchGatherer& gatherer) const override;
     uint64_t expectedTypes() const override;
     bool hasStringRepresentation() const override;
     const std::string getStringRepresentation() const override;
-    bool performMatch(const char*, size_t, MatchGatherer&) const override;
+
+protected:
+    // Negative, zero or positive if the input is lower than, equal to or
+    // greater than the value
+    int compareString(const char* str, size_t length) const;
+    int compareSigned(int64_t input) const;
+    int compareUnsigned(uint64_t input) const;
+    virtual bool matchFromCompare(int compareResult) const = 0;
+
+    bool performMatch(const char* str, size_t length, MatchGatherer& gatherer) const override;
+    template <typename T>
+    bool performNumberMatch(T input, int compareResult, MatchGatherer& gatherer) const;
+
+protected:
+    DDWAF_OBJ_TYPE type;
+    std::string stringValue;
+    int64_t signedValue { 0 };
+    uint64_t unsignedValue { 0 };
 };
 
 class Equal : public Compare
 {
-    using Compare::Compare; //Use the Compare constructor
-    bool matchFromCompare(const int compareResult) const override;
+public:
+    using Compare::Compare;
+    std::string_view operatorName() const override { return name; }
+
+protected:
+    bool matchFromCompare(int compareResult) const override;
+
+    static constexpr std::string_view name { "equals" };
 };
 
 class GreaterThan : public Compare
 {
+public:
     using Compare::Compare;
-    bool matchFromCompare(const int compareResult) const override;
+    std::string_view operatorName() const override { return name; }
+
+protected:
+    bool matchFromCompare(int compareResult) const override;
+
+    static constexpr std::string_view name { "greater_than" };
 };
 
 class GreaterOrEqual : public Compare
 {
+public:
     using Compare::Compare;
-    bool matchFromCompare(const int compareResult) const override;
+    std::string_view operatorName() const override { return name; }
+
+protected:
+    bool matchFromCompare(int compareResult) const override;
+
+    static constexpr std::string_view name { "greater_than_or_equal" };
 };
 
 class LessThan : public Compare
 {
+public:
     using Compare::Compare;
-    bool matchFromCompare(const int compareResult) const override;
+    std::string_view operatorName() const override { return name; }
+
+protected:
+    bool matchFromCompare(int compareResult) const override;
+
+    static constexpr std::string_view name { "less_than" };
 };
 
 class LessOrEqual : public Compare
 {
+public:
     using Compare::Compare;
-    bool matchFromCompare(const int compareResult) const override;
+    std::string_view operatorName() const override { return name; }
+
+protected:
+    bool matchFromCompare(int compareResult) const override;
+
+    static constexpr std::string_view name { "less_than_or_equal" };
 };
 
 #endif /* compare_h */
@@ -0,0 +1,29 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include <IPWRuleProcessor.h>
+
+ExactMatch::ExactMatch(const std::vector<std::string_view>& values_) : IPWRuleProcessor(), values(values_) {}
+
+bool ExactMatch::performMatch(const char* patternValue, size_t patternLength, MatchGatherer& gatherer) const
+{
+    if (patternValue == nullptr)
+        return false;
+
+    bool didMatch   = values.contains(std::string_view(patternValue, patternLength));
+    bool didSucceed = didMatch == wantMatch;
+
+    if (didSucceed)
+    {
+        gatherer.resolvedValue.assign(patternValue, patternLength);
+        if (didMatch)
+        {
+            gatherer.matchedValue = gatherer.resolvedValue;
+        }
+    }
+
+    return didSucceed;
+}
@@ -0,0 +1,28 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#ifndef exact_match_hpp
+#define exact_match_hpp
+
+#include <string_set.hpp>
+
+class ExactMatch : public IPWRuleProcessor
+{
+public:
+    ExactMatch(const std::vector<std::string_view>& values);
+    std::string_view operatorName() const override { return name; }
+
+    size_t valueCount() const { return values.size(); }
+
+protected:
+    bool performMatch(const char* patternValue, size_t patternLength, MatchGatherer& gatherer) const override;
+
+protected:
+    static constexpr std::string_view name { "exact_match" };
+    ddwaf::string_set values;
+};
+
+#endif /* exact_match_hpp */
@@ -22,7 +22,7 @@ bool Exist::doesMatch(const ddwaf_object* pattern, MatchGatherer& gatherer) cons
 {
     if (wantMatch && pattern->type == DDWAF_OBJ_STRING)
     {
-        gatherer.resolvedValue = std::string(pattern->stringValue, (size_t) pattern->nbEntries);
+        gatherer.resolvedValue.assign(pattern->stringValue, (size_t) pattern->nbEntries);
     }
 
     return wantMatch;
@@ -32,7 +32,7 @@ bool Exist::doesMatchKey(const ddwaf_object* pattern, MatchGatherer& gatherer) c
 {
     if (wantMatch && pattern->parameterName != NULL)
     {
-        gatherer.resolvedValue = std::string(pattern->parameterName, (size_t) pattern->parameterNameLength);
+        gatherer.resolvedValue.assign(pattern->parameterName, (size_t) pattern->parameterNameLength);
     }
 
     return wantMatch;
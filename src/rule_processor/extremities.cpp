@@ -4,30 +4,38 @@
 // This product includes software developed at Datadog (https://www.datadoghq.com/).
 // Copyright 2021 Datadog, Inc.
 
+#include <cstring>
+
 #include <IPWRuleProcessor.h>
+#include <exception.hpp>
+#include <simd.hpp>
 
-bool ExtremitiesMatch::performMatch(const char* pattern, size_t length, MatchGatherer& gatherer) const
+ExtremitiesMatch::ExtremitiesMatch(std::string_view value_) : IPWRuleProcessor(), value(value_)
 {
-    bool didMatch = matchString(pattern, length);
-    bool output   = didMatch == wantMatch;
-
-    if (output)
+    if (value.empty())
     {
-        gatherer.resolvedValue = std::string(pattern, length);
-        if (didMatch)
-            gatherer.matchedValue = value;
+        throw ddwaf::parsing_error("empty value");
     }
-
-    return output;
 }
 
-bool ExtremitiesMatch::buildProcessor(const rapidjson::Value& _value, bool)
+bool ExtremitiesMatch::performMatch(const char* pattern, size_t length, MatchGatherer& gatherer) const
 {
-    if (!_value.IsString())
+    if (pattern == nullptr)
         return false;
 
-    value = _value.GetString();
-    return !value.empty();
+    bool didMatch   = matchString(pattern, length);
+    bool didSucceed = didMatch == wantMatch;
+
+    if (didSucceed)
+    {
+        gatherer.resolvedValue.assign(pattern, length);
+        if (didMatch)
+        {
+            gatherer.matchedValue.assign(value.data(), value.size());
+        }
+    }
+
+    return didSucceed;
 }
 
 bool ExtremitiesMatch::hasStringRepresentation() const
@@ -46,25 +54,15 @@ bool BeginsWith::matchString(const char* pattern, size_t patternLength) const
     if (patternLength < length)
         return false;
 
-    return memcmp(pattern, value.c_str(), length) == 0;
+    return memcmp(pattern, value.data(), length) == 0;
 }
 
 bool Contains::matchString(const char* pattern, size_t patternLength) const
 {
-    const size_t length = value.length();
-    if (patternLength < length)
+    if (patternLength < value.length())
         return false;
 
-    const char* valueStr  = value.c_str();
-    const size_t maxStart = patternLength - length;
-    for (size_t pos = 0; pos <= maxStart; ++pos)
-    {
-        //If the first character match, we call memcmp on the rest of the string
-        if (pattern[pos] == valueStr[0] && memcmp(&pattern[pos], valueStr, length) == 0)
-            return true;
-    }
-
-    return false;
+    return ddwaf::simd::find_substring(pattern, patternLength, value.data(), value.length()) != patternLength;
 }
 
 bool EndsWith::matchString(const char* pattern, size_t patternLength) const
@@ -75,5 +73,5 @@ bool EndsWith::matchString(const char* pattern, size_t patternLength) const
 
     const size_t baseIndex = patternLength - length;
 
-    return memcmp(&pattern[baseIndex], value.c_str(), length) == 0;
+    return memcmp(&pattern[baseIndex], value.data(), length) == 0;
 }
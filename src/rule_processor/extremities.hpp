@@ -9,36 +9,57 @@
 
 class ExtremitiesMatch : public IPWRuleProcessor
 {
-protected:
-    std::string value;
+public:
+    // The value can't be empty
+    explicit ExtremitiesMatch(std::string_view value);
+
+    bool hasStringRepresentation() const override;
+    const std::string getStringRepresentation() const override;
 
+protected:
     virtual bool matchString(const char* pattern, size_t length) const = 0;
 
     bool performMatch(const char* pattern, size_t length, MatchGatherer& gatherer) const override;
 
-public:
-    using IPWRuleProcessor::IPWRuleProcessor;
-    bool buildProcessor(const rapidjson::Value&, bool) override;
-    bool hasStringRepresentation() const override;
-    const std::string getStringRepresentation() const override;
+protected:
+    std::string value;
 };
 
 class BeginsWith : public ExtremitiesMatch
 {
+public:
     using ExtremitiesMatch::ExtremitiesMatch;
+    std::string_view operatorName() const override { return name; }
+
+protected:
     bool matchString(const char* pattern, size_t patternLength) const override;
+
+    static constexpr std::string_view name { "begins_with" };
 };
 
+// The value is searched for with the vectorized substring search
 class Contains : public ExtremitiesMatch
 {
+public:
     using ExtremitiesMatch::ExtremitiesMatch;
+    std::string_view operatorName() const override { return name; }
+
+protected:
     bool matchString(const char* pattern, size_t patternLength) const override;
+
+    static constexpr std::string_view name { "contains" };
 };
 
 class EndsWith : public ExtremitiesMatch
 {
+public:
     using ExtremitiesMatch::ExtremitiesMatch;
+    std::string_view operatorName() const override { return name; }
+
+protected:
     bool matchString(const char* pattern, size_t patternLength) const override;
+
+    static constexpr std::string_view name { "ends_with" };
 };
 
 #endif /* extremities_h */
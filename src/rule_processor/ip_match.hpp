@@ -7,17 +7,23 @@
 #ifndef ip_match_hpp
 #define ip_match_hpp
 
-#include <radixlib.h>
+#include <ip_set.hpp>
 
 class IPMatch : public IPWRuleProcessor
 {
-    radix_tree_t* radixTree = nullptr;
+public:
+    // Entries which aren't valid addresses or networks are skipped
+    IPMatch(const std::vector<std::string_view>& ips);
+    std::string_view operatorName() const override { return name; }
+
+    size_t rangeCount() const { return set.size(); }
+
+protected:
     bool performMatch(const char* patternValue, size_t patternLength, MatchGatherer& gatherer) const override;
 
-public:
-    using IPWRuleProcessor::IPWRuleProcessor;
-    ~IPMatch();
-    bool buildProcessor(const rapidjson::Value& value, bool) override;
+protected:
+    static constexpr std::string_view name { "ip_match" };
+    ddwaf::ip_set set;
 };
 
 #endif /* ip_match_hpp */
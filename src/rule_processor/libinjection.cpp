@@ -12,17 +12,27 @@
 bool LibInjectionSQL::performMatch(const char* pattern, size_t length, MatchGatherer& gatherer) const
 {
     //The mandated length is 8
-    char fingerprint[16]        = { 0 };
-    const size_t computedLength = findStringCutoff(pattern, length);
-    bool didMatch               = libinjection_sqli(pattern, computedLength, fingerprint) == 1;
-    bool output                 = didMatch == wantMatch;
+    char fingerprint[16] = { 0 };
+    //The window reported is the one which matched, or the first one
+    const char* window  = pattern;
+    size_t windowLength = 0;
+    bool didMatch       = matchWindows(pattern, length, [&](const char* str, size_t strLength) {
+        const bool matched = libinjection_sqli(str, strLength, fingerprint) == 1;
+        if (matched || str == pattern)
+        {
+            window       = str;
+            windowLength = strLength;
+        }
+        return matched;
+    });
+    bool output = didMatch == wantMatch;
 
     if (output)
     {
-        gatherer.resolvedValue = std::string(pattern, computedLength);
+        gatherer.resolvedValue.assign(window, windowLength);
         if (didMatch)
         {
-            gatherer.matchedValue = std::string(fingerprint);
+            gatherer.matchedValue.assign(fingerprint);
         }
     }
 
@@ -31,12 +41,21 @@ bool LibInjectionSQL::performMatch(const char* pattern, size_t length, MatchGath
 
 bool LibInjectionXSS::performMatch(const char* pattern, size_t length, MatchGatherer& gatherer) const
 {
-    const size_t computedLength = findStringCutoff(pattern, length);
-    bool didMatch               = libinjection_xss(pattern, computedLength) == 1;
-    bool output                 = didMatch == wantMatch;
+    const char* window  = pattern;
+    size_t windowLength = 0;
+    bool didMatch       = matchWindows(pattern, length, [&](const char* str, size_t strLength) {
+        const bool matched = libinjection_xss(str, strLength) == 1;
+        if (matched || str == pattern)
+        {
+            window       = str;
+            windowLength = strLength;
+        }
+        return matched;
+    });
+    bool output = didMatch == wantMatch;
 
     if (output)
-        gatherer.resolvedValue = std::string(pattern, computedLength);
+        gatherer.resolvedValue.assign(window, windowLength);
 
     return output;
 }
@@ -7,8 +7,11 @@
 #include <ac.h>
 
 #include <IPWRuleProcessor.h>
+#include <algorithm>
 #include <exception.hpp>
 #include <stdexcept>
+#include <string_view>
+#include <tuple>
 #include <vector>
 
 PerfMatch::PerfMatch(std::vector<const char*> pattern, std::vector<uint32_t> lengths) : IPWRuleProcessor()
@@ -25,27 +28,213 @@ PerfMatch::PerfMatch(std::vector<const char*> pattern, std::vector<uint32_t> len
     }
 
     ac = std::unique_ptr<ac_t, void (*)(void*)>(ac_, ac_free);
+
+    patterns.reserve(pattern.size());
+    for (size_t i = 0; i < pattern.size(); ++i)
+    {
+        patterns.emplace_back(pattern[i], lengths[i]);
+    }
+}
+
+void PerfMatch::joinGroup(std::shared_ptr<const PerfMatchGroup> group_, uint32_t member)
+{
+    group       = std::move(group_);
+    groupMember = member;
+
+    ac.reset();
+    patterns.clear();
+    patterns.shrink_to_fit();
 }
 
 bool PerfMatch::performMatch(const char* patternValue, size_t patternLength, MatchGatherer& gatherer) const
 {
-    ac_t* acStructure = ac.get();
-    if (patternValue == NULL || patternLength == 0 || acStructure == nullptr)
+    if (patternValue == NULL || patternLength == 0)
         return false;
 
-    ac_result_t result = ac_match(acStructure, patternValue, (uint32_t) patternLength);
+    int32_t matchBegin = -1, matchEnd = -1;
+    if (group != nullptr)
+    {
+        group->match(groupMember, patternValue, (uint32_t) patternLength, gatherer.run, matchBegin, matchEnd);
+    }
+    else
+    {
+        ac_t* acStructure = ac.get();
+        if (acStructure == nullptr)
+            return false;
+
+        ac_result_t result = ac_match(acStructure, patternValue, (uint32_t) patternLength);
+        matchBegin         = result.match_begin;
+        matchEnd           = result.match_end;
+    }
 
-    bool didMatch   = result.match_begin >= 0 && result.match_end >= 0 && result.match_begin < result.match_end;
+    bool didMatch   = matchBegin >= 0 && matchEnd >= 0 && matchBegin < matchEnd;
     bool didSucceed = didMatch == wantMatch;
 
     if (didSucceed)
     {
-        gatherer.resolvedValue = std::string(patternValue, patternLength);
-        if (didMatch && patternLength > (uint32_t) result.match_end)
+        gatherer.resolvedValue.assign(patternValue, patternLength);
+        if (didMatch && patternLength > (uint32_t) matchEnd)
         {
-            gatherer.matchedValue = std::string(&patternValue[result.match_begin], (uint32_t)(result.match_end - result.match_begin + 1));
+            gatherer.matchedValue.assign(&patternValue[matchBegin], (uint32_t)(matchEnd - matchBegin + 1));
         }
     }
 
     return didSucceed;
 }
+
+PerfMatchGroup::PerfMatchGroup(const std::vector<const std::vector<std::string>*>& lists)
+    : members((uint32_t) lists.size())
+{
+    for (const std::vector<std::string>* list : lists)
+    {
+        for (const std::string& pattern : *list)
+        {
+            for (const char c : pattern)
+            {
+                uint16_t& cls = byteClass[(uint8_t) c];
+                if (cls == 0)
+                    cls = classCount++;
+            }
+        }
+    }
+
+    // Build the trie. The root being state 0, it doubles as "no child"
+    std::vector<uint32_t> depth { 0 };
+    std::vector<std::vector<uint32_t>> terminals(1);
+    transitions.assign(classCount, 0);
+
+    for (uint32_t member = 0; member < members; ++member)
+    {
+        for (const std::string& pattern : *lists[member])
+        {
+            // An empty pattern can't produce a match (see performMatch)
+            if (pattern.empty())
+                continue;
+
+            uint32_t state = 0;
+            for (const char c : pattern)
+            {
+                const size_t transition = state * classCount + byteClass[(uint8_t) c];
+                if (transitions[transition] == 0)
+                {
+                    transitions[transition] = states++;
+                    transitions.resize(states * classCount, 0);
+                    depth.push_back(depth[state] + 1);
+                    terminals.emplace_back();
+                }
+                state = transitions[transition];
+            }
+
+            std::vector<uint32_t>& owners = terminals[state];
+            if (std::find(owners.begin(), owners.end(), member) == owners.end())
+                owners.push_back(member);
+        }
+    }
+
+    // Compute the failure links breadth first and complete the transition table
+    std::vector<uint32_t> fail(states, 0);
+    std::vector<uint32_t> queue;
+    queue.reserve(states);
+    for (uint16_t cls = 0; cls < classCount; ++cls)
+    {
+        if (transitions[cls] != 0)
+            queue.push_back(transitions[cls]);
+    }
+
+    for (size_t i = 0; i < queue.size(); ++i)
+    {
+        const uint32_t state = queue[i];
+        for (uint16_t cls = 0; cls < classCount; ++cls)
+        {
+            uint32_t& next          = transitions[state * classCount + cls];
+            const uint32_t fallback = transitions[fail[state] * classCount + cls];
+            if (next != 0)
+            {
+                fail[next] = fallback;
+                queue.push_back(next);
+            }
+            else
+            {
+                next = fallback;
+            }
+        }
+    }
+
+    // Each state outputs the longest pattern of every member ending there, its
+    // own patterns being longer than those inherited through the failure link
+    std::vector<std::vector<std::pair<uint32_t, uint32_t>>> stateOutputs(states);
+    for (const uint32_t state : queue)
+    {
+        auto& current = stateOutputs[state];
+        for (const uint32_t member : terminals[state])
+        {
+            current.emplace_back(member, depth[state]);
+        }
+
+        for (const auto& inherited : stateOutputs[fail[state]])
+        {
+            auto sameMember = [&inherited](const auto& output) { return output.first == inherited.first; };
+            if (std::none_of(current.begin(), current.end(), sameMember))
+                current.push_back(inherited);
+        }
+    }
+
+    outputIndex.reserve(states + 1);
+    for (const auto& current : stateOutputs)
+    {
+        outputIndex.push_back((uint32_t) outputs.size());
+        outputs.insert(outputs.end(), current.begin(), current.end());
+    }
+    outputIndex.push_back((uint32_t) outputs.size());
+}
+
+void PerfMatchGroup::scan(const char* str, uint32_t length, std::vector<result>& results) const
+{
+    results.assign(members, { -1, -1 });
+
+    uint32_t state = 0, found = 0;
+    for (uint32_t i = 0; i < length && found < members; ++i)
+    {
+        state = transitions[state * classCount + byteClass[(uint8_t) str[i]]];
+        for (uint32_t j = outputIndex[state]; j < outputIndex[state + 1]; ++j)
+        {
+            const auto& [member, patternLength] = outputs[j];
+            if (results[member].second < 0)
+            {
+                results[member] = { (int32_t)(i + 1 - patternLength), (int32_t) i };
+                found += 1;
+            }
+        }
+    }
+}
+
+void PerfMatchGroup::find(const char* str, uint32_t length, std::vector<int>& found) const
+{
+    found.clear();
+    std::vector<bool> seen(members, false);
+
+    uint32_t state = 0;
+    for (uint32_t i = 0; i < length && found.size() < members; ++i)
+    {
+        state = transitions[state * classCount + byteClass[(uint8_t) str[i]]];
+        for (uint32_t j = outputIndex[state]; j < outputIndex[state + 1]; ++j)
+        {
+            const uint32_t member = outputs[j].first;
+            if (!seen[member])
+            {
+                seen[member] = true;
+                found.push_back((int) member);
+            }
+        }
+    }
+}
+
+bool PerfMatchGroup::match(uint32_t member, const char* str, uint32_t length, uint64_t run, int32_t& begin, int32_t& end) const
+{
+    const std::vector<result>& results = cache.get(run, str, length, [this](const char* input, size_t inputLength, std::vector<result>& output) {
+        scan(input, (uint32_t) inputLength, output);
+    });
+
+    std::tie(begin, end) = results[member];
+    return end >= 0;
+}
@@ -7,24 +7,75 @@
 #ifndef perf_match_h
 #define perf_match_h
 
+#include <array>
 #include <memory>
+#include <scan_cache.hpp>
 
 #ifndef AC_H
 struct ac_t;
 #endif
 
+class PerfMatchGroup;
+
 class PerfMatch : public IPWRuleProcessor
 {
 public:
     PerfMatch(std::vector<const char*> pattern, std::vector<uint32_t> lengths);
     std::string_view operatorName() const override { return name; }
 
+    const std::vector<std::string>& getPatterns() const { return patterns; }
+    // Delegate the matching to an automaton shared with other phrase_match,
+    // the private automaton and the patterns are released
+    void joinGroup(std::shared_ptr<const PerfMatchGroup> group, uint32_t member);
+
 protected:
     bool performMatch(const char* patternValue, size_t patternLength, MatchGatherer& gatherer) const override;
 
 protected:
     static constexpr std::string_view name { "phrase_match" };
     std::unique_ptr<ac_t, void (*)(void*)> ac { nullptr, nullptr };
+    std::vector<std::string> patterns;
+    std::shared_ptr<const PerfMatchGroup> group;
+    uint32_t groupMember { 0 };
+};
+
+// Aho-Corasick automaton combining the phrase lists of several PerfMatch.
+// Each output of the automaton maps back to the member owning the pattern, so
+// a single scan of an input provides the result of every member, kept in a
+// scan_cache for the other members fed the same input during the run.
+class PerfMatchGroup
+{
+public:
+    PerfMatchGroup(const std::vector<const std::vector<std::string>*>& lists);
+
+    // Same semantic as ac_match, restricted to the patterns of the member:
+    // bounds (inclusive) of the longest pattern ending the earliest
+    bool match(uint32_t member, const char* str, uint32_t length, uint64_t run, int32_t& begin, int32_t& end) const;
+    // Members having at least one pattern in the input, not going through
+    // the scan_cache
+    void find(const char* str, uint32_t length, std::vector<int>& found) const;
+
+    uint32_t memberCount() const { return members; }
+    uint32_t stateCount() const { return states; }
+
+protected:
+    using result = std::pair<int32_t, int32_t>;
+
+    void scan(const char* str, uint32_t length, std::vector<result>& results) const;
+
+    ddwaf::scan_cache<std::vector<result>> cache;
+    uint32_t members;
+    uint32_t states { 1 };
+
+    // Bytes used by the patterns each have their own class, others share class 0
+    std::array<uint16_t, 256> byteClass {};
+    uint16_t classCount { 1 };
+
+    // Complete transition table, indexed by state * classCount + class
+    std::vector<uint32_t> transitions;
+    // Outputs of the state i: (member, pattern length) in [outputs[outputIndex[i]], outputs[outputIndex[i + 1]])
+    std::vector<uint32_t> outputIndex;
+    std::vector<std::pair<uint32_t, uint32_t>> outputs;
 };
 
 #endif /* perf_match_h */
@@ -5,15 +5,75 @@
 // Copyright 2021 Datadog, Inc.
 
 #include <IPWRuleProcessor.h>
+#include <array>
+#include <atomic>
+#include <mutex>
 #include <exception.hpp>
+#include <log.hpp>
+#include <simd.hpp>
+#include <stdexcept>
+#include <string_view>
 #include <utils.h>
 
 using namespace ddwaf;
 
+namespace
+{
+
+// Searches of the thread whose DFA ran out of memory, as reported by RE2
+thread_local uint64_t dfaFailures = 0;
+
+void onDFASearchFailure(const re2::hooks::DFASearchFailure&)
+{
+    ++dfaFailures;
+}
+
+// The hook is process wide
+void installHooks()
+{
+    static std::once_flag once;
+    std::call_once(once, [] { re2::hooks::SetDFASearchFailureHook(onDFASearchFailure); });
+}
+
+// Typical inputs, along with every byte value, to reach the DFA states most
+// requests go through
+const std::vector<std::string>& warmUpCorpus()
+{
+    static const std::vector<std::string> corpus = [] {
+        std::vector<std::string> inputs {
+            "",
+            "/",
+            "/index.html",
+            "/api/v1/users/42?page=2&sort=name",
+            "Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/91.0 Safari/537.36",
+            "application/x-www-form-urlencoded; charset=UTF-8",
+            "{\"id\": 1, \"name\": \"John Doe\", \"email\": \"john@example.com\"}",
+            "session=6f1ed002ab5595859014ebf0951522d9; lang=en-US",
+            "1' OR '1'='1' -- ",
+            "<script>alert(document.cookie)</script>",
+            "../../../../etc/passwd",
+            "${jndi:ldap://example.com/a}",
+        };
+
+        std::string bytes;
+        for (unsigned c = 0; c < 256; ++c)
+        {
+            bytes.push_back((char) c);
+        }
+        inputs.push_back(std::move(bytes));
+        return inputs;
+    }();
+    return corpus;
+}
+
+}
+
 RE2Manager::RE2Manager(const std::string& regex_str, bool caseSensitive) : IPWRuleProcessor()
 {
+    installHooks();
+
     re2::RE2::Options options;
-    options.set_max_mem(512 * 1024);
+    options.set_max_mem(defaultMaxMemory);
     options.set_log_errors(false);
     options.set_case_sensitive(caseSensitive);
 
@@ -32,25 +92,32 @@ bool RE2Manager::performMatch(const char* str, size_t length, MatchGatherer& gat
     if (!regex->ok())
         return false;
 
-    const size_t computedLength = findStringCutoff(str, length);
+    //The DFA runs over the whole evaluated length at once, its state carrying
+    //	from one window to the next
+    const size_t computedLength = findStringCutoff(str, length, (size_t) maxStringLength);
     const re2::StringPiece ref(str, computedLength);
     re2::StringPiece match[MAX_MATCH_COUNT];
-    bool didMatch = regex->Match(ref,
-                                 0,
-                                 computedLength,
-                                 re2::RE2::UNANCHORED,
-                                 match,
-                                 gatherer.submatchToGather.empty() ? 1 : groupsToCatch);
+    bool didMatch = false;
+    if (group == nullptr || group->isCandidate(groupMember, str, computedLength, gatherer.run))
+    {
+        didMatch = search(ref, match, gatherer.submatchToGather.empty() ? 1 : groupsToCatch);
+    }
 
     //Copy on match
     bool output = didMatch == wantMatch;
 
     if (output)
     {
-        gatherer.resolvedValue = std::string(str, computedLength);
+        //Only a window of the input is reported: the first one, or the one starting
+        //	with the match if it ends past the first one
+        size_t windowStart = 0;
+        if (didMatch && (size_t) (match[0].end() - str) > findStringCutoff(str, computedLength))
+            windowStart = (size_t) (match[0].data() - str);
+
+        gatherer.resolvedValue.assign(str + windowStart, findStringCutoff(str + windowStart, computedLength - windowStart));
         if (didMatch)
         {
-            gatherer.matchedValue = match[0].as_string();
+            gatherer.matchedValue.assign(match[0].data(), match[0].size());
             if (!gatherer.submatchToGather.empty())
             {
                 gatherer.submatches.clear();
@@ -61,7 +128,7 @@ bool RE2Manager::performMatch(const char* str, size_t length, MatchGatherer& gat
                         break;
                     }
 
-                    gatherer.submatches.emplace_back(subMatch, match[subMatch].as_string());
+                    gatherer.submatches.emplace_back(subMatch, ddwaf::arena_string(match[subMatch].data(), match[subMatch].size(), gatherer.submatches.get_allocator()));
                 }
             }
         }
@@ -70,6 +137,60 @@ bool RE2Manager::performMatch(const char* str, size_t length, MatchGatherer& gat
     return output;
 }
 
+bool RE2Manager::search(const re2::StringPiece& input, re2::StringPiece* match, int matchCount) const
+{
+    const uint64_t failures = dfaFailures;
+    const bool didMatch     = regex->Match(input, 0, input.size(), re2::RE2::UNANCHORED, match, matchCount);
+    if (dfaFailures != failures)
+    {
+        fallbacks.fetch_add(1, std::memory_order_relaxed);
+    }
+    return didMatch;
+}
+
+bool RE2Manager::setMaxMemory(int64_t bytes)
+{
+    re2::RE2::Options options(regex->options());
+    options.set_max_mem(bytes);
+
+    auto resized = std::make_unique<re2::RE2>(regex->pattern(), options);
+    if (!resized->ok())
+    {
+        return false;
+    }
+
+    regex = std::move(resized);
+    return true;
+}
+
+int64_t RE2Manager::fitMaxMemory(int64_t bytes)
+{
+    bytes = std::max<int64_t>(bytes, 1);
+    while (!setMaxMemory(bytes) && bytes < defaultMaxMemory)
+    {
+        bytes *= 2;
+    }
+
+    return regex->options().max_mem();
+}
+
+void RE2Manager::warmUp() const
+{
+    // The submatch forces the search of the start of the match, as run by
+    //	performMatch, which has its own DFA
+    re2::StringPiece match;
+    for (const std::string& input : warmUpCorpus())
+    {
+        search(input, &match, 1);
+    }
+}
+
+void RE2Manager::joinGroup(std::shared_ptr<const RE2ManagerGroup> group_, uint32_t member)
+{
+    group       = std::move(group_);
+    groupMember = member;
+}
+
 bool RE2Manager::hasStringRepresentation() const
 {
     return true;
@@ -79,3 +200,216 @@ const std::string RE2Manager::getStringRepresentation() const
 {
     return regex->pattern();
 }
+
+RE2ManagerGroup::RE2ManagerGroup(const std::vector<const re2::RE2*>& regexes, bool caseSensitive, int64_t maxMemory)
+    : members((uint32_t) regexes.size())
+{
+    // The copies only hold their program, a fraction of the budget is enough
+    // for most of them, the others get up to the budget of their member
+    const int64_t copyMemory = std::max<int64_t>(maxMemory / (4 * (int64_t) members), 1);
+
+    // Shorter atoms would let most inputs through
+    filter = std::make_unique<re2::FilteredRE2>(3);
+    for (const re2::RE2* regex : regexes)
+    {
+        re2::RE2::Options options(regex->options());
+        if (maxMemory != 0)
+        {
+            options.set_max_mem(std::min(copyMemory, regex->options().max_mem()));
+        }
+
+        int member;
+        re2::RE2::ErrorCode error;
+        while ((error = filter->Add(regex->pattern(), options, &member)) == re2::RE2::ErrorPatternTooLarge && options.max_mem() < regex->options().max_mem())
+        {
+            options.set_max_mem(std::min(options.max_mem() * 2, regex->options().max_mem()));
+        }
+
+        if (error != re2::RE2::NoError)
+        {
+            throw std::runtime_error("failed to add regular expression to filter: " + regex->pattern());
+        }
+        memory += options.max_mem();
+    }
+
+    std::vector<std::string> strings;
+    filter->Compile(&strings);
+
+    const bool ascii = std::all_of(strings.begin(), strings.end(), [](const std::string& atom) {
+        return std::all_of(atom.begin(), atom.end(), [](char c) { return (c & 0x80) == 0; });
+    });
+
+    if (ascii)
+    {
+        // The members passing the filter without any atom have none
+        std::vector<int> potentials;
+        filter->AllPotentials({}, &potentials);
+        unfiltered.assign(potentials.begin(), potentials.end());
+
+        // Whether a member folds the case can be set within the pattern, any
+        // flag is assumed to do so
+        for (uint32_t member = 0; member < members; ++member)
+        {
+            const bool isUnfiltered = std::find(unfiltered.begin(), unfiltered.end(), member) != unfiltered.end();
+            if (!isUnfiltered && (!caseSensitive || regexes[member]->pattern().find("(?") != std::string::npos))
+            {
+                folding.push_back(member);
+            }
+        }
+    }
+    else
+    {
+        filter.reset();
+        unfiltered.resize(members);
+        for (uint32_t member = 0; member < members; ++member)
+        {
+            unfiltered[member] = member;
+        }
+    }
+
+    if (filter != nullptr && !strings.empty())
+    {
+        std::vector<std::vector<std::string>> lists;
+        std::vector<const std::vector<std::string>*> listPointers;
+        lists.reserve(strings.size());
+        for (std::string& atom : strings)
+        {
+            lists.push_back({ std::move(atom) });
+            listPointers.push_back(&lists.back());
+        }
+        atoms = std::make_unique<PerfMatchGroup>(listPointers);
+    }
+
+    if (unfiltered.size() < 2)
+        return;
+
+    int64_t membersMemory = 0;
+    for (const uint32_t member : unfiltered)
+    {
+        membersMemory += regexes[member]->options().max_mem();
+    }
+
+    auto build = [&](int64_t setMemory) -> std::unique_ptr<re2::RE2::Set> {
+        re2::RE2::Options options;
+        options.set_max_mem(setMemory);
+        options.set_log_errors(false);
+        options.set_case_sensitive(caseSensitive);
+
+        auto candidate = std::make_unique<re2::RE2::Set>(options, re2::RE2::UNANCHORED);
+        for (const uint32_t member : unfiltered)
+        {
+            std::string error;
+            if (candidate->Add(regexes[member]->pattern(), &error) < 0)
+            {
+                throw std::runtime_error("failed to add regular expression to set: " + error);
+            }
+        }
+
+        return candidate->Compile() ? std::move(candidate) : nullptr;
+    };
+
+    // The rest of the budget, doubled until the set compiles, up to the budget of its members
+    int64_t setMemory = maxMemory == 0 ? membersMemory : std::max<int64_t>(maxMemory - memory, 1);
+    while ((set = build(setMemory)) == nullptr && setMemory < membersMemory)
+    {
+        setMemory = std::min(setMemory * 2, membersMemory);
+    }
+
+    if (set == nullptr)
+    {
+        throw std::runtime_error("failed to compile regular expression set");
+    }
+    memory += setMemory;
+}
+
+void RE2ManagerGroup::scan(const char* str, size_t length, std::vector<bool>& candidates) const
+{
+    candidates.assign(members, false);
+
+    if (filter != nullptr)
+    {
+        // The atoms are lowercase
+        thread_local std::string lowercase;
+        thread_local std::vector<int> found;
+        found.clear();
+        if (atoms != nullptr)
+        {
+            lowercase.assign(str, length);
+            ddwaf::simd::lowercase(lowercase.data(), lowercase.size());
+            atoms->find(lowercase.data(), (uint32_t) lowercase.size(), found);
+        }
+
+        std::vector<int> potentials;
+        filter->AllPotentials(found, &potentials);
+        for (const int member : potentials)
+        {
+            candidates[member] = true;
+        }
+
+        // RE2 folds the case with the Unicode rules, the Kelvin sign (U+212A)
+        // matching k and the long s (U+017F) matching s, while the atoms are
+        // only looked for in the input lowercased as ASCII
+        if (!folding.empty() && ddwaf::simd::find_range(str, length, 0x80, 0xff) != length)
+        {
+            for (const uint32_t member : folding)
+            {
+                candidates[member] = true;
+            }
+        }
+    }
+
+    if (set == nullptr)
+    {
+        // A single unfiltered member runs its own match
+        for (const uint32_t member : unfiltered)
+        {
+            candidates[member] = true;
+        }
+        return;
+    }
+
+    std::vector<int> matches;
+    re2::RE2::Set::ErrorInfo error;
+    if (!set->Match(re2::StringPiece(str, length), &matches, &error) && error.kind != re2::RE2::Set::kNoError)
+    {
+        // The DFA ran out of memory, let every unfiltered member run its own match
+        DDWAF_DEBUG("Regular expression set failed to run (%d)", error.kind);
+        if (error.kind == re2::RE2::Set::kOutOfMemory)
+        {
+            fallbacks.fetch_add(1, std::memory_order_relaxed);
+        }
+        for (const uint32_t member : unfiltered)
+        {
+            candidates[member] = true;
+        }
+        return;
+    }
+
+    for (const uint32_t member : unfiltered)
+    {
+        candidates[member] = false;
+    }
+
+    for (const int index : matches)
+    {
+        candidates[unfiltered[index]] = true;
+    }
+}
+
+void RE2ManagerGroup::warmUp() const
+{
+    std::vector<bool> candidates;
+    for (const std::string& input : warmUpCorpus())
+    {
+        scan(input.data(), input.size(), candidates);
+    }
+}
+
+bool RE2ManagerGroup::isCandidate(uint32_t member, const char* str, size_t length, uint64_t run) const
+{
+    const std::vector<bool>& candidates = cache.get(run, str, length, [this](const char* input, size_t inputLength, std::vector<bool>& output) {
+        scan(input, inputLength, output);
+    });
+
+    return candidates[member];
+}
@@ -7,30 +7,109 @@
 #ifndef re2_hpp
 #define re2_hpp
 
+#include <atomic>
 #include <memory>
+#include <re2/filtered_re2.h>
 #include <re2/re2.h>
+#include <re2/set.h>
+#include <scan_cache.hpp>
 
 #include <utils.h>
 
+class RE2ManagerGroup;
+
 class RE2Manager : public IPWRuleProcessor
 {
 public:
+    // Memory budget of a regular expression unless told otherwise
+    static constexpr int64_t defaultMaxMemory { 512 * 1024 };
+
     RE2Manager(const std::string& regex_str, bool caseSensitive);
     ~RE2Manager() = default;
 
     bool hasStringRepresentation() const override;
     const std::string getStringRepresentation() const override;
     std::string_view operatorName() const override { return name; }
+
+    const re2::RE2& getRegex() const { return *regex; }
+    // Only run the full match if the set shared with other match_regex reports a match
+    void joinGroup(std::shared_ptr<const RE2ManagerGroup> group, uint32_t member);
+    const std::shared_ptr<const RE2ManagerGroup>& getGroup() const { return group; }
+
+    // Recompile the regular expression within the budget, which must happen
+    // before joining a group. The previous one is kept if it doesn't fit.
+    bool setMaxMemory(int64_t bytes);
+    // Same as above with the smallest budget, doubling from bytes, the regular
+    // expression compiles in. Returns the budget of the regular expression.
+    int64_t fitMaxMemory(int64_t bytes);
+    // Build the DFA states reached by a few typical inputs
+    void warmUp() const;
+    // Searches which ran out of DFA memory and fell back to a slower engine
+    uint64_t dfaFallbacks() const { return fallbacks.load(std::memory_order_relaxed); }
 #ifdef TESTING
     FRIEND_TEST(TestOptions, TestInit);
 #endif
 protected:
     bool performMatch(const char* str, size_t length, MatchGatherer& gatherer) const override;
+    bool search(const re2::StringPiece& input, re2::StringPiece* match, int matchCount) const;
 
 protected:
     static constexpr std::string_view name { "match_regex" };
     uint8_t groupsToCatch { 0 };
     std::unique_ptr<re2::RE2> regex { nullptr };
+    std::shared_ptr<const RE2ManagerGroup> group;
+    uint32_t groupMember { 0 };
+    mutable std::atomic<uint64_t> fallbacks { 0 };
+};
+
+// Prefilter combining the regular expressions of several RE2Manager sharing
+// the same case sensitivity. FilteredRE2 extracts the literals (atoms) that
+// must be in an input for each regular expression to match, the atoms of the
+// whole group being looked for in a single Aho-Corasick scan of the input.
+// Only the members whose atom formula holds run the capturing match. Members
+// without atoms are instead prefiltered through a RE2::Set, as are all of
+// them if an atom isn't ASCII (the input is lowercased bytewise to look for
+// the atoms). Without a budget, the set gets the budget of its members. With
+// one, the copies of the regular expressions compiled by FilteredRE2, which
+// never run, get a small part of it and the set the rest. The candidates
+// of an input are kept in a scan_cache for the other members fed the same
+// input during the run.
+class RE2ManagerGroup
+{
+public:
+    RE2ManagerGroup(const std::vector<const re2::RE2*>& regexes, bool caseSensitive, int64_t maxMemory = 0);
+
+    bool isCandidate(uint32_t member, const char* str, size_t length, uint64_t run) const;
+
+    uint32_t memberCount() const { return members; }
+    // Members prefiltered by their atoms, the others going through the set
+    uint32_t prefilteredCount() const { return members - (uint32_t) unfiltered.size(); }
+    uint32_t atomCount() const { return atoms == nullptr ? 0 : atoms->memberCount(); }
+    // Memory budget of the copies compiled by the filter and of the set
+    int64_t maxMemory() const { return memory; }
+
+    // Build the DFA states of the set reached by a few typical inputs
+    void warmUp() const;
+    // Scans of the set which ran out of DFA memory, every unfiltered member
+    // then running its own match
+    uint64_t dfaFallbacks() const { return fallbacks.load(std::memory_order_relaxed); }
+
+protected:
+    void scan(const char* str, size_t length, std::vector<bool>& candidates) const;
+
+    ddwaf::scan_cache<std::vector<bool>> cache;
+    uint32_t members;
+    std::unique_ptr<re2::FilteredRE2> filter;
+    // One member per atom
+    std::unique_ptr<PerfMatchGroup> atoms;
+    std::vector<uint32_t> unfiltered;
+    // Prefiltered members which may fold the case, candidates for any input
+    // which isn't ASCII
+    std::vector<uint32_t> folding;
+    // Over the unfiltered members, if there's more than one
+    std::unique_ptr<re2::RE2::Set> set;
+    int64_t memory { 0 };
+    mutable std::atomic<uint64_t> fallbacks { 0 };
 };
 
 #endif /* re2_hpp */
@@ -0,0 +1,90 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#ifndef SCAN_CACHE_H
+#define SCAN_CACHE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace ddwaf
+{
+
+// Results of the scans of a group of operators, kept per thread as the
+// members of a group are usually fed the same input one after the other.
+// Within a run (see MatchGatherer::run), an input keeps its address: the
+// results are keyed on the address and length of the input and on the run,
+// the input is neither copied nor compared. Outside of a run, every lookup
+// scans the input.
+template <typename Result>
+class scan_cache
+{
+public:
+    scan_cache() : group(++groupCounter()) {}
+
+    scan_cache(const scan_cache&) = delete;
+    scan_cache& operator=(const scan_cache&) = delete;
+
+    // Scan is called as scan(str, length, Result&) on a miss
+    template <typename Scan>
+    const Result& get(uint64_t run, const char* str, size_t length, Scan&& scan) const
+    {
+        thread_local std::array<entry, slotCount> entries;
+        thread_local Result scratch;
+
+        if (run == 0)
+        {
+            scan(str, length, scratch);
+            return scratch;
+        }
+
+        entry& slot = entries[slotOf(run, str, length)];
+        if (slot.group != group || slot.run != run || slot.str != str || slot.length != length)
+        {
+            slot.group  = group;
+            slot.run    = run;
+            slot.str    = str;
+            slot.length = length;
+            scan(str, length, slot.result);
+        }
+
+        return slot.result;
+    }
+
+protected:
+    // Direct mapped, the groups share the slots
+    static constexpr size_t slotCount = 64;
+
+    struct entry
+    {
+        uint64_t group { 0 };
+        uint64_t run { 0 };
+        const char* str { nullptr };
+        size_t length { 0 };
+        Result result;
+    };
+
+    size_t slotOf(uint64_t run, const char* str, size_t length) const
+    {
+        const uint64_t key = (uint64_t) (uintptr_t) str ^ (group << 32) ^ (run << 16) ^ length;
+        // Fibonacci hashing, the high bits select the slot
+        return (size_t) ((key * 0x9E3779B97F4A7C15ULL) >> 58);
+    }
+
+    static std::atomic<uint64_t>& groupCounter()
+    {
+        static std::atomic<uint64_t> counter { 0 };
+        return counter;
+    }
+
+    uint64_t group;
+};
+
+}
+
+#endif /* SCAN_CACHE_H */
@@ -0,0 +1,757 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+
+#include <simd.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DDWAF_SIMD_SSE2
+#include <emmintrin.h>
+// AVX2 is only built with compilers letting us enable it per function
+#if defined(__GNUC__) || defined(__clang__)
+#define DDWAF_SIMD_AVX2
+#include <immintrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define DDWAF_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace ddwaf::simd
+{
+
+namespace
+{
+
+[[maybe_unused]] inline unsigned countTrailingZeros(uint64_t value)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return index;
+#else
+    return (unsigned) __builtin_ctzll(value);
+#endif
+}
+
+// Scalar reference, also used for the tail of the vectorized kernels
+
+size_t scalarFindRange(const char* data, size_t length, unsigned char lo, unsigned char hi)
+{
+    const unsigned char span = hi - lo;
+    for (size_t i = 0; i < length; ++i)
+    {
+        if ((unsigned char) ((unsigned char) data[i] - lo) <= span)
+            return i;
+    }
+    return length;
+}
+
+size_t scalarFindEither(const char* data, size_t length, unsigned char a, unsigned char b)
+{
+    for (size_t i = 0; i < length; ++i)
+    {
+        if ((unsigned char) data[i] == a || (unsigned char) data[i] == b)
+            return i;
+    }
+    return length;
+}
+
+size_t scalarFindSet(const char* data, size_t length, const byte_set& set)
+{
+    for (size_t i = 0; i < length; ++i)
+    {
+        if (set.contains((uint8_t) data[i]))
+            return i;
+    }
+    return length;
+}
+
+// Resume the scan at start >= 1
+size_t scalarFindPairFrom(const char* data, size_t length, unsigned char c, size_t start)
+{
+    for (size_t i = start; i < length; ++i)
+    {
+        if ((unsigned char) data[i] == c && (unsigned char) data[i - 1] == c)
+            return i;
+    }
+    return length;
+}
+
+size_t scalarFindPair(const char* data, size_t length, unsigned char c)
+{
+    return scalarFindPairFrom(data, length, c, 1);
+}
+
+// Resume the search at start
+size_t scalarFindSubstringFrom(const char* data, size_t length, const char* needle, size_t needleLength, size_t start)
+{
+    if (needleLength == 0)
+        return start;
+
+    for (size_t i = start; i + needleLength <= length; ++i)
+    {
+        if (data[i] == needle[0] && memcmp(data + i + 1, needle + 1, needleLength - 1) == 0)
+            return i;
+    }
+    return length;
+}
+
+size_t scalarFindSubstring(const char* data, size_t length, const char* needle, size_t needleLength)
+{
+    return scalarFindSubstringFrom(data, length, needle, needleLength, 0);
+}
+
+void scalarLowercase(char* data, size_t length)
+{
+    for (size_t i = 0; i < length; ++i)
+    {
+        if (data[i] >= 'A' && data[i] <= 'Z')
+            data[i] += 'a' - 'A';
+    }
+}
+
+// 63 is encoded as '-' by the base64Encode transformer but only '/' is decoded
+constexpr char base64Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+-";
+
+struct base64_values
+{
+    int8_t values[256];
+
+    constexpr base64_values() : values()
+    {
+        for (int8_t& value : values)
+            value = -1;
+        for (int8_t i = 0; i < 63; ++i)
+            values[(uint8_t) base64Alphabet[i]] = i;
+        values['/'] = 63;
+    }
+};
+
+constexpr base64_values base64Reverse;
+
+size_t scalarBase64Decode(const char* data, size_t length, char* out, size_t& consumed)
+{
+    size_t read = 0, write = 0;
+    for (; read + 4 <= length; read += 4)
+    {
+        const int32_t a = base64Reverse.values[(uint8_t) data[read]];
+        const int32_t b = base64Reverse.values[(uint8_t) data[read + 1]];
+        const int32_t c = base64Reverse.values[(uint8_t) data[read + 2]];
+        const int32_t d = base64Reverse.values[(uint8_t) data[read + 3]];
+        if ((a | b | c | d) < 0)
+            break;
+
+        const uint32_t value = (uint32_t) (a << 18 | b << 12 | c << 6 | d);
+        out[write++]         = (char) (value >> 16);
+        out[write++]         = (char) (value >> 8);
+        out[write++]         = (char) value;
+    }
+
+    consumed = read;
+    return write;
+}
+
+size_t scalarBase64Encode(const char* data, size_t length, char* out)
+{
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+
+    size_t read = 0, write = 0;
+    for (; read + 3 <= length; read += 3)
+    {
+        const uint32_t value = (uint32_t) bytes[read] << 16 | (uint32_t) bytes[read + 1] << 8 | bytes[read + 2];
+        out[write++]         = base64Alphabet[value >> 18];
+        out[write++]         = base64Alphabet[(value >> 12) & 0x3f];
+        out[write++]         = base64Alphabet[(value >> 6) & 0x3f];
+        out[write++]         = base64Alphabet[value & 0x3f];
+    }
+
+    return read;
+}
+
+#ifdef DDWAF_SIMD_SSE2
+
+// Unsigned (v - lo) <= span, SSE2 only has signed comparisons
+inline __m128i sse2InRange(__m128i v, __m128i lo, __m128i span)
+{
+    const __m128i offset = _mm_sub_epi8(v, lo);
+    return _mm_cmpeq_epi8(_mm_min_epu8(offset, span), offset);
+}
+
+size_t sse2FindRange(const char* data, size_t length, unsigned char lo, unsigned char hi)
+{
+    const __m128i loVec   = _mm_set1_epi8((char) lo);
+    const __m128i spanVec = _mm_set1_epi8((char) (hi - lo));
+
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const int mask  = _mm_movemask_epi8(sse2InRange(v, loVec, spanVec));
+        if (mask != 0)
+            return i + countTrailingZeros((uint64_t) mask);
+    }
+
+    return i + scalarFindRange(data + i, length - i, lo, hi);
+}
+
+size_t sse2FindEither(const char* data, size_t length, unsigned char a, unsigned char b)
+{
+    const __m128i aVec = _mm_set1_epi8((char) a);
+    const __m128i bVec = _mm_set1_epi8((char) b);
+
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const int mask  = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, aVec), _mm_cmpeq_epi8(v, bVec)));
+        if (mask != 0)
+            return i + countTrailingZeros((uint64_t) mask);
+    }
+
+    return i + scalarFindEither(data + i, length - i, a, b);
+}
+
+size_t sse2FindPair(const char* data, size_t length, unsigned char c)
+{
+    const __m128i needle = _mm_set1_epi8((char) c);
+
+    size_t i = 1;
+    for (; i + 16 <= length; i += 16)
+    {
+        const __m128i previous = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i - 1));
+        const __m128i current  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const int mask         = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(previous, needle), _mm_cmpeq_epi8(current, needle)));
+        if (mask != 0)
+            return i + countTrailingZeros((uint64_t) mask);
+    }
+
+    return scalarFindPairFrom(data, length, c, i);
+}
+
+// Candidates have both the first and the last byte of the needle in place,
+// only the bytes in between are left to compare
+size_t sse2FindSubstring(const char* data, size_t length, const char* needle, size_t needleLength)
+{
+    if (needleLength < 2)
+        return needleLength == 0 ? 0 : sse2FindRange(data, length, (unsigned char) needle[0], (unsigned char) needle[0]);
+
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last  = _mm_set1_epi8(needle[needleLength - 1]);
+
+    size_t i = 0;
+    for (; i + needleLength + 15 <= length; i += 16)
+    {
+        const __m128i head = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const __m128i tail = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + needleLength - 1));
+        uint32_t mask      = (uint32_t) _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(head, first), _mm_cmpeq_epi8(tail, last)));
+        for (; mask != 0; mask &= mask - 1)
+        {
+            const size_t candidate = i + countTrailingZeros(mask);
+            if (memcmp(data + candidate + 1, needle + 1, needleLength - 2) == 0)
+                return candidate;
+        }
+    }
+
+    return scalarFindSubstringFrom(data, length, needle, needleLength, i);
+}
+
+void sse2Lowercase(char* data, size_t length)
+{
+    const __m128i upperA = _mm_set1_epi8('A');
+    const __m128i span   = _mm_set1_epi8('Z' - 'A');
+    const __m128i bit    = _mm_set1_epi8(0x20);
+
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        v         = _mm_or_si128(v, _mm_and_si128(sse2InRange(v, upperA, span), bit));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), v);
+    }
+
+    scalarLowercase(data + i, length - i);
+}
+
+// SSE2 has no byte shuffle, the set lookup and base64 stay scalar
+const kernels sse2Kernels { sse2FindRange, sse2FindEither, scalarFindSet, sse2FindPair, sse2FindSubstring, sse2Lowercase, scalarBase64Decode, scalarBase64Encode };
+
+#endif
+
+#ifdef DDWAF_SIMD_AVX2
+
+__attribute__((target("avx2"))) inline __m256i avx2InRange(__m256i v, __m256i lo, __m256i span)
+{
+    const __m256i offset = _mm256_sub_epi8(v, lo);
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(offset, span), offset);
+}
+
+__attribute__((target("avx2"))) size_t avx2FindRange(const char* data, size_t length, unsigned char lo, unsigned char hi)
+{
+    const __m256i loVec   = _mm256_set1_epi8((char) lo);
+    const __m256i spanVec = _mm256_set1_epi8((char) (hi - lo));
+
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32)
+    {
+        const __m256i v     = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        const uint32_t mask = (uint32_t) _mm256_movemask_epi8(avx2InRange(v, loVec, spanVec));
+        if (mask != 0)
+            return i + countTrailingZeros(mask);
+    }
+
+    return i + sse2FindRange(data + i, length - i, lo, hi);
+}
+
+__attribute__((target("avx2"))) size_t avx2FindEither(const char* data, size_t length, unsigned char a, unsigned char b)
+{
+    const __m256i aVec = _mm256_set1_epi8((char) a);
+    const __m256i bVec = _mm256_set1_epi8((char) b);
+
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32)
+    {
+        const __m256i v     = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        const uint32_t mask = (uint32_t) _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, aVec), _mm256_cmpeq_epi8(v, bVec)));
+        if (mask != 0)
+            return i + countTrailingZeros(mask);
+    }
+
+    return i + sse2FindEither(data + i, length - i, a, b);
+}
+
+// Classify 32 bytes at once: the low nibble selects the row of the set, the
+// high nibble the bit within the row
+__attribute__((target("avx2"))) size_t avx2FindSet(const char* data, size_t length, const byte_set& set)
+{
+    const __m256i lowRows  = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(set.bits)));
+    const __m256i highRows = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(set.bits + 16)));
+    const __m256i bitOf    = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, (char) 128, 1, 2, 4, 8, 16, 32, 64, (char) 128,
+                                              1, 2, 4, 8, 16, 32, 64, (char) 128, 1, 2, 4, 8, 16, 32, 64, (char) 128);
+    const __m256i nibble   = _mm256_set1_epi8(0x0f);
+
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32)
+    {
+        const __m256i v     = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        const __m256i low   = _mm256_and_si256(v, nibble);
+        const __m256i high  = _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble);
+        // Bytes >= 0x80 have their top bit set, which selects the second half of the set
+        const __m256i row   = _mm256_blendv_epi8(_mm256_shuffle_epi8(lowRows, low), _mm256_shuffle_epi8(highRows, low), v);
+        const __m256i bit   = _mm256_shuffle_epi8(bitOf, high);
+        const uint32_t mask = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(row, bit), bit));
+        if (mask != 0)
+            return i + countTrailingZeros(mask);
+    }
+
+    return i + scalarFindSet(data + i, length - i, set);
+}
+
+__attribute__((target("avx2"))) size_t avx2FindPair(const char* data, size_t length, unsigned char c)
+{
+    const __m256i needle = _mm256_set1_epi8((char) c);
+
+    size_t i = 1;
+    for (; i + 32 <= length; i += 32)
+    {
+        const __m256i previous = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i - 1));
+        const __m256i current  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        const uint32_t mask    = (uint32_t) _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(previous, needle), _mm256_cmpeq_epi8(current, needle)));
+        if (mask != 0)
+            return i + countTrailingZeros(mask);
+    }
+
+    return scalarFindPairFrom(data, length, c, i);
+}
+
+__attribute__((target("avx2"))) size_t avx2FindSubstring(const char* data, size_t length, const char* needle, size_t needleLength)
+{
+    if (needleLength < 2)
+        return needleLength == 0 ? 0 : avx2FindRange(data, length, (unsigned char) needle[0], (unsigned char) needle[0]);
+
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last  = _mm256_set1_epi8(needle[needleLength - 1]);
+
+    size_t i = 0;
+    for (; i + needleLength + 31 <= length; i += 32)
+    {
+        const __m256i head = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        const __m256i tail = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + needleLength - 1));
+        uint32_t mask      = (uint32_t) _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(head, first), _mm256_cmpeq_epi8(tail, last)));
+        for (; mask != 0; mask &= mask - 1)
+        {
+            const size_t candidate = i + countTrailingZeros(mask);
+            if (memcmp(data + candidate + 1, needle + 1, needleLength - 2) == 0)
+                return candidate;
+        }
+    }
+
+    return scalarFindSubstringFrom(data, length, needle, needleLength, i);
+}
+
+__attribute__((target("avx2"))) void avx2Lowercase(char* data, size_t length)
+{
+    const __m256i upperA = _mm256_set1_epi8('A');
+    const __m256i span   = _mm256_set1_epi8('Z' - 'A');
+    const __m256i bit    = _mm256_set1_epi8(0x20);
+
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        v         = _mm256_or_si256(v, _mm256_and_si256(avx2InRange(v, upperA, span), bit));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + i), v);
+    }
+
+    sse2Lowercase(data + i, length - i);
+}
+
+// 32 characters to 24 bytes. The characters are validated and translated to
+// their 6 bits value with nibble lookups, then packed with multiply-adds.
+__attribute__((target("avx2"))) size_t avx2Base64Decode(const char* data, size_t length, char* out, size_t& consumed)
+{
+    // A byte is invalid if the rows of its low and high nibbles share a bit
+    const __m256i lowLut   = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+                                              0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+    const __m256i highLut  = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                                              0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    // Offset to the value, by high nibble ('/' being moved to its own row)
+    const __m256i rollLut  = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+                                              0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i slash    = _mm256_set1_epi8(0x2f);
+    const __m256i pack     = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                              2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    const __m256i compact  = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, -1, -1);
+
+    size_t read = 0, write = 0;
+    for (; read + 32 <= length; read += 32, write += 24)
+    {
+        const __m256i v    = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + read));
+        const __m256i high = _mm256_and_si256(_mm256_srli_epi32(v, 4), slash);
+        const __m256i low  = _mm256_and_si256(v, slash);
+        if (!_mm256_testz_si256(_mm256_shuffle_epi8(lowLut, low), _mm256_shuffle_epi8(highLut, high)))
+            break;
+
+        const __m256i roll   = _mm256_shuffle_epi8(rollLut, _mm256_add_epi8(_mm256_cmpeq_epi8(v, slash), high));
+        const __m256i values = _mm256_add_epi8(v, roll);
+
+        // 4x 6 bits to 24 bits per 32 bits lane, then 3 bytes out of every lane
+        const __m256i pairs   = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+        const __m256i triplet = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+        const __m256i bytes   = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(triplet, pack), compact);
+
+        // Only the first 24 bytes matter, the other 8 were already read
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + write), bytes);
+    }
+
+    size_t tail;
+    write += scalarBase64Decode(data + read, length - read, out + write, tail);
+    consumed = read + tail;
+    return write;
+}
+
+// 24 bytes to 32 characters: the 6 bits indices are spread to their own byte
+// with multiplies, then offset to their character
+__attribute__((target("avx2"))) size_t avx2Base64Encode(const char* data, size_t length, char* out)
+{
+    const __m256i spread   = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+                                              1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    const __m256i shiftLut = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                              '0' - 52, '0' - 52, '0' - 52, '+' - 62, '-' - 63, 'A', 0, 0,
+                                              'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                              '0' - 52, '0' - 52, '0' - 52, '+' - 62, '-' - 63, 'A', 0, 0);
+
+    size_t read = 0, write = 0;
+    // Each half of the register is loaded with 16 bytes, 12 of which are used
+    for (; read + 28 <= length; read += 24, write += 32)
+    {
+        const __m128i first  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + read));
+        const __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + read + 12));
+        const __m256i v      = _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(first), second, 1), spread);
+
+        const __m256i high    = _mm256_mulhi_epu16(_mm256_and_si256(v, _mm256_set1_epi32(0x0fc0fc00)), _mm256_set1_epi32(0x04000040));
+        const __m256i low     = _mm256_mullo_epi16(_mm256_and_si256(v, _mm256_set1_epi32(0x003f03f0)), _mm256_set1_epi32(0x01000010));
+        const __m256i indices = _mm256_or_si256(high, low);
+
+        // 0 for [26, 51], 1 to 12 for [52, 63] and 13 for [0, 25]
+        __m256i row = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        row         = _mm256_or_si256(row, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices), _mm256_set1_epi8(13)));
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + write), _mm256_add_epi8(indices, _mm256_shuffle_epi8(shiftLut, row)));
+    }
+
+    return read + scalarBase64Encode(data + read, length - read, out + write);
+}
+
+const kernels avx2Kernels { avx2FindRange, avx2FindEither, avx2FindSet, avx2FindPair, avx2FindSubstring, avx2Lowercase, avx2Base64Decode, avx2Base64Encode };
+
+#endif
+
+#ifdef DDWAF_SIMD_NEON
+
+// NEON has no movemask: narrow every byte of the comparison to a nibble
+inline uint64_t neonMask(uint8x16_t comparison)
+{
+    return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(comparison), 4)), 0);
+}
+
+size_t neonFindRange(const char* data, size_t length, unsigned char lo, unsigned char hi)
+{
+    const uint8x16_t loVec   = vdupq_n_u8(lo);
+    const uint8x16_t spanVec = vdupq_n_u8((uint8_t) (hi - lo));
+
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        const uint8x16_t v  = vld1q_u8(reinterpret_cast<const uint8_t*>(data + i));
+        const uint64_t mask = neonMask(vcleq_u8(vsubq_u8(v, loVec), spanVec));
+        if (mask != 0)
+            return i + (countTrailingZeros(mask) >> 2);
+    }
+
+    return i + scalarFindRange(data + i, length - i, lo, hi);
+}
+
+size_t neonFindEither(const char* data, size_t length, unsigned char a, unsigned char b)
+{
+    const uint8x16_t aVec = vdupq_n_u8(a);
+    const uint8x16_t bVec = vdupq_n_u8(b);
+
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        const uint8x16_t v  = vld1q_u8(reinterpret_cast<const uint8_t*>(data + i));
+        const uint64_t mask = neonMask(vorrq_u8(vceqq_u8(v, aVec), vceqq_u8(v, bVec)));
+        if (mask != 0)
+            return i + (countTrailingZeros(mask) >> 2);
+    }
+
+    return i + scalarFindEither(data + i, length - i, a, b);
+}
+
+size_t neonFindSet(const char* data, size_t length, const byte_set& set)
+{
+    const uint8x16_t lowRows  = vld1q_u8(set.bits);
+    const uint8x16_t highRows = vld1q_u8(set.bits + 16);
+    const uint8_t bits[16]    = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+    const uint8x16_t bitOf    = vld1q_u8(bits);
+    const uint8x16_t nibble   = vdupq_n_u8(0x0f);
+
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        const uint8x16_t v   = vld1q_u8(reinterpret_cast<const uint8_t*>(data + i));
+        const uint8x16_t low = vandq_u8(v, nibble);
+        const uint8x16_t row = vbslq_u8(vcgeq_u8(v, vdupq_n_u8(0x80)), vqtbl1q_u8(highRows, low), vqtbl1q_u8(lowRows, low));
+        const uint8x16_t bit = vqtbl1q_u8(bitOf, vshrq_n_u8(v, 4));
+        const uint64_t mask  = neonMask(vtstq_u8(row, bit));
+        if (mask != 0)
+            return i + (countTrailingZeros(mask) >> 2);
+    }
+
+    return i + scalarFindSet(data + i, length - i, set);
+}
+
+size_t neonFindPair(const char* data, size_t length, unsigned char c)
+{
+    const uint8x16_t needle = vdupq_n_u8(c);
+
+    size_t i = 1;
+    for (; i + 16 <= length; i += 16)
+    {
+        const uint8x16_t previous = vld1q_u8(reinterpret_cast<const uint8_t*>(data + i - 1));
+        const uint8x16_t current  = vld1q_u8(reinterpret_cast<const uint8_t*>(data + i));
+        const uint64_t mask       = neonMask(vandq_u8(vceqq_u8(previous, needle), vceqq_u8(current, needle)));
+        if (mask != 0)
+            return i + (countTrailingZeros(mask) >> 2);
+    }
+
+    return scalarFindPairFrom(data, length, c, i);
+}
+
+size_t neonFindSubstring(const char* data, size_t length, const char* needle, size_t needleLength)
+{
+    if (needleLength < 2)
+        return needleLength == 0 ? 0 : neonFindRange(data, length, (unsigned char) needle[0], (unsigned char) needle[0]);
+
+    const uint8x16_t first = vdupq_n_u8((uint8_t) needle[0]);
+    const uint8x16_t last  = vdupq_n_u8((uint8_t) needle[needleLength - 1]);
+
+    size_t i = 0;
+    for (; i + needleLength + 15 <= length; i += 16)
+    {
+        const uint8x16_t head = vld1q_u8(reinterpret_cast<const uint8_t*>(data + i));
+        const uint8x16_t tail = vld1q_u8(reinterpret_cast<const uint8_t*>(data + i + needleLength - 1));
+        uint64_t mask         = neonMask(vandq_u8(vceqq_u8(head, first), vceqq_u8(tail, last)));
+        while (mask != 0)
+        {
+            const unsigned offset = countTrailingZeros(mask) >> 2;
+            if (memcmp(data + i + offset + 1, needle + 1, needleLength - 2) == 0)
+                return i + offset;
+            mask &= ~(0xfULL << (offset * 4));
+        }
+    }
+
+    return scalarFindSubstringFrom(data, length, needle, needleLength, i);
+}
+
+void neonLowercase(char* data, size_t length)
+{
+    const uint8x16_t upperA = vdupq_n_u8('A');
+    const uint8x16_t span   = vdupq_n_u8('Z' - 'A');
+    const uint8x16_t bit    = vdupq_n_u8(0x20);
+
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16)
+    {
+        uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(data + i));
+        v            = vorrq_u8(v, vandq_u8(vcleq_u8(vsubq_u8(v, upperA), span), bit));
+        vst1q_u8(reinterpret_cast<uint8_t*>(data + i), v);
+    }
+
+    scalarLowercase(data + i, length - i);
+}
+
+// Value of the base64 characters, 0xff for the others
+inline uint8x16_t neonBase64Values(uint8x16_t v)
+{
+    const uint8x16_t upper = vsubq_u8(v, vdupq_n_u8('A'));
+    const uint8x16_t lower = vsubq_u8(v, vdupq_n_u8('a'));
+    const uint8x16_t digit = vsubq_u8(v, vdupq_n_u8('0'));
+
+    uint8x16_t values = vdupq_n_u8(0xff);
+    values            = vbslq_u8(vcleq_u8(upper, vdupq_n_u8(25)), upper, values);
+    values            = vbslq_u8(vcleq_u8(lower, vdupq_n_u8(25)), vaddq_u8(lower, vdupq_n_u8(26)), values);
+    values            = vbslq_u8(vcleq_u8(digit, vdupq_n_u8(9)), vaddq_u8(digit, vdupq_n_u8(52)), values);
+    values            = vbslq_u8(vceqq_u8(v, vdupq_n_u8('+')), vdupq_n_u8(62), values);
+    return vbslq_u8(vceqq_u8(v, vdupq_n_u8('/')), vdupq_n_u8(63), values);
+}
+
+// 64 characters to 48 bytes, the interleaved loads and stores doing the shuffling
+size_t neonBase64Decode(const char* data, size_t length, char* out, size_t& consumed)
+{
+    size_t read = 0, write = 0;
+    for (; read + 64 <= length; read += 64, write += 48)
+    {
+        const uint8x16x4_t chars = vld4q_u8(reinterpret_cast<const uint8_t*>(data + read));
+        const uint8x16_t a       = neonBase64Values(chars.val[0]);
+        const uint8x16_t b       = neonBase64Values(chars.val[1]);
+        const uint8x16_t c       = neonBase64Values(chars.val[2]);
+        const uint8x16_t d       = neonBase64Values(chars.val[3]);
+        if (vmaxvq_u8(vorrq_u8(vorrq_u8(a, b), vorrq_u8(c, d))) > 63)
+            break;
+
+        uint8x16x3_t bytes;
+        bytes.val[0] = vorrq_u8(vshlq_n_u8(a, 2), vshrq_n_u8(b, 4));
+        bytes.val[1] = vorrq_u8(vshlq_n_u8(b, 4), vshrq_n_u8(c, 2));
+        bytes.val[2] = vorrq_u8(vshlq_n_u8(c, 6), d);
+        vst3q_u8(reinterpret_cast<uint8_t*>(out + write), bytes);
+    }
+
+    size_t tail;
+    write += scalarBase64Decode(data + read, length - read, out + write, tail);
+    consumed = read + tail;
+    return write;
+}
+
+// 48 bytes to 64 characters, the alphabet being a 64 bytes lookup table
+size_t neonBase64Encode(const char* data, size_t length, char* out)
+{
+    const uint8_t* alphabet    = reinterpret_cast<const uint8_t*>(base64Alphabet);
+    const uint8x16x4_t table   = { { vld1q_u8(alphabet), vld1q_u8(alphabet + 16), vld1q_u8(alphabet + 32), vld1q_u8(alphabet + 48) } };
+    const uint8x16_t sixBits   = vdupq_n_u8(0x3f);
+
+    size_t read = 0, write = 0;
+    for (; read + 48 <= length; read += 48, write += 64)
+    {
+        const uint8x16x3_t bytes = vld3q_u8(reinterpret_cast<const uint8_t*>(data + read));
+
+        uint8x16x4_t chars;
+        chars.val[0] = vqtbl4q_u8(table, vshrq_n_u8(bytes.val[0], 2));
+        chars.val[1] = vqtbl4q_u8(table, vandq_u8(vorrq_u8(vshlq_n_u8(bytes.val[0], 4), vshrq_n_u8(bytes.val[1], 4)), sixBits));
+        chars.val[2] = vqtbl4q_u8(table, vandq_u8(vorrq_u8(vshlq_n_u8(bytes.val[1], 2), vshrq_n_u8(bytes.val[2], 6)), sixBits));
+        chars.val[3] = vqtbl4q_u8(table, vandq_u8(bytes.val[2], sixBits));
+        vst4q_u8(reinterpret_cast<uint8_t*>(out + write), chars);
+    }
+
+    return read + scalarBase64Encode(data + read, length - read, out + write);
+}
+
+const kernels neonKernels { neonFindRange, neonFindEither, neonFindSet, neonFindPair, neonFindSubstring, neonLowercase, neonBase64Decode, neonBase64Encode };
+
+#endif
+
+const kernels scalarKernels { scalarFindRange, scalarFindEither, scalarFindSet, scalarFindPair, scalarFindSubstring, scalarLowercase, scalarBase64Decode, scalarBase64Encode };
+
+}
+
+bool supports(isa set)
+{
+    switch (set)
+    {
+        case isa::scalar:
+            return true;
+#ifdef DDWAF_SIMD_SSE2
+        case isa::sse2:
+            return true;
+#endif
+#ifdef DDWAF_SIMD_AVX2
+        case isa::avx2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+#endif
+#ifdef DDWAF_SIMD_NEON
+        case isa::neon:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+isa best()
+{
+    static const isa selected = [] {
+        for (isa set : { isa::avx2, isa::sse2, isa::neon })
+        {
+            if (supports(set))
+                return set;
+        }
+        return isa::scalar;
+    }();
+
+    return selected;
+}
+
+const kernels& get(isa set)
+{
+    switch (set)
+    {
+#ifdef DDWAF_SIMD_SSE2
+        case isa::sse2:
+            return sse2Kernels;
+#endif
+#ifdef DDWAF_SIMD_AVX2
+        case isa::avx2:
+            return avx2Kernels;
+#endif
+#ifdef DDWAF_SIMD_NEON
+        case isa::neon:
+            return neonKernels;
+#endif
+        default:
+            return scalarKernels;
+    }
+}
+
+}
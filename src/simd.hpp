@@ -0,0 +1,163 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ddwaf::simd
+{
+
+enum class isa
+{
+    scalar,
+    sse2,
+    avx2,
+    neon,
+};
+
+// Set of bytes, built at compile time. The 256 bits are laid out for the
+// nibble based vectorized classification: bits[lo + 16 * (hi >= 8)] has the
+// bit (hi & 7) set for every byte (hi << 4 | lo) of the set.
+struct byte_set
+{
+    uint8_t bits[32] {};
+
+    constexpr byte_set with(uint8_t c) const
+    {
+        byte_set copy = *this;
+        copy.bits[(c & 0xfu) | ((c >> 7u) << 4u)] |= (uint8_t) (1u << ((c >> 4u) & 7u));
+        return copy;
+    }
+
+    constexpr byte_set with(const char* chars) const
+    {
+        byte_set copy = *this;
+        for (; *chars != 0; ++chars)
+            copy = copy.with((uint8_t) *chars);
+        return copy;
+    }
+
+    constexpr byte_set with_range(uint8_t lo, uint8_t hi) const
+    {
+        byte_set copy = *this;
+        for (unsigned c = lo; c <= hi; ++c)
+            copy = copy.with((uint8_t) c);
+        return copy;
+    }
+
+    constexpr byte_set merge(const byte_set& other) const
+    {
+        byte_set copy = *this;
+        for (size_t i = 0; i < sizeof(bits); ++i)
+            copy.bits[i] |= other.bits[i];
+        return copy;
+    }
+
+    constexpr byte_set invert() const
+    {
+        byte_set copy = *this;
+        for (size_t i = 0; i < sizeof(bits); ++i)
+            copy.bits[i] = (uint8_t) ~bits[i];
+        return copy;
+    }
+
+    constexpr bool contains(uint8_t c) const
+    {
+        return (bits[(c & 0xfu) | ((c >> 7u) << 4u)] >> ((c >> 4u) & 7u)) & 1u;
+    }
+};
+
+// Byte scanning kernels used by the transformers and the operators. Every implementation
+// produces exactly the same results as the scalar one.
+struct kernels
+{
+    // Index of the first byte within [lo, hi] (unsigned), length if none
+    size_t (*find_range)(const char* data, size_t length, unsigned char lo, unsigned char hi);
+    // Index of the first byte equal to a or b, length if none
+    size_t (*find_either)(const char* data, size_t length, unsigned char a, unsigned char b);
+    // Index of the first byte of the set, length if none
+    size_t (*find_set)(const char* data, size_t length, const byte_set& set);
+    // Smallest index i >= 1 such that data[i - 1] == data[i] == c, length if none
+    size_t (*find_pair)(const char* data, size_t length, unsigned char c);
+    // Index of the first occurrence of the needle, length if none, 0 if the
+    // needle is empty
+    size_t (*find_substring)(const char* data, size_t length, const char* needle, size_t needleLength);
+    // Lowercase the ASCII letters
+    void (*lowercase)(char* data, size_t length);
+    // Decode the longest prefix of whole quartets of base64 characters (A-Z,
+    // a-z, 0-9, '+' and '/'), stopping at the quartet with an invalid one.
+    // Return the number of bytes written to out, which may be data as at most
+    // consumed bytes are written; consumed is the number of characters read.
+    size_t (*base64_decode)(const char* data, size_t length, char* out, size_t& consumed);
+    // Encode the whole triplets of bytes to out, 63 being encoded as '-' like
+    // the base64Encode transformer does. Return the number of bytes read.
+    size_t (*base64_encode)(const char* data, size_t length, char* out);
+};
+
+// Whether the CPU we're running on supports the instruction set
+bool supports(isa set);
+// The best instruction set supported, picked once
+isa best();
+// Kernels of an instruction set, which must be supported
+const kernels& get(isa set);
+
+inline const kernels& get()
+{
+    static const kernels& active = get(best());
+    return active;
+}
+
+inline size_t find_range(const char* data, size_t length, unsigned char lo, unsigned char hi)
+{
+    return get().find_range(data, length, lo, hi);
+}
+
+inline size_t find_byte(const char* data, size_t length, unsigned char c)
+{
+    return get().find_range(data, length, c, c);
+}
+
+inline size_t find_either(const char* data, size_t length, unsigned char a, unsigned char b)
+{
+    return get().find_either(data, length, a, b);
+}
+
+inline size_t find_set(const char* data, size_t length, const byte_set& set)
+{
+    return get().find_set(data, length, set);
+}
+
+inline size_t find_pair(const char* data, size_t length, unsigned char c)
+{
+    return get().find_pair(data, length, c);
+}
+
+inline size_t find_substring(const char* data, size_t length, const char* needle, size_t needleLength)
+{
+    return get().find_substring(data, length, needle, needleLength);
+}
+
+inline void lowercase(char* data, size_t length)
+{
+    get().lowercase(data, length);
+}
+
+inline size_t base64_decode(const char* data, size_t length, char* out, size_t& consumed)
+{
+    return get().base64_decode(data, length, out, consumed);
+}
+
+inline size_t base64_encode(const char* data, size_t length, char* out)
+{
+    return get().base64_encode(data, length, out);
+}
+
+}
+
+#endif // SIMD_H
@@ -0,0 +1,128 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include <cstring>
+#include <stdexcept>
+
+#include <string_set.hpp>
+
+namespace ddwaf
+{
+
+namespace
+{
+
+constexpr uint64_t multiplier = 0x9e3779b97f4a7c15;
+
+uint64_t mix(uint64_t value)
+{
+    value ^= value >> 32;
+    value *= multiplier;
+    return value ^ (value >> 29);
+}
+
+}
+
+// Eight bytes at a time, the last (possibly overlapping) word covering the tail
+uint64_t string_set::hash(std::string_view str)
+{
+    const char* data = str.data();
+    size_t length    = str.size();
+    uint64_t value   = mix(length + multiplier);
+
+    if (length < 8)
+    {
+        uint64_t word = 0;
+        for (size_t i = 0; i < length; ++i)
+        {
+            word |= (uint64_t) (uint8_t) data[i] << (8 * i);
+        }
+        return mix(value ^ word);
+    }
+
+    uint64_t word;
+    for (; length > 8; data += 8, length -= 8)
+    {
+        memcpy(&word, data, sizeof(word));
+        value = mix(value ^ word) * multiplier;
+    }
+
+    memcpy(&word, data + length - 8, sizeof(word));
+    return mix(value ^ word);
+}
+
+string_set::string_set(const std::vector<std::string_view>& strings)
+{
+    // At most 3/4 full
+    size_t capacity = 4;
+    while (capacity * 3 < strings.size() * 4)
+    {
+        capacity *= 2;
+    }
+
+    slots.assign(capacity, { 0, emptySlot, 0 });
+    mask = capacity - 1;
+
+    size_t poolSize = 0;
+    for (std::string_view str : strings)
+    {
+        poolSize += str.size();
+    }
+    if (poolSize >= emptySlot)
+    {
+        throw std::length_error("strings too large for a string_set");
+    }
+    pool.reserve(poolSize);
+
+    for (std::string_view str : strings)
+    {
+        const uint64_t full = hash(str);
+        for (uint64_t index = full & mask;; index = (index + 1) & mask)
+        {
+            slot& current = slots[index];
+            if (current.offset == emptySlot)
+            {
+                current = { (uint32_t) (full >> 32), (uint32_t) pool.size(), (uint32_t) str.size() };
+                pool.insert(pool.end(), str.begin(), str.end());
+                ++count;
+                break;
+            }
+
+            // Duplicates are only stored once
+            if (matches(current, (uint32_t) (full >> 32), str))
+            {
+                break;
+            }
+        }
+    }
+
+    pool.shrink_to_fit();
+}
+
+bool string_set::matches(const slot& current, uint32_t tag, std::string_view str) const
+{
+    return current.hash == tag && current.length == str.size() && (str.empty() || memcmp(pool.data() + current.offset, str.data(), str.size()) == 0);
+}
+
+bool string_set::contains(std::string_view str) const
+{
+    if (count == 0)
+        return false;
+
+    // The low bits pick the slot, the high bits tell the strings apart
+    const uint64_t full = hash(str);
+    for (uint64_t index = full & mask;; index = (index + 1) & mask)
+    {
+        const slot& current = slots[index];
+        if (current.offset == emptySlot)
+            return false;
+
+        if (matches(current, (uint32_t) (full >> 32), str))
+            return true;
+    }
+}
+
+}
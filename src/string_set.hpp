@@ -0,0 +1,60 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#ifndef STRING_SET_H
+#define STRING_SET_H
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace ddwaf
+{
+
+// Immutable set of strings for whole string lookups.
+//
+// The distinct strings are stored back to back in a single pool, and the set
+// itself is an open addressing table with linear probing, at most 3/4 full.
+// A slot is the location of its string in the pool along with part of its
+// hash, so that a probe only reads the pool once the hashes match. Each
+// string costs its length plus 16 to 32 bytes of slots, and a lookup hashes
+// the input once then usually touches a single slot.
+class string_set
+{
+public:
+    string_set() = default;
+    explicit string_set(const std::vector<std::string_view>& strings);
+
+    bool contains(std::string_view str) const;
+
+    // Number of distinct strings
+    size_t size() const { return count; }
+    // Bytes used by the pool and the table
+    size_t memoryUsage() const { return pool.capacity() + slots.capacity() * sizeof(slot); }
+
+protected:
+    struct slot
+    {
+        uint32_t hash;
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    static constexpr uint32_t emptySlot = UINT32_MAX;
+
+    static uint64_t hash(std::string_view str);
+    // Compare the high bits of the hash first, then the string
+    bool matches(const slot& current, uint32_t tag, std::string_view str) const;
+
+    std::vector<char> pool;
+    std::vector<slot> slots;
+    uint64_t mask { 0 };
+    size_t count { 0 };
+};
+
+}
+
+#endif /* STRING_SET_H */
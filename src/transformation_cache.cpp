@@ -0,0 +1,58 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include <transformation_cache.hpp>
+
+namespace ddwaf
+{
+
+transformation_cache::~transformation_cache()
+{
+    clear();
+}
+
+bool transformation_cache::find(const ddwaf_object* input, bool onKey, chain_id chain, const ddwaf_object*& output, bool& failed)
+{
+    auto it = entries.find({ input, chain, onKey });
+    if (it == entries.end())
+    {
+        return false;
+    }
+
+    hitCount += 1;
+    output = it->second.output.type == DDWAF_OBJ_INVALID ? nullptr : &it->second.output;
+    failed = it->second.failed;
+    return true;
+}
+
+const ddwaf_object* transformation_cache::insert(const ddwaf_object* input, bool onKey, chain_id chain, ddwaf_object output, bool owned, bool failed)
+{
+    missCount += 1;
+
+    auto [it, inserted] = entries.emplace(key { input, chain, onKey }, entry { output, owned, failed });
+    if (!inserted)
+    {
+        // Shouldn't happen as the caller looked the entry up first
+        if (it->second.owned)
+            ddwaf_object_free(&it->second.output);
+        it->second = { output, owned, failed };
+    }
+
+    return it->second.output.type == DDWAF_OBJ_INVALID ? nullptr : &it->second.output;
+}
+
+void transformation_cache::clear()
+{
+    for (auto& [k, cached] : entries)
+    {
+        if (cached.owned)
+            ddwaf_object_free(&cached.output);
+    }
+
+    entries.clear();
+}
+
+}
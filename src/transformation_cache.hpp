@@ -0,0 +1,91 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#ifndef TRANSFORMATION_CACHE_H
+#define TRANSFORMATION_CACHE_H
+
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+
+#include <ddwaf.h>
+
+namespace ddwaf
+{
+
+// Outputs of the transformer chains applied to the inputs during a run, keyed
+// by input object, key or value side and chain. Conditions sharing a chain
+// thus only transform a given input once.
+class transformation_cache
+{
+public:
+    // Dense identifier of a distinct transformer chain within a ruleset
+    using chain_id = uint32_t;
+    static constexpr chain_id no_chain = std::numeric_limits<chain_id>::max();
+
+    transformation_cache() = default;
+    ~transformation_cache();
+
+    transformation_cache(const transformation_cache&) = delete;
+    transformation_cache& operator=(const transformation_cache&) = delete;
+
+    // Return false if the transformation isn't cached. Otherwise, output is
+    // either the transformed input or nullptr if the input is used as is.
+    bool find(const ddwaf_object* input, bool onKey, chain_id chain, const ddwaf_object*& output)
+    {
+        bool failed;
+        return find(input, onKey, chain, output, failed);
+    }
+    // Also tell whether the input is used as is because the chain failed
+    bool find(const ddwaf_object* input, bool onKey, chain_id chain, const ddwaf_object*& output, bool& failed);
+
+    // Store the output, an invalid object meaning the input is used as is. The
+    // cache takes ownership of the output if owned, otherwise its string is
+    // expected to outlive the entry (e.g. backed by the arena of the context
+    // or by another entry).
+    const ddwaf_object* insert(const ddwaf_object* input, bool onKey, chain_id chain, ddwaf_object output, bool owned = true, bool failed = false);
+
+    void clear();
+
+    uint64_t hits() const { return hitCount; }
+    uint64_t misses() const { return missCount; }
+
+protected:
+    struct key
+    {
+        const ddwaf_object* input;
+        chain_id chain;
+        bool onKey;
+
+        bool operator==(const key& other) const
+        {
+            return input == other.input && chain == other.chain && onKey == other.onKey;
+        }
+    };
+
+    struct key_hash
+    {
+        size_t operator()(const key& k) const
+        {
+            return std::hash<const void*>()(k.input) ^ ((size_t) k.chain << 1 | k.onKey);
+        }
+    };
+
+    struct entry
+    {
+        ddwaf_object output;
+        bool owned;
+        bool failed;
+    };
+
+    std::unordered_map<key, entry, key_hash> entries;
+    uint64_t hitCount { 0 };
+    uint64_t missCount { 0 };
+};
+
+}
+
+#endif /* TRANSFORMATION_CACHE_H */
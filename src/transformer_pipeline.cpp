@@ -0,0 +1,383 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include <simd.hpp>
+#include <transformer_pipeline.hpp>
+
+namespace ddwaf
+{
+
+namespace
+{
+
+// Longest run of transformers fused together, bounding the per pass state
+constexpr size_t maxFused = 8;
+
+bool isHex(uint8_t c)
+{
+    return (c >= '0' && c <= '9') || ((c | 0x20) >= 'a' && (c | 0x20) <= 'f');
+}
+
+uint8_t fromHex(uint8_t c)
+{
+    if (c <= '9')
+        return c - '0';
+    return (uint8_t) ((c | 0x20) - 'a' + 0xa);
+}
+
+}
+
+// The string being transformed: a view of the input until a stage changes it,
+// then a copy owned by the pipeline
+struct transformer_pipeline::buffer
+{
+    ddwaf_object value;
+    bool owned { false };
+    arena* allocator;
+
+    // Copy the first `prefix` bytes of the input, the rest being rewritten by the caller
+    char* own(uint64_t prefix)
+    {
+        if (owned)
+            return const_cast<char*>(value.stringValue);
+
+        const size_t size = (size_t) value.nbEntries + 1;
+        char* copy        = allocator != nullptr ? static_cast<char*>(allocator->allocate(size, 1)) : static_cast<char*>(malloc(size));
+        if (copy == nullptr)
+            throw std::bad_alloc();
+
+        memcpy(copy, value.stringValue, (size_t) prefix);
+        value.stringValue = copy;
+        owned             = true;
+        return copy;
+    }
+};
+
+namespace
+{
+
+// Single pass of a run of fused transformers. Bytes are pushed through the
+// stages one at a time, but the spans on which every stage is the identity
+// are found with the vectorized scans and moved in one go.
+template <typename Buffer, typename Op>
+class fused_pass
+{
+public:
+    fused_pass(const Op* ops_, size_t count_, Buffer& buffer_)
+        : ops(ops_), count(count_), buffer(buffer_),
+          source(buffer_.value.stringValue), length(buffer_.value.nbEntries)
+    {
+        if (buffer.owned)
+            output = const_cast<char*>(source);
+    }
+
+    void run()
+    {
+        uint64_t read = 0;
+        while (read < length)
+        {
+            const uint64_t next = nextTrigger(read);
+            if (next > read)
+            {
+                copy(read, next);
+                read = next;
+                if (read == length)
+                    break;
+            }
+
+            push(0, (uint8_t) source[read++]);
+        }
+
+        // Release the bytes held for lookahead, in order
+        for (size_t index = 0; index < count; ++index)
+        {
+            flush(index);
+        }
+
+        if (output == nullptr && write != length)
+            output = buffer.own(write);
+
+        if (output != nullptr)
+        {
+            output[write]          = 0;
+            buffer.value.nbEntries = write;
+        }
+    }
+
+protected:
+    struct state
+    {
+        uint64_t trigger { 0 };       // Next byte of the input the stage may act on
+        bool triggerValid { false };
+        bool lastSpace { false };     // compress_white
+        uint8_t pendingCount { 0 };   // decode_url, "%" or "%X"
+        uint8_t pendingHex { 0 };
+    };
+
+    // Position of the first byte, starting at read, which a stage may act on.
+    // Every stage is the identity over [read, next) and sees the input as is.
+    uint64_t nextTrigger(uint64_t read)
+    {
+        uint64_t next = length;
+        for (size_t index = 0; index < count && next > read; ++index)
+        {
+            state& current = states[index];
+            if (current.pendingCount != 0 || (current.lastSpace && source[read] == ' '))
+                return read;
+
+            if (!current.triggerValid || current.trigger < read)
+            {
+                const char* data       = source + read;
+                const uint64_t left    = length - read;
+                current.triggerValid   = true;
+
+                switch (ops[index])
+                {
+                    case Op::lowercase:
+                        current.trigger = read + simd::find_range(data, left, 'A', 'Z');
+                        break;
+                    case Op::remove_nulls:
+                        current.trigger = read + simd::find_byte(data, left, 0);
+                        break;
+                    case Op::compress_white:
+                        current.trigger = read + simd::find_pair(data, left, ' ');
+                        break;
+                    case Op::decode_url:
+                        current.trigger = read + simd::find_either(data, left, '%', '+');
+                        break;
+                }
+            }
+
+            next = std::min(next, current.trigger);
+        }
+
+        return next;
+    }
+
+    // Move a span every stage leaves untouched
+    void copy(uint64_t read, uint64_t next)
+    {
+        const uint64_t span = next - read;
+        if (output == nullptr && write != read)
+            output = buffer.own(write);
+
+        if (output != nullptr && output + write != source + read)
+            memmove(output + write, source + read, (size_t) span);
+        write += span;
+
+        for (size_t index = 0; index < count; ++index)
+        {
+            if (ops[index] == Op::compress_white)
+                states[index].lastSpace = source[next - 1] == ' ';
+        }
+    }
+
+    void emit(uint8_t c)
+    {
+        if (output == nullptr)
+        {
+            // Still identical to the input, no need to copy it yet
+            if ((uint8_t) source[write] == c)
+            {
+                write += 1;
+                return;
+            }
+            output = buffer.own(write);
+        }
+        output[write++] = (char) c;
+    }
+
+    void push(size_t index, uint8_t c)
+    {
+        if (index == count)
+        {
+            emit(c);
+            return;
+        }
+
+        state& current = states[index];
+        switch (ops[index])
+        {
+            case Op::lowercase:
+                if (c >= 'A' && c <= 'Z')
+                    c += 'a' - 'A';
+                break;
+
+            case Op::remove_nulls:
+                if (c == 0)
+                    return;
+                break;
+
+            case Op::compress_white:
+                if (c == ' ' && current.lastSpace)
+                    return;
+                current.lastSpace = c == ' ';
+                break;
+
+            case Op::decode_url:
+                if (current.pendingCount != 0)
+                {
+                    if (isHex(c))
+                    {
+                        if (current.pendingCount == 1)
+                        {
+                            current.pendingHex   = c;
+                            current.pendingCount = 2;
+                            return;
+                        }
+
+                        current.pendingCount = 0;
+                        c                    = (uint8_t) (fromHex(current.pendingHex) << 4u | fromHex(c));
+                        break;
+                    }
+
+                    // Not an escape after all, the bytes are kept as is and c is considered anew
+                    flush(index);
+                }
+
+                if (c == '%')
+                {
+                    current.pendingCount = 1;
+                    return;
+                }
+                if (c == '+')
+                    c = ' ';
+                break;
+        }
+
+        push(index + 1, c);
+    }
+
+    void flush(size_t index)
+    {
+        state& current = states[index];
+        if (current.pendingCount == 0)
+            return;
+
+        const uint8_t pending = current.pendingCount;
+        current.pendingCount  = 0;
+
+        push(index + 1, '%');
+        if (pending == 2)
+            push(index + 1, current.pendingHex);
+    }
+
+    const Op* ops;
+    size_t count;
+    Buffer& buffer;
+    const char* source;
+    uint64_t length;
+    char* output { nullptr };
+    uint64_t write { 0 };
+    state states[maxFused];
+};
+
+}
+
+transformer_pipeline::transformer_pipeline(const std::vector<PW_TRANSFORM_ID>& transformers)
+{
+    for (PW_TRANSFORM_ID transformer : transformers)
+    {
+        inPlaceTransformation &= PWTransformer::transformsInPlace(transformer);
+
+        simd::byte_set transformerTriggers;
+        if (boundedTriggers && PWTransformer::triggerBytes(transformer, transformerTriggers))
+            triggers = triggers.merge(transformerTriggers);
+        else
+            boundedTriggers = false;
+
+        stream_op op;
+        switch (transformer)
+        {
+            case PWT_LOWERCASE:
+                op = stream_op::lowercase;
+                break;
+            case PWT_NONULL:
+                op = stream_op::remove_nulls;
+                break;
+            case PWT_COMPRESS_WHITE:
+                op = stream_op::compress_white;
+                break;
+            // urlDecodeUni decodes until nothing changes, which can't be done in a single pass
+            case PWT_DECODE_URL:
+                op = stream_op::decode_url;
+                break;
+            default:
+                stages.push_back({ {}, transformer });
+                continue;
+        }
+
+        if (stages.empty() || stages.back().fused.empty() || stages.back().fused.size() == maxFused)
+            stages.push_back({ {}, transformer });
+        stages.back().fused.push_back(op);
+    }
+}
+
+ddwaf_object transformer_pipeline::transform(const char* data, uint64_t length, arena* allocator, bool& failed) const
+{
+    ddwaf_object output;
+    ddwaf_object_invalid(&output);
+    failed = false;
+    if (boundedTriggers && simd::find_set(data, (size_t) length, triggers) == length)
+        return output;
+
+    buffer current;
+    ddwaf_object_stringl_nc(&current.value, data, length);
+    current.allocator = inPlaceTransformation ? allocator : nullptr;
+
+    bool success = true;
+    for (const stage& step : stages)
+    {
+        success = step.fused.empty() ? runRegular(step.transformer, current) : runFused(step.fused, current);
+
+        // Same as the unfused chain, an empty string isn't transformed any further
+        if (!success || (current.value.type == DDWAF_OBJ_STRING && current.value.nbEntries == 0))
+            break;
+    }
+
+    failed = !success;
+    if (!current.owned)
+        return output;
+
+    if (!success)
+    {
+        if (current.allocator == nullptr)
+            ddwaf_object_free(&current.value);
+        return output;
+    }
+
+    return current.value;
+}
+
+bool transformer_pipeline::runFused(const std::vector<stream_op>& ops, buffer& current) const
+{
+    if (current.value.type != DDWAF_OBJ_STRING || current.value.stringValue == nullptr)
+        return false;
+
+    fused_pass<buffer, stream_op>(ops.data(), ops.size(), current).run();
+    return true;
+}
+
+bool transformer_pipeline::runRegular(PW_TRANSFORM_ID transformer, buffer& current) const
+{
+    if (!current.owned)
+    {
+        // The input is only copied if the transformer is going to change it
+        if (!PWTransformer::transform(transformer, &current.value, true))
+            return true;
+
+        current.own(current.value.nbEntries);
+    }
+
+    return PWTransformer::transform(transformer, &current.value);
+}
+
+}
@@ -0,0 +1,83 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#ifndef TRANSFORMER_PIPELINE_H
+#define TRANSFORMER_PIPELINE_H
+
+#include <cstdint>
+#include <vector>
+
+#include <PWTransformer.h>
+#include <arena.hpp>
+#include <ddwaf.h>
+#include <simd.hpp>
+
+namespace ddwaf
+{
+
+// A transformer chain compiled once per ruleset. Runs of consecutive byte
+// streaming transformers (lowercase, removeNulls, compressWhiteSpace and
+// urlDecode) are fused: the bytes go through all of them in a single pass,
+// with at most two bytes of lookahead. The other transformers are applied in
+// place as before.
+//
+// Strings without any of the trigger bytes of the chain are left alone after
+// a single classification pass. Otherwise, the string is only copied once a
+// stage actually changes it, so the fused pass also replaces the read-only
+// probe of doesNeedTransform.
+class transformer_pipeline
+{
+public:
+    explicit transformer_pipeline(const std::vector<PW_TRANSFORM_ID>& transformers);
+
+    // Apply the chain to a copy of the string. Return an invalid object if the
+    // string should be used as is, because it's unchanged or a transformer
+    // failed. The copy comes from the arena if provided and inPlace() is set,
+    // otherwise it's to be freed with ddwaf_object_free.
+    ddwaf_object transform(const char* data, uint64_t length, arena* allocator = nullptr) const
+    {
+        bool failed;
+        return transform(data, length, allocator, failed);
+    }
+    // Also tell whether the string is to be used as is because a transformer failed
+    ddwaf_object transform(const char* data, uint64_t length, arena* allocator, bool& failed) const;
+
+    // Whether the copy never has to be reallocated or freed by a transformer
+    bool inPlace() const { return inPlaceTransformation; }
+    // Number of passes over the string, once fused
+    size_t passes() const { return stages.size(); }
+
+protected:
+    enum class stream_op : uint8_t
+    {
+        lowercase,
+        remove_nulls,
+        compress_white,
+        decode_url
+    };
+
+    struct stage
+    {
+        // Empty if the stage is a single regular transformer
+        std::vector<stream_op> fused;
+        PW_TRANSFORM_ID transformer;
+    };
+
+    struct buffer;
+
+    bool runFused(const std::vector<stream_op>& ops, buffer& current) const;
+    bool runRegular(PW_TRANSFORM_ID transformer, buffer& current) const;
+
+    std::vector<stage> stages;
+    bool inPlaceTransformation { true };
+    // Bytes any transformer of the chain acts on, if they all declare them
+    simd::byte_set triggers;
+    bool boundedTriggers { true };
+};
+
+}
+
+#endif /* TRANSFORMER_PIPELINE_H */
@@ -0,0 +1,135 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include <map>
+#include <utility>
+
+#include <transformer_trie.hpp>
+
+namespace ddwaf
+{
+
+transformer_trie::transformer_trie(const std::vector<std::vector<PW_TRANSFORM_ID>>& chains)
+{
+    // Plain trie first, one vertex per transformer
+    struct vertex
+    {
+        std::vector<PW_TRANSFORM_ID> chain;
+        std::map<PW_TRANSFORM_ID, size_t> children;
+        bool used { false };
+    };
+
+    std::vector<vertex> vertices(1);
+    for (const auto& chain : chains)
+    {
+        if (chain.empty())
+            continue;
+
+        size_t current = 0;
+        for (PW_TRANSFORM_ID transformer : chain)
+        {
+            auto it = vertices[current].children.find(transformer);
+            if (it == vertices[current].children.end())
+            {
+                vertex child;
+                child.chain = vertices[current].chain;
+                child.chain.push_back(transformer);
+                vertices.push_back(std::move(child));
+                it = vertices[current].children.emplace(transformer, vertices.size() - 1).first;
+            }
+            current = it->second;
+        }
+        vertices[current].used = true;
+    }
+
+    // Only keep the chains used by the conditions and those where chains
+    // diverge, parents being visited before their children
+    std::vector<std::pair<size_t, node_id>> stack { { 0, transformation_cache::no_chain } };
+    while (!stack.empty())
+    {
+        const auto [index, parent] = stack.back();
+        stack.pop_back();
+
+        const vertex& current = vertices[index];
+        node_id closest       = parent;
+        if (index != 0 && (current.used || current.children.size() > 1))
+        {
+            const size_t parentLength = parent == transformation_cache::no_chain ? 0 : nodes[parent].chain.size();
+            const std::vector<PW_TRANSFORM_ID> suffix(current.chain.begin() + (ptrdiff_t) parentLength, current.chain.end());
+
+            closest = (node_id) nodes.size();
+            nodes.push_back({ parent, current.chain, transformer_pipeline(suffix), std::make_shared<const transformer_pipeline>(current.chain) });
+            chainIndex.emplace(current.chain, closest);
+        }
+
+        for (const auto& [transformer, child] : current.children)
+        {
+            stack.emplace_back(child, closest);
+        }
+    }
+}
+
+transformer_trie::node_id transformer_trie::find(const std::vector<PW_TRANSFORM_ID>& chain) const
+{
+    auto it = chainIndex.find(chain);
+    return it == chainIndex.end() ? transformation_cache::no_chain : it->second;
+}
+
+const ddwaf_object* transformer_trie::evaluate(node_id id, const ddwaf_object* input, bool onKey, transformation_cache& cache, arena* allocator, bool& failed) const
+{
+    const ddwaf_object* output = nullptr;
+    if (cache.find(input, onKey, id, output, failed))
+        return output;
+
+    const node& current = nodes[id];
+
+    // The prefix shared with other chains is computed once
+    const ddwaf_object* base = nullptr;
+    bool baseFailed          = false;
+    if (current.parent != transformation_cache::no_chain)
+        base = evaluate(current.parent, input, onKey, cache, allocator, baseFailed);
+
+    const char* data = onKey ? input->parameterName : input->stringValue;
+    uint64_t length  = onKey ? input->parameterNameLength : input->nbEntries;
+    if (base != nullptr)
+    {
+        data   = base->stringValue;
+        length = base->nbEntries;
+    }
+
+    ddwaf_object result;
+    ddwaf_object_invalid(&result);
+
+    // Once the prefix failed or produced something else than a string, the
+    // next transformer fails too
+    if (baseFailed || (base != nullptr && base->type != DDWAF_OBJ_STRING))
+    {
+        failed = true;
+        return cache.insert(input, onKey, id, result, true, true);
+    }
+
+    // The chain isn't applied past an empty string, the prefix has the final say
+    if (length == 0 && current.parent != transformation_cache::no_chain)
+    {
+        failed = false;
+        if (base == nullptr)
+            return cache.insert(input, onKey, id, result);
+
+        // The string belongs to the entry of the prefix
+        return cache.insert(input, onKey, id, *base, false);
+    }
+
+    const bool copyInArena = allocator != nullptr && current.suffix.inPlace();
+    result                 = current.suffix.transform(data, length, copyInArena ? allocator : nullptr, failed);
+
+    // Left unchanged by the suffix, the output is the one of the prefix
+    if (result.type == DDWAF_OBJ_INVALID && !failed && base != nullptr)
+        return cache.insert(input, onKey, id, *base, false);
+
+    return cache.insert(input, onKey, id, result, !copyInArena, failed);
+}
+
+}
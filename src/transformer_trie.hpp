@@ -0,0 +1,68 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#ifndef TRANSFORMER_TRIE_H
+#define TRANSFORMER_TRIE_H
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <PWTransformer.h>
+#include <arena.hpp>
+#include <transformation_cache.hpp>
+#include <transformer_pipeline.hpp>
+
+namespace ddwaf
+{
+
+// Trie of the transformer chains of a ruleset, e.g. [lowercase],
+// [lowercase, urlDecode] and [lowercase, urlDecode, htmlEntityDecode].
+//
+// Every chain used by a condition is a node, and so is every prefix shared by
+// several chains. The transformers between a node and its closest ancestor
+// are compiled into a pipeline, so the output of a node is computed from the
+// output of its parent. Along with the transformation cache of the context,
+// each node is thus applied at most once per input.
+class transformer_trie
+{
+public:
+    using node_id = transformation_cache::chain_id;
+
+    transformer_trie() = default;
+    explicit transformer_trie(const std::vector<std::vector<PW_TRANSFORM_ID>>& chains);
+
+    // Node of a chain given to the constructor, no_chain otherwise
+    node_id find(const std::vector<PW_TRANSFORM_ID>& chain) const;
+
+    size_t size() const { return nodes.size(); }
+    node_id parent(node_id id) const { return nodes[id].parent; }
+    const std::vector<PW_TRANSFORM_ID>& chain(node_id id) const { return nodes[id].chain; }
+    // The whole chain of the node, compiled on its own
+    const std::shared_ptr<const transformer_pipeline>& pipeline(node_id id) const { return nodes[id].full; }
+
+    // Output of the chain of the node on the input (or its key), computing the
+    // missing ancestors. Return nullptr if the input is to be used as is, in
+    // which case failed tells whether a transformer failed.
+    const ddwaf_object* evaluate(node_id id, const ddwaf_object* input, bool onKey, transformation_cache& cache, arena* allocator, bool& failed) const;
+
+protected:
+    struct node
+    {
+        node_id parent;
+        std::vector<PW_TRANSFORM_ID> chain;
+        // Transformers between the parent and the node
+        transformer_pipeline suffix;
+        std::shared_ptr<const transformer_pipeline> full;
+    };
+
+    std::vector<node> nodes;
+    std::map<std::vector<PW_TRANSFORM_ID>, node_id> chainIndex;
+};
+
+}
+
+#endif /* TRANSFORMER_TRIE_H */
@@ -8,9 +8,14 @@
 #include <utils.h>
 
 size_t findStringCutoff(const char* str, size_t length)
+{
+    return findStringCutoff(str, length, DDWAF_MAX_STRING_LENGTH);
+}
+
+size_t findStringCutoff(const char* str, size_t length, size_t limit)
 {
     //If the string is shorter than our cap, then fine
-    if (length <= DDWAF_MAX_STRING_LENGTH)
+    if (length <= limit)
         return length;
 
     //If it's longer, we need to truncate it. However, we don't want to cut a UTF-8 byte sequence in the middle of it!
@@ -26,7 +31,7 @@ size_t findStringCutoff(const char* str, size_t length)
     // - 10: Middle of multi byte sequence, we need to step back
     // We therefore loop as long as we see the '10' sequence
 
-    size_t pos = DDWAF_MAX_STRING_LENGTH;
+    size_t pos = limit;
     while (pos != 0 && (str[pos] & 0xC0) == 0x80)
     {
         pos -= 1;
@@ -34,3 +39,19 @@ size_t findStringCutoff(const char* str, size_t length)
 
     return pos;
 }
+
+size_t findNextWindow(const char* str, size_t start, size_t end)
+{
+    //A window too short to overlap (only possible with invalid UTF-8) is simply followed by the next one
+    if (end - start <= 2 * STRING_WINDOW_OVERLAP)
+        return end;
+
+    //Same as above, step forward until the window starts on the first byte of a sequence
+    size_t pos = end - STRING_WINDOW_OVERLAP;
+    for (size_t step = 0; step < 3 && (str[pos] & 0xC0) == 0x80; ++step)
+    {
+        pos += 1;
+    }
+
+    return pos;
+}
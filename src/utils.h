@@ -10,6 +10,10 @@
 #include <stdint.h>
 
 size_t findStringCutoff(const char* str, size_t length);
+size_t findStringCutoff(const char* str, size_t length, size_t limit);
+// Start of the window following [start, end), overlapping its last
+// STRING_WINDOW_OVERLAP bytes without splitting a UTF-8 sequence
+size_t findNextWindow(const char* str, size_t start, size_t end);
 
 //Internals
 #define OBJ_HAS_KEY(obj, key) (obj.IsObject() && obj.HasMember(key))
@@ -29,6 +33,7 @@ size_t findStringCutoff(const char* str, size_t length);
 #define MAX_MATCH_COUNT 16 // Match the type size of RuleMatchTarget::matchGroup, don't increase past 16 without carefully updating the code
 #define ADDITIVE_BUFFER_PREALLOC 8
 #define TIME_STORE_DEFAULT 5
+#define STRING_WINDOW_OVERLAP 512 // Longest match guaranteed to be found across two windows of a long string
 
 // Flow steps
 #define EXIT_PREFIX "exit_"
@@ -62,13 +67,6 @@ size_t findStringCutoff(const char* str, size_t length);
 #define PROD_STATIC static
 #endif
 
-// IP Utils
-typedef struct
-{
-    uint8_t ip[16]; // big endian
-    bool isIPv6;
-} parsed_ip;
-
 // Need the ddwaf_object declaration
 #if !defined(pw_h)
 #include <ddwaf.h>
@@ -0,0 +1,129 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include <worker_pool.hpp>
+
+namespace ddwaf
+{
+
+worker_pool::worker_pool(size_t count)
+{
+    threads.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        threads.emplace_back(&worker_pool::work, this);
+    }
+}
+
+worker_pool::~worker_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeup.notify_all();
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+size_t worker_pool::claim(job& current)
+{
+    const size_t index = current.next++;
+    // Nothing left to hand out, nobody should pick this job anymore
+    if (current.next == current.count)
+    {
+        for (auto it = queue.begin(); it != queue.end(); ++it)
+        {
+            if (*it == &current)
+            {
+                queue.erase(it);
+                break;
+            }
+        }
+    }
+    return index;
+}
+
+void worker_pool::execute(job& current, size_t index, std::unique_lock<std::mutex>& lock)
+{
+    lock.unlock();
+
+    std::exception_ptr error;
+    try
+    {
+        current.task(index);
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+
+    lock.lock();
+    if (error && !current.error)
+    {
+        current.error = error;
+    }
+
+    // The job lives on the stack of the caller of run, which may return as
+    // soon as remaining reaches 0: notify while holding the lock
+    if (--current.remaining == 0)
+    {
+        current.done.notify_all();
+    }
+}
+
+void worker_pool::run(size_t count, const std::function<void(size_t)>& task)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    job current(task, count);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    if (count > 1 && !threads.empty())
+    {
+        queue.push_back(&current);
+        wakeup.notify_all();
+    }
+
+    // Take our share of the work, and whatever the workers didn't pick up
+    while (current.next < current.count)
+    {
+        const size_t index = claim(current);
+        execute(current, index, lock);
+    }
+
+    current.done.wait(lock, [&current] { return current.remaining == 0; });
+
+    if (current.error)
+    {
+        std::rethrow_exception(current.error);
+    }
+}
+
+void worker_pool::work()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        wakeup.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (stopping)
+        {
+            return;
+        }
+
+        job& current       = *queue.front();
+        const size_t index = claim(current);
+        execute(current, index, lock);
+    }
+}
+
+}
@@ -0,0 +1,68 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ddwaf
+{
+
+// Small set of threads shared by the contexts of a handle, used to split the
+// evaluation of a run. The calling thread always takes part in the work, so a
+// pool of N threads runs up to N + 1 tasks at once.
+class worker_pool
+{
+public:
+    explicit worker_pool(size_t threads);
+    ~worker_pool();
+
+    worker_pool(const worker_pool&) = delete;
+    worker_pool& operator=(const worker_pool&) = delete;
+
+    size_t size() const { return threads.size(); }
+
+    // Call task(i) for every i in [0, count) and return once they all
+    // completed. The first exception thrown by a task is rethrown.
+    void run(size_t count, const std::function<void(size_t)>& task);
+
+protected:
+    struct job
+    {
+        const std::function<void(size_t)>& task;
+        const size_t count;
+        size_t next { 0 };      // Next index to hand out
+        size_t remaining;       // Tasks not completed yet
+        std::exception_ptr error;
+        std::condition_variable done;
+
+        job(const std::function<void(size_t)>& task_, size_t count_)
+            : task(task_), count(count_), remaining(count_) {}
+    };
+
+    // Hand out the next index of the job, must be called with the lock held
+    size_t claim(job& current);
+    void execute(job& current, size_t index, std::unique_lock<std::mutex>& lock);
+    void work();
+
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::deque<job*> queue;
+    bool stopping { false };
+    std::vector<std::thread> threads;
+};
+
+}
+
+#endif // WORKER_POOL_H
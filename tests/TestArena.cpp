@@ -0,0 +1,67 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include "test.h"
+
+using namespace ddwaf;
+
+TEST(TestArena, TestAllocate)
+{
+    arena allocator(64);
+    EXPECT_EQ(allocator.stats().blocks, 1);
+
+    char* str = allocator.copy("sqreen", 6);
+    EXPECT_STREQ(str, "sqreen");
+
+    void* aligned = allocator.allocate(sizeof(uint64_t), alignof(uint64_t));
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(aligned) % alignof(uint64_t), 0);
+
+    EXPECT_EQ(allocator.stats().allocations, 2);
+    EXPECT_EQ(allocator.stats().bytes, 7 + sizeof(uint64_t));
+    EXPECT_EQ(allocator.stats().blocks, 1);
+
+    // Doesn't fit in the first block
+    allocator.allocate(100);
+    EXPECT_EQ(allocator.stats().blocks, 2);
+}
+
+TEST(TestArena, TestReset)
+{
+    arena allocator(64);
+    allocator.allocate(48);
+    allocator.allocate(48);
+    EXPECT_EQ(allocator.stats().blocks, 2);
+
+    // The blocks are merged, the same allocations then fit in one
+    allocator.reset();
+    EXPECT_EQ(allocator.stats().blocks, 3);
+
+    allocator.allocate(48);
+    allocator.allocate(48);
+    EXPECT_EQ(allocator.stats().blocks, 3);
+
+    // A single block is kept as is
+    allocator.reset();
+    allocator.allocate(48);
+    EXPECT_EQ(allocator.stats().blocks, 3);
+}
+
+TEST(TestArena, TestContainers)
+{
+    arena allocator(64);
+
+    arena_string str("a string long enough to not fit in the small buffer", &allocator);
+    EXPECT_EQ(allocator.stats().allocations, 1);
+
+    arena_vector<int> vec(&allocator);
+    vec.push_back(1);
+    EXPECT_EQ(allocator.stats().allocations, 2);
+
+    // Without arena, the global allocator is used
+    arena_string global("a string long enough to not fit in the small buffer");
+    EXPECT_EQ(allocator.stats().allocations, 2);
+    EXPECT_EQ(str, global);
+}
@@ -5,127 +5,222 @@
 // Copyright 2021 Datadog, Inc.
 
 #include "test.h"
-#include <radixlib.h>
+#include <ip_set.hpp>
 
-bool parseIP(const char* ipString, parsed_ip& parsed);
-bool parseCIDR(const char* ipString, size_t stringLength, prefix_t& prefix);
+using ddwaf::ip_address;
 
-TEST(TestIP, DISABLED_ParsingIPv4)
+TEST(TestIP, ParsingIPv4)
 {
-    /* parsed_ip ip;*/
-
-    //EXPECT_TRUE(parseIP("1.2.3.4", ip));
-    //EXPECT_FALSE(ip.isIPv6);
-    //EXPECT_EQ(ip.ip[0], 1);
-    //EXPECT_EQ(ip.ip[1], 2);
-    //EXPECT_EQ(ip.ip[2], 3);
-    /*EXPECT_EQ(ip.ip[3], 4);*/
+    ip_address ip;
+
+    EXPECT_TRUE(ddwaf::parse_ip("1.2.3.4", ip));
+    EXPECT_TRUE(ip.isMappedIPv4());
+    EXPECT_EQ(ip.hi, 0);
+    EXPECT_EQ(ip.lo, 0xffff01020304);
+
+    EXPECT_TRUE(ddwaf::parse_ip("255.255.255.255", ip));
+    EXPECT_EQ(ip.lo, 0xffffffffffff);
+
+    EXPECT_TRUE(ddwaf::parse_ip("0.0.0.0", ip));
+    EXPECT_EQ(ip.lo, 0xffff00000000);
 }
 
-TEST(TestIP, DISABLED_ParsingIPv4Class)
+TEST(TestIP, ParsingIPv4Class)
 {
-    //parsed_ip ip;
-
-    //// Unless the system does, we don't support classfull IPs
-    //EXPECT_FALSE(parseIP("1.257", ip));
-    ////	EXPECT_FALSE(ip.isIPv6);
-    ////	EXPECT_EQ(ip.ip[0], 1);
-    ////	EXPECT_EQ(ip.ip[1], 0);
-    ////	EXPECT_EQ(ip.ip[2], 1);
-    ////	EXPECT_EQ(ip.ip[3], 1);
+    ip_address ip;
+
+    // Same as inet_pton, we don't support classfull IPs nor leading zeros
+    EXPECT_FALSE(ddwaf::parse_ip("1.257", ip));
+    EXPECT_FALSE(ddwaf::parse_ip("1.2.3", ip));
+    EXPECT_FALSE(ddwaf::parse_ip("01.2.3.4", ip));
+    EXPECT_FALSE(ddwaf::parse_ip("1.2.3.256", ip));
+    EXPECT_FALSE(ddwaf::parse_ip("1.2.3.4.5", ip));
+    EXPECT_FALSE(ddwaf::parse_ip("1.2.3.4.", ip));
+    EXPECT_FALSE(ddwaf::parse_ip("1..3.4", ip));
 }
 
-TEST(TestIP, DISABLED_ParsingIPv6)
+TEST(TestIP, ParsingIPv6)
 {
-    //parsed_ip ip;
+    ip_address ip;
+
+    EXPECT_TRUE(ddwaf::parse_ip("abcd::ef01", ip));
+    EXPECT_FALSE(ip.isMappedIPv4());
+    EXPECT_EQ(ip.hi, 0xabcd000000000000);
+    EXPECT_EQ(ip.lo, 0xef01);
+
+    EXPECT_TRUE(ddwaf::parse_ip("1:2:3:4:5:6:7:8", ip));
+    EXPECT_EQ(ip.hi, 0x0001000200030004);
+    EXPECT_EQ(ip.lo, 0x0005000600070008);
+
+    EXPECT_TRUE(ddwaf::parse_ip("::", ip));
+    EXPECT_EQ(ip.hi, 0);
+    EXPECT_EQ(ip.lo, 0);
+
+    EXPECT_TRUE(ddwaf::parse_ip("1::", ip));
+    EXPECT_EQ(ip.hi, 0x0001000000000000);
+    EXPECT_EQ(ip.lo, 0);
 
-    //EXPECT_TRUE(parseIP("abcd::ef01", ip));
-    //EXPECT_TRUE(ip.isIPv6);
-    //EXPECT_EQ(ip.ip[0], 0xab);
-    //EXPECT_EQ(ip.ip[1], 0xcd);
-    //for(int i = 2; i < 14; ++i)
-    //EXPECT_EQ(ip.ip[i], 0);
+    EXPECT_TRUE(ddwaf::parse_ip("::FFFF:1.2.3.4", ip));
+    EXPECT_TRUE(ip.isMappedIPv4());
+    EXPECT_EQ(ip.lo, 0xffff01020304);
 
-    //EXPECT_EQ(ip.ip[14], 0xef);
-    //EXPECT_EQ(ip.ip[15], 0x01);
+    EXPECT_TRUE(ddwaf::parse_ip("1:2:3:4:5:6:1.2.3.4", ip));
+    EXPECT_EQ(ip.lo, 0x0005000601020304);
+}
+
+TEST(TestIP, ParsingBadIP)
+{
+    ip_address ip;
+    EXPECT_FALSE(ddwaf::parse_ip("not an IP", ip));
+    EXPECT_FALSE(ddwaf::parse_ip("", ip));
+    EXPECT_FALSE(ddwaf::parse_ip(":", ip));
+    EXPECT_FALSE(ddwaf::parse_ip(":1", ip));
+    EXPECT_FALSE(ddwaf::parse_ip("1:", ip));
+    EXPECT_FALSE(ddwaf::parse_ip("1::2::3", ip));
+    EXPECT_FALSE(ddwaf::parse_ip("1:::2", ip));
+    EXPECT_FALSE(ddwaf::parse_ip("12345::", ip));
+    EXPECT_FALSE(ddwaf::parse_ip("1:2:3:4:5:6:7", ip));
+    EXPECT_FALSE(ddwaf::parse_ip("1:2:3:4:5:6:7:8:9", ip));
+    EXPECT_FALSE(ddwaf::parse_ip("1:2:3:4:5:6:7::8", ip));
+    EXPECT_FALSE(ddwaf::parse_ip("1:2:3:4:5:6:7:1.2.3.4", ip));
+    EXPECT_FALSE(ddwaf::parse_ip("::1.2.3.4:1", ip));
+    EXPECT_FALSE(ddwaf::parse_ip("::g", ip));
+}
+
+TEST(TestIP, ParsingIPv4CIDR)
+{
+    ip_address first, last;
+    EXPECT_TRUE(ddwaf::parse_cidr("1.2.3.4/28", first, last));
+    EXPECT_EQ(first.hi, 0);
+    EXPECT_EQ(first.lo, 0xffff01020300);
+    EXPECT_EQ(last.hi, 0);
+    EXPECT_EQ(last.lo, 0xffff0102030f);
+
+    EXPECT_TRUE(ddwaf::parse_cidr("1.2.3.4/0", first, last));
+    EXPECT_EQ(first.lo, 0xffff00000000);
+    EXPECT_EQ(last.lo, 0xffffffffffff);
 }
 
-TEST(TestIP, DISABLED_ParsingBadIP)
+TEST(TestIP, ParsingIPv4AsCIDR)
 {
-    //parsed_ip ip;
-    //EXPECT_FALSE(parseIP("not an IP", ip));
+    ip_address first, last;
+    EXPECT_TRUE(ddwaf::parse_cidr("1.2.3.4", first, last));
+    EXPECT_EQ(first, last);
+    EXPECT_EQ(first.lo, 0xffff01020304);
 }
 
-TEST(TestIP, DISABLED_ParsingIPv4CIDR)
+TEST(TestIP, ParsingIPv6CIDR)
 {
-    //prefix_t ip;
-    //EXPECT_TRUE(parseCIDR("1.2.3.4/28", strlen("1.2.3.4/28"), ip));
-    //EXPECT_EQ(ip.family, FAMILY_IPv6);
-
-    //// Check address
-    //for(int i = 0; i < 10; ++i)
-    //{
-    //EXPECT_EQ(ip.add.sin6[i], 0);
-    //}
-    //EXPECT_EQ(ip.add.sin6[10], 0xff);
-    //EXPECT_EQ(ip.add.sin6[11], 0xff);
-    //EXPECT_EQ(ip.add.sin6[12], 0x01);
-    //EXPECT_EQ(ip.add.sin6[13], 0x02);
-    //EXPECT_EQ(ip.add.sin6[14], 0x03);
-    //EXPECT_EQ(ip.add.sin6[15], 0x00);
-
-    //// Check mask
-    //EXPECT_EQ(ip.bitlen, 128 - 32 + 28);
+    ip_address first, last;
+    EXPECT_TRUE(ddwaf::parse_cidr("aBcD::efff/121", first, last));
+    EXPECT_EQ(first.hi, 0xabcd000000000000);
+    EXPECT_EQ(first.lo, 0xef80);
+    EXPECT_EQ(last.hi, 0xabcd000000000000);
+    EXPECT_EQ(last.lo, 0xefff);
+
+    EXPECT_TRUE(ddwaf::parse_cidr("abcd:1234::/20", first, last));
+    EXPECT_EQ(first.hi, 0xabcd100000000000);
+    EXPECT_EQ(first.lo, 0);
+    EXPECT_EQ(last.hi, 0xabcd1fffffffffff);
+    EXPECT_EQ(last.lo, 0xffffffffffffffff);
+
+    EXPECT_TRUE(ddwaf::parse_cidr("::/0", first, last));
+    EXPECT_EQ(first.hi, 0);
+    EXPECT_EQ(first.lo, 0);
+    EXPECT_EQ(last.hi, 0xffffffffffffffff);
+    EXPECT_EQ(last.lo, 0xffffffffffffffff);
 }
 
-TEST(TestIP, DISABLED_ParsingIPv4AsCIDR)
+TEST(TestIP, ParsingBadNetMask)
 {
-    //prefix_t ip;
-    //EXPECT_TRUE(parseCIDR("1.2.3.4", strlen("1.2.3.4"), ip));
-    //EXPECT_EQ(ip.family, FAMILY_IPv6);
-
-    //// Check address
-    //for(int i = 0; i < 10; ++i)
-    //{
-    //EXPECT_EQ(ip.add.sin6[i], 0);
-    //}
-    //EXPECT_EQ(ip.add.sin6[10], 0xff);
-    //EXPECT_EQ(ip.add.sin6[11], 0xff);
-    //EXPECT_EQ(ip.add.sin6[12], 0x01);
-    //EXPECT_EQ(ip.add.sin6[13], 0x02);
-    //EXPECT_EQ(ip.add.sin6[14], 0x03);
-    //EXPECT_EQ(ip.add.sin6[15], 0x04);
-
-    //// Check mask
-    //EXPECT_EQ(ip.bitlen, 128);
+    ip_address first, last;
+    EXPECT_FALSE(ddwaf::parse_cidr("bad ip", first, last));
+    EXPECT_FALSE(ddwaf::parse_cidr("1.2.3.4/", first, last));
+    EXPECT_FALSE(ddwaf::parse_cidr("1.2.3.4/1234", first, last));
+    EXPECT_FALSE(ddwaf::parse_cidr("1.2.3.4/33", first, last));
+    EXPECT_FALSE(ddwaf::parse_cidr("::1/129", first, last));
+    EXPECT_FALSE(ddwaf::parse_cidr("::1/a", first, last));
+    EXPECT_FALSE(ddwaf::parse_cidr("not an IP/a", first, last));
+    EXPECT_FALSE(ddwaf::parse_cidr("not an IP but also very very very very long/a", first, last));
 }
 
-TEST(TestIP, DISABLED_ParsingIPv6CIDR)
+TEST(TestIP, SetLookup)
 {
-    //prefix_t ip;
-    //EXPECT_TRUE(parseCIDR("aBcD::efff/121", strlen("aBcD::efff/120"), ip));
-    //EXPECT_EQ(ip.family, FAMILY_IPv6);
-
-    //// Check address
-    //EXPECT_EQ(ip.add.sin6[0], 0xab);
-    //EXPECT_EQ(ip.add.sin6[1], 0xcd);
-    //for(int i = 2; i < 14; ++i)
-    //EXPECT_EQ(ip.add.sin6[i], 0);
-    //EXPECT_EQ(ip.add.sin6[15], 0x80);
-
-    //// Check mask
-    //EXPECT_EQ(ip.bitlen, 121);
+    ddwaf::ip_set set({ "1.2.3.0/24", "1.2.4.0/24", "1.2.3.128/25", "10.0.0.1", "abcd::/16", "::1", "invalid" });
+
+    // The first three networks are merged
+    EXPECT_EQ(set.size(), 4);
+    EXPECT_EQ(set.invalid(), 1);
+
+    EXPECT_TRUE(set.contains("1.2.3.0"));
+    EXPECT_TRUE(set.contains("1.2.3.255"));
+    EXPECT_TRUE(set.contains("1.2.4.255"));
+    EXPECT_TRUE(set.contains("::ffff:1.2.4.1"));
+    EXPECT_TRUE(set.contains("10.0.0.1"));
+    EXPECT_TRUE(set.contains("abcd:ffff::1"));
+    EXPECT_TRUE(set.contains("::1"));
+
+    EXPECT_FALSE(set.contains("1.2.2.255"));
+    EXPECT_FALSE(set.contains("1.2.5.0"));
+    EXPECT_FALSE(set.contains("10.0.0.2"));
+    EXPECT_FALSE(set.contains("abce::"));
+    EXPECT_FALSE(set.contains("::2"));
+    EXPECT_FALSE(set.contains("0.0.0.0"));
+    EXPECT_FALSE(set.contains("255.255.255.255"));
+    EXPECT_FALSE(set.contains("invalid"));
+
+    // IPv4 addresses are also covered by IPv6 networks
+    ddwaf::ip_set all({ "::/0" });
+    EXPECT_TRUE(all.contains("1.2.3.4"));
+    EXPECT_TRUE(all.contains("::"));
+    EXPECT_TRUE(all.contains("ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff"));
+
+    ddwaf::ip_set empty(std::vector<std::string_view> {});
+    EXPECT_FALSE(empty.contains("1.2.3.4"));
+    EXPECT_FALSE(empty.contains("::1"));
 }
 
-TEST(TestIP, DISABLED_ParsingBadNetMask)
+TEST(TestIP, SetLookupLarge)
 {
-    //prefix_t ip;
-    //EXPECT_FALSE(parseCIDR("bad ip", strlen("bad ip"), ip));
-    //EXPECT_FALSE(parseCIDR("1.2.3.4/", strlen("1.2.3.4/"), ip));
-    //EXPECT_FALSE(parseCIDR("1.2.3.4/1234", strlen("1.2.3.4/1234"), ip));
-    //EXPECT_FALSE(parseCIDR("1.2.3.4/33", strlen("1.2.3.4/33"), ip));
-    //EXPECT_FALSE(parseCIDR("::1/129", strlen("::1/129"), ip));
-    //EXPECT_FALSE(parseCIDR("::1/a", strlen("::1/a"), ip));
-    //EXPECT_FALSE(parseCIDR("not an IP/a", strlen("not an IP/a"), ip));
-    //EXPECT_FALSE(parseCIDR("not an IP but also very very very very long/a", strlen("not an IP but also very very very very long/a"), ip));
+    // Enough networks to index the ranges by bucket, compared to a naive scan
+    std::vector<std::string> networks;
+    std::vector<std::pair<uint32_t, uint32_t>> ranges;
+    uint32_t seed = 42;
+    auto next     = [&seed]() { return seed = seed * 1103515245 + 12345; };
+    for (int i = 0; i < 5000; ++i)
+    {
+        const uint32_t address = next();
+        const uint32_t length  = 16 + next() % 17;
+        const uint32_t mask    = length == 32 ? 0xffffffff : ~(0xffffffff >> length);
+        ranges.emplace_back(address & mask, (address & mask) | ~mask);
+        networks.push_back(std::to_string(address >> 24) + "." + std::to_string((address >> 16) & 0xff) + "." + std::to_string((address >> 8) & 0xff) + "." + std::to_string(address & 0xff) + "/" + std::to_string(length));
+    }
+
+    ddwaf::ip_set set(std::vector<std::string_view>(networks.begin(), networks.end()));
+    EXPECT_EQ(set.invalid(), 0);
+
+    for (int i = 0; i < 100000; ++i)
+    {
+        // Half of the lookups near a bound of a network
+        uint32_t address = next();
+        if (i % 2 == 0)
+        {
+            const auto& range = ranges[next() % ranges.size()];
+            address           = (next() % 2 == 0 ? range.first : range.second) + (next() % 3) - 1;
+        }
+
+        bool expected = false;
+        for (const auto& [first, last] : ranges)
+        {
+            if (address >= first && address <= last)
+            {
+                expected = true;
+                break;
+            }
+        }
+
+        ddwaf::ip_address ip;
+        ip.lo = 0xffff00000000 | address;
+        EXPECT_EQ(set.contains(ip), expected) << address;
+    }
 }
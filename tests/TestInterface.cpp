@@ -207,6 +207,264 @@ TEST(FunctionalTests, HandleGood)
     ddwaf_destroy(handle);
 }
 
+TEST(FunctionalTests, ObjectResult)
+{
+    auto rule = readFile("interface2.yaml");
+    ASSERT_TRUE(rule.type != DDWAF_OBJ_INVALID);
+
+    ddwaf_options options     = { sizeof(ddwaf_options), DDWAF_RESULT_OBJECT };
+    const ddwaf_handle handle = ddwaf_init_with_options(&rule, nullptr, &options);
+    ASSERT_NE(handle, nullptr);
+
+    ddwaf_context context = ddwaf_context_init(handle, ddwaf_object_free);
+    ASSERT_NE(context, nullptr);
+
+    ddwaf_object parameter = DDWAF_OBJECT_MAP, tmp;
+    ddwaf_object param_key = DDWAF_OBJECT_MAP, param_val = DDWAF_OBJECT_ARRAY;
+
+    ddwaf_object_map_add(&param_key, "derp", ddwaf_object_unsigned(&tmp, 4242));
+    ddwaf_object_map_add(&param_key, "bla", ddwaf_object_string(&tmp, "rule3"));
+
+    ddwaf_object_array_add(&param_val, ddwaf_object_string(&tmp, "rule2"));
+
+    ddwaf_object_map_add(&parameter, "value2", &param_key);
+    ddwaf_object_map_add(&parameter, "value1", &param_val);
+
+    ddwaf_result ret;
+    ddwaf_object matches;
+    EXPECT_EQ(ddwaf_run_with_matches(context, &parameter, &ret, &matches, LONG_TIME), DDWAF_MONITOR);
+    EXPECT_EQ(ret.data, nullptr);
+
+    // [{"rule":{...},"rule_matches":[...]}]
+    ASSERT_EQ(matches.type, DDWAF_OBJ_ARRAY);
+    ASSERT_EQ(matches.nbEntries, 1);
+
+    const ddwaf_object& event = matches.array[0];
+    ASSERT_EQ(event.type, DDWAF_OBJ_MAP);
+    ASSERT_EQ(event.nbEntries, 2);
+    EXPECT_STREQ(event.array[0].parameterName, "rule");
+    EXPECT_STREQ(event.array[0].array[0].parameterName, "id");
+    EXPECT_STREQ(event.array[0].array[0].stringValue, "1");
+
+    const ddwaf_object& ruleMatches = event.array[1];
+    EXPECT_STREQ(ruleMatches.parameterName, "rule_matches");
+    ASSERT_EQ(ruleMatches.type, DDWAF_OBJ_ARRAY);
+    ASSERT_EQ(ruleMatches.nbEntries, 2);
+
+    // {"operator":...,"operator_value":...,"parameters":[{"address":...,"key_path":[0],...}]}
+    const ddwaf_object& param = ruleMatches.array[0].array[2].array[0];
+    EXPECT_STREQ(param.array[0].stringValue, "value1");
+    const ddwaf_object& keyPath = param.array[1];
+    EXPECT_STREQ(keyPath.parameterName, "key_path");
+    ASSERT_EQ(keyPath.nbEntries, 1);
+    EXPECT_EQ(keyPath.array[0].type, DDWAF_OBJ_UNSIGNED);
+    EXPECT_EQ(keyPath.array[0].uintValue, 0);
+
+    ddwaf_result_free(&ret);
+    ddwaf_object_free(&matches);
+    ddwaf_context_destroy(context);
+    ddwaf_destroy(handle);
+
+    // Options past the size provided by the caller are ignored
+    options.size                  = offsetof(ddwaf_options, resultFormat);
+    const ddwaf_handle jsonHandle = ddwaf_init_with_options(&rule, nullptr, &options);
+    ddwaf_object_free(&rule);
+    ASSERT_NE(jsonHandle, nullptr);
+
+    context = ddwaf_context_init(jsonHandle, ddwaf_object_free);
+    ASSERT_NE(context, nullptr);
+
+    parameter = DDWAF_OBJECT_MAP;
+    ddwaf_object_map_add(&parameter, "value1", ddwaf_object_string(&tmp, "rule2"));
+    ddwaf_object_map_add(&parameter, "value2", ddwaf_object_string(&tmp, "rule3"));
+    EXPECT_EQ(ddwaf_run_with_matches(context, &parameter, &ret, &matches, LONG_TIME), DDWAF_MONITOR);
+    EXPECT_NE(ret.data, nullptr);
+    EXPECT_EQ(matches.type, DDWAF_OBJ_INVALID);
+    ddwaf_result_free(&ret);
+
+    ddwaf_context_destroy(context);
+    ddwaf_destroy(jsonHandle);
+}
+
+TEST(FunctionalTests, RunMany)
+{
+    auto rule = readFile("interface2.yaml");
+    ASSERT_TRUE(rule.type != DDWAF_OBJ_INVALID);
+
+    const ddwaf_handle handle = ddwaf_init(&rule, NULL);
+    ddwaf_object_free(&rule);
+    ASSERT_NE(handle, nullptr);
+
+    ddwaf_context contexts[3] = {
+        ddwaf_context_init(handle, ddwaf_object_free),
+        nullptr,
+        ddwaf_context_init(handle, ddwaf_object_free),
+    };
+    ASSERT_NE(contexts[0], nullptr);
+    ASSERT_NE(contexts[2], nullptr);
+
+    ddwaf_object data[3] = { DDWAF_OBJECT_MAP, DDWAF_OBJECT_MAP, DDWAF_OBJECT_MAP }, tmp;
+    ddwaf_object param_key = DDWAF_OBJECT_MAP, param_val = DDWAF_OBJECT_ARRAY;
+    ddwaf_object_map_add(&param_key, "bla", ddwaf_object_string(&tmp, "rule3"));
+    ddwaf_object_array_add(&param_val, ddwaf_object_string(&tmp, "rule2"));
+    ddwaf_object_map_add(&data[0], "value2", &param_key);
+    ddwaf_object_map_add(&data[0], "value1", &param_val);
+
+    ddwaf_object_map_add(&data[2], "value1", ddwaf_object_string(&tmp, "nothing"));
+
+    // The error of the second item is reported over the match of the first
+    ddwaf_result results[3];
+    EXPECT_EQ(ddwaf_run_many(contexts, data, results, 3, LONG_TIME), DDWAF_ERR_INVALID_ARGUMENT);
+
+    EXPECT_EQ(results[0].action, DDWAF_MONITOR);
+    EXPECT_STREQ(results[0].data, R"([{"rule":{"id":"1","name":"rule1","tags":{"type":"flow1","category":"category1"}},"rule_matches":[{"operator":"match_regex","operator_value":"rule2","parameters":[{"address":"value1","key_path":[0],"value":"rule2","highlight":["rule2"]}]},{"operator":"match_regex","operator_value":"rule3","parameters":[{"address":"value2","key_path":["bla"],"value":"rule3","highlight":["rule3"]}]}]}])");
+    EXPECT_EQ(results[1].action, DDWAF_ERR_INVALID_ARGUMENT);
+    EXPECT_EQ(results[2].action, DDWAF_GOOD);
+    EXPECT_EQ(results[2].data, nullptr);
+
+    for (ddwaf_result& result : results)
+    {
+        ddwaf_result_free(&result);
+    }
+
+    // Not owned by any context
+    ddwaf_object_free(&data[1]);
+
+    EXPECT_EQ(ddwaf_run_many(nullptr, data, results, 3, LONG_TIME), DDWAF_ERR_INVALID_ARGUMENT);
+    EXPECT_EQ(ddwaf_run_many(contexts, data, NULL, 0, LONG_TIME), DDWAF_GOOD);
+
+    ddwaf_context_destroy(contexts[0]);
+    ddwaf_context_destroy(contexts[2]);
+
+    // Without error, the most severe code of the batch
+    ddwaf_context batch[2] = {
+        ddwaf_context_init(handle, ddwaf_object_free),
+        ddwaf_context_init(handle, ddwaf_object_free),
+    };
+    ASSERT_NE(batch[0], nullptr);
+    ASSERT_NE(batch[1], nullptr);
+
+    ddwaf_object batchData[2] = { DDWAF_OBJECT_MAP, DDWAF_OBJECT_MAP };
+    ddwaf_object_map_add(&batchData[0], "value1", ddwaf_object_string(&tmp, "nothing"));
+    param_key = DDWAF_OBJECT_MAP;
+    param_val = DDWAF_OBJECT_ARRAY;
+    ddwaf_object_map_add(&param_key, "bla", ddwaf_object_string(&tmp, "rule3"));
+    ddwaf_object_array_add(&param_val, ddwaf_object_string(&tmp, "rule2"));
+    ddwaf_object_map_add(&batchData[1], "value2", &param_key);
+    ddwaf_object_map_add(&batchData[1], "value1", &param_val);
+
+    EXPECT_EQ(ddwaf_run_many(batch, batchData, NULL, 2, LONG_TIME), DDWAF_MONITOR);
+
+    ddwaf_context_destroy(batch[0]);
+    ddwaf_context_destroy(batch[1]);
+    ddwaf_destroy(handle);
+}
+
+TEST(FunctionalTests, ParallelFlows)
+{
+    auto rule = readFile("interface.yaml");
+    ASSERT_TRUE(rule.type != DDWAF_OBJ_INVALID);
+
+    ddwaf_options options       = { sizeof(ddwaf_options), DDWAF_RESULT_JSON, 4 };
+    ddwaf_handle serialHandle   = ddwaf_init(&rule, nullptr);
+    ddwaf_handle parallelHandle = ddwaf_init_with_options(&rule, nullptr, &options);
+    ddwaf_object_free(&rule);
+    ASSERT_NE(serialHandle, nullptr);
+    ASSERT_NE(parallelHandle, nullptr);
+
+    ddwaf_context serial   = ddwaf_context_init(serialHandle, ddwaf_object_free);
+    ddwaf_context parallel = ddwaf_context_init(parallelHandle, ddwaf_object_free);
+    ASSERT_NE(serial, nullptr);
+    ASSERT_NE(parallel, nullptr);
+
+    // Both flows match on the second call
+    const std::vector<std::pair<const char*, const char*>> batches {
+        { "value1", "nothing" },
+        { "value2", "rule1" },
+        { "value1", "rule2" },
+    };
+
+    for (const auto& [address, value] : batches)
+    {
+        ddwaf_object serialParam = DDWAF_OBJECT_MAP, parallelParam = DDWAF_OBJECT_MAP, tmp;
+        ddwaf_object_map_add(&serialParam, address, ddwaf_object_string(&tmp, value));
+        ddwaf_object_map_add(&parallelParam, address, ddwaf_object_string(&tmp, value));
+
+        ddwaf_result serialRet, parallelRet;
+        EXPECT_EQ(ddwaf_run(serial, &serialParam, &serialRet, LONG_TIME),
+                  ddwaf_run(parallel, &parallelParam, &parallelRet, LONG_TIME));
+        EXPECT_EQ(serialRet.action, parallelRet.action);
+        if (serialRet.data == nullptr)
+        {
+            EXPECT_EQ(parallelRet.data, nullptr);
+        }
+        else
+        {
+            EXPECT_STREQ(serialRet.data, parallelRet.data);
+        }
+
+        ddwaf_result_free(&serialRet);
+        ddwaf_result_free(&parallelRet);
+    }
+
+    ddwaf_context_destroy(serial);
+    ddwaf_context_destroy(parallel);
+    ddwaf_destroy(serialHandle);
+    ddwaf_destroy(parallelHandle);
+}
+
+TEST(FunctionalTests, RegexMemory)
+{
+    auto rule = readFile("interface.yaml");
+    ASSERT_TRUE(rule.type != DDWAF_OBJ_INVALID);
+
+    // Large enough to compile the regular expressions, but not their DFA
+    ddwaf_options options = { sizeof(ddwaf_options), DDWAF_RESULT_JSON, 0, 0, 6000, true };
+    ddwaf_handle handle   = ddwaf_init_with_options(&rule, nullptr, &options);
+    ASSERT_NE(handle, nullptr);
+
+    // The warm-up already ran out of memory
+    const uint64_t fallbacks = ddwaf_regex_fallbacks(handle);
+    EXPECT_GT(fallbacks, 0);
+    EXPECT_LE(reinterpret_cast<PowerWAF*>(handle)->regexMemory(), options.maxRegexMemory);
+
+    ddwaf_context context = ddwaf_context_init(handle, ddwaf_object_free);
+    ASSERT_NE(context, nullptr);
+
+    ddwaf_object param = DDWAF_OBJECT_MAP, tmp;
+    ddwaf_object_map_add(&param, "value1", ddwaf_object_string(&tmp, "rule1"));
+    EXPECT_EQ(ddwaf_run(context, &param, nullptr, LONG_TIME), DDWAF_MONITOR);
+    EXPECT_GT(ddwaf_regex_fallbacks(handle), fallbacks);
+
+    ddwaf_context_destroy(context);
+    ddwaf_destroy(handle);
+
+    // The sets and prefilters are accounted for in the budget
+    options.maxRegexMemory = 1024 * 1024;
+    handle                 = ddwaf_init_with_options(&rule, nullptr, &options);
+    ASSERT_NE(handle, nullptr);
+    EXPECT_GT(reinterpret_cast<PowerWAF*>(handle)->regexMemory(), 0);
+    EXPECT_LE(reinterpret_cast<PowerWAF*>(handle)->regexMemory(), options.maxRegexMemory);
+    ddwaf_destroy(handle);
+
+    // Too small for any of them, they get the smallest budget they compile in
+    options.maxRegexMemory = 100;
+    handle                 = ddwaf_init_with_options(&rule, nullptr, &options);
+    ASSERT_NE(handle, nullptr);
+    EXPECT_GT(reinterpret_cast<PowerWAF*>(handle)->regexMemory(), options.maxRegexMemory);
+    EXPECT_LT(reinterpret_cast<PowerWAF*>(handle)->regexMemory(), 3 * RE2Manager::defaultMaxMemory);
+    ddwaf_destroy(handle);
+
+    options.maxRegexMemory = 0;
+    handle                 = ddwaf_init_with_options(&rule, nullptr, &options);
+    ASSERT_NE(handle, nullptr);
+    EXPECT_EQ(ddwaf_regex_fallbacks(handle), 0);
+    ddwaf_destroy(handle);
+
+    EXPECT_EQ(ddwaf_regex_fallbacks(nullptr), 0);
+    ddwaf_object_free(&rule);
+}
+
 TEST(FunctionalTests, HandleBad)
 {
     ddwaf_object tmp, object = DDWAF_OBJECT_INVALID;
@@ -203,3 +203,23 @@ TEST(TestUTF8, TestLongUTF8)
     memcpy(&buffer[DDWAF_MAX_STRING_LENGTH - 3], emoji, sizeof(emoji));
     EXPECT_EQ(findStringCutoff(buffer, (uint64_t) sizeof(buffer)), DDWAF_MAX_STRING_LENGTH);
 }
+
+TEST(TestUTF8, TestStringWindows)
+{
+    char buffer[3 * DDWAF_MAX_STRING_LENGTH] = { 0 };
+    const uint8_t emoji[]                    = { 0xe2, 0x98, 0xa2 };
+    memset(buffer, 'A', sizeof(buffer));
+
+    EXPECT_EQ(findStringCutoff(buffer, sizeof(buffer), 2 * DDWAF_MAX_STRING_LENGTH), 2 * DDWAF_MAX_STRING_LENGTH);
+    EXPECT_EQ(findStringCutoff(buffer, 100, 2 * DDWAF_MAX_STRING_LENGTH), 100);
+
+    //The next window overlaps the end of the previous one
+    EXPECT_EQ(findNextWindow(buffer, 0, DDWAF_MAX_STRING_LENGTH), DDWAF_MAX_STRING_LENGTH - STRING_WINDOW_OVERLAP);
+
+    //But doesn't start in the middle of a sequence
+    memcpy(&buffer[DDWAF_MAX_STRING_LENGTH - STRING_WINDOW_OVERLAP - 1], emoji, sizeof(emoji));
+    EXPECT_EQ(findNextWindow(buffer, 0, DDWAF_MAX_STRING_LENGTH), DDWAF_MAX_STRING_LENGTH - STRING_WINDOW_OVERLAP + 2);
+
+    //Windows too short to overlap are followed back to back
+    EXPECT_EQ(findNextWindow(buffer, 0, STRING_WINDOW_OVERLAP), STRING_WINDOW_OVERLAP);
+}
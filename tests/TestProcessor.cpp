@@ -181,9 +181,9 @@ TEST(TestPWProcessor, TestCache)
         EXPECT_EQ(ret.action, DDWAF_GOOD);
         ddwaf_result_free(&ret);
 
-        EXPECT_GE(add->processor.ranCache.size(), 1);
-        EXPECT_FALSE(add->processor.ranCache.at("1").first);
-        EXPECT_EQ(add->processor.ranCache.at("1").second, add->processor.runCount);
+        EXPECT_FALSE(add->processor.isFirstRun());
+        EXPECT_FALSE(add->processor.matchedCache[0]);
+        EXPECT_EQ(add->processor.ranCache[0], add->processor.runCount);
     }
 
     {
@@ -194,8 +194,8 @@ TEST(TestPWProcessor, TestCache)
         EXPECT_EQ(ret.action, DDWAF_GOOD);
         ddwaf_result_free(&ret);
 
-        EXPECT_FALSE(add->processor.ranCache.at("1").first);
-        EXPECT_EQ(add->processor.ranCache.at("1").second, add->processor.runCount);
+        EXPECT_FALSE(add->processor.matchedCache[0]);
+        EXPECT_EQ(add->processor.ranCache[0], add->processor.runCount);
     }
 
     {
@@ -206,8 +206,8 @@ TEST(TestPWProcessor, TestCache)
         EXPECT_EQ(ret.action, DDWAF_MONITOR);
         EXPECT_STREQ(ret.data, R"([{"rule":{"id":"1","name":"rule1","tags":{"type":"flow1","category":"category1"}},"rule_matches":[{"operator":"match_regex","operator_value":"Sqreen","parameters":[{"address":"param","key_path":[],"value":"Sqreen","highlight":["Sqreen"]}]},{"operator":"match_regex","operator_value":"Sqreen","parameters":[{"address":"param2","key_path":[],"value":"Sqreen","highlight":["Sqreen"]}]}]}])");
 
-        EXPECT_TRUE(add->processor.ranCache.at("1").first);
-        EXPECT_EQ(add->processor.ranCache.at("1").second, add->processor.runCount);
+        EXPECT_TRUE(add->processor.matchedCache[0]);
+        EXPECT_EQ(add->processor.ranCache[0], add->processor.runCount);
 
         ddwaf_result_free(&ret);
     }
@@ -319,6 +319,139 @@ TEST(TestPWProcessor, TestMultiFlowCacheReport)
     ddwaf_destroy(handle);
 }
 
+TEST(TestPWProcessor, TestSharedTargets)
+{
+    // Both rules share param1, the first condition of rule2 is evaluated while walking it for rule1
+    auto rule = readRule(R"({version: '2.1', rules: [{id: 1, name: rule1, tags: {type: flow1, category: category1}, conditions: [{operator: match_regex, parameters: {inputs: [{address: param1}], regex: Sqreen}}, {operator: match_regex, parameters: {inputs: [{address: param2}], regex: Pony}}]}, {id: 2, name: rule2, tags: {type: flow2, category: category2}, conditions: [{operator: match_regex, parameters: {inputs: [{address: param1}], regex: Sqreen}}]}]})");
+    ASSERT_TRUE(rule.type != DDWAF_OBJ_INVALID);
+
+    ddwaf_handle handle = ddwaf_init(&rule, nullptr);
+    ASSERT_NE(handle, nullptr);
+    ddwaf_object_free(&rule);
+
+    ddwaf_result ret;
+    ddwaf_context context = ddwaf_context_init(handle, ddwaf_object_free);
+    ASSERT_NE(context, nullptr);
+
+    {
+        ddwaf_object param = DDWAF_OBJECT_MAP, tmp;
+        ddwaf_object_map_add(&param, "param1", ddwaf_object_string(&tmp, "Sqreen"));
+
+        EXPECT_EQ(ddwaf_run(context, &param, &ret, LONG_TIME), DDWAF_MONITOR);
+        EXPECT_STREQ(ret.data, R"([{"rule":{"id":"2","name":"rule2","tags":{"type":"flow2","category":"category2"}},"rule_matches":[{"operator":"match_regex","operator_value":"Sqreen","parameters":[{"address":"param1","key_path":[],"value":"Sqreen","highlight":["Sqreen"]}]}]}])");
+
+        ddwaf_result_free(&ret);
+    }
+
+    {
+        ddwaf_object param = DDWAF_OBJECT_MAP, tmp;
+        ddwaf_object_map_add(&param, "param2", ddwaf_object_string(&tmp, "Pony"));
+
+        EXPECT_EQ(ddwaf_run(context, &param, &ret, LONG_TIME), DDWAF_MONITOR);
+        EXPECT_STREQ(ret.data, R"([{"rule":{"id":"1","name":"rule1","tags":{"type":"flow1","category":"category1"}},"rule_matches":[{"operator":"match_regex","operator_value":"Sqreen","parameters":[{"address":"param1","key_path":[],"value":"Sqreen","highlight":["Sqreen"]}]},{"operator":"match_regex","operator_value":"Pony","parameters":[{"address":"param2","key_path":[],"value":"Pony","highlight":["Pony"]}]}]}])");
+
+        ddwaf_result_free(&ret);
+    }
+
+    ddwaf_context_destroy(context);
+    ddwaf_destroy(handle);
+}
+
+TEST(TestPWProcessor, TestFlowStop)
+{
+    // rule2 comes after rule1 in flow1, rule3 shares their target from another flow
+    auto rule = readRule(R"({version: '2.1', rules: [{id: 1, name: rule1, tags: {type: flow1, category: category1}, conditions: [{operator: match_regex, parameters: {inputs: [{address: param1}], regex: Sqreen}}]}, {id: 2, name: rule2, tags: {type: flow1, category: category1}, conditions: [{operator: match_regex, parameters: {inputs: [{address: param1}], regex: Pony}}]}, {id: 3, name: rule3, tags: {type: flow2, category: category2}, conditions: [{operator: match_regex, parameters: {inputs: [{address: param1}], regex: Pony}}]}]})");
+    ASSERT_TRUE(rule.type != DDWAF_OBJ_INVALID);
+
+    ddwaf_handle handle = ddwaf_init(&rule, nullptr);
+    ASSERT_NE(handle, nullptr);
+    ddwaf_object_free(&rule);
+
+    ddwaf_object param = DDWAF_OBJECT_MAP, array = DDWAF_OBJECT_ARRAY, tmp;
+    ddwaf_object_array_add(&array, ddwaf_object_string(&tmp, "Sqreen"));
+    ddwaf_object_array_add(&array, ddwaf_object_string(&tmp, "Pony"));
+    ddwaf_object_map_add(&param, "param1", &array);
+
+    PowerWAF* waf = reinterpret_cast<PowerWAF*>(handle);
+    PWRetriever wrapper(waf->manifest, DDWAF_MAX_MAP_DEPTH, DDWAF_MAX_ARRAY_LENGTH);
+    wrapper.addParameter(param);
+    ASSERT_TRUE(wrapper.isValid());
+
+    PWRetManager rManager(TIME_STORE_DEFAULT);
+    PWProcessor processor(wrapper, waf->rules, waf->targetIndex);
+    processor.startNewRun(SQPowerWAF::monotonic_clock::now() + chrono::microseconds(LONG_TIME));
+
+    auto flow = std::find_if(waf->flows.begin(), waf->flows.end(), [](const auto& f) { return f.first == "flow1"; });
+    ASSERT_NE(flow, waf->flows.end());
+    processor.runFlow(flow->first, flow->second, rManager);
+
+    const auto slotOf = [&](const std::string& id) {
+        auto match = std::find_if(waf->rules.begin(), waf->rules.end(), [&id](const auto& r) { return r.id == id; });
+        return processor.slotResults[waf->targetIndex.slots[match - waf->rules.begin()][0]];
+    };
+
+    // rule1 matched the first item, rule2 won't run and isn't fed the second one
+    EXPECT_GE(slotOf("1").match, 0);
+    EXPECT_NE(slotOf("2").run, processor.runCount);
+    EXPECT_GE(slotOf("3").match, 0);
+
+    ddwaf_result ret = rManager.synthetize();
+    ASSERT_NE(ret.data, nullptr);
+    EXPECT_NE(strstr(ret.data, R"("id":"1")"), nullptr);
+    EXPECT_EQ(strstr(ret.data, R"("id":"2")"), nullptr);
+    ddwaf_result_free(&ret);
+
+    ddwaf_object_free(&param);
+    ddwaf_destroy(handle);
+}
+
+TEST(TestPWProcessor, TestArena)
+{
+    auto rule = readRule(R"({version: '2.1', rules: [{id: 1, name: rule1, tags: {type: flow1, category: category1}, conditions: [{operator: match_regex, parameters: {inputs: [{address: param}], regex: ^sqreen$}}], transformers: [lowercase]}]})");
+    ASSERT_TRUE(rule.type != DDWAF_OBJ_INVALID);
+
+    ddwaf_handle handle = ddwaf_init(&rule, nullptr);
+    ASSERT_NE(handle, nullptr);
+    ddwaf_object_free(&rule);
+
+    ddwaf_context context = ddwaf_context_init(handle, ddwaf_object_free);
+    ASSERT_NE(context, nullptr);
+
+    PWAdditive* additive = reinterpret_cast<PWAdditive*>(context);
+    const ddwaf::arena::counters& stats = additive->processor.getArenaStats();
+    EXPECT_EQ(stats.allocations, 0);
+    EXPECT_EQ(stats.blocks, 1);
+
+    ddwaf_result ret;
+    {
+        ddwaf_object param = DDWAF_OBJECT_MAP, tmp;
+        ddwaf_object_map_add(&param, "param", ddwaf_object_string(&tmp, "PONY"));
+
+        EXPECT_EQ(ddwaf_run(context, &param, &ret, LONG_TIME), DDWAF_GOOD);
+        ddwaf_result_free(&ret);
+    }
+
+    // The transformed copy came from the arena
+    const uint64_t allocations = stats.allocations;
+    EXPECT_GT(allocations, 0);
+    EXPECT_EQ(stats.blocks, 1);
+
+    {
+        ddwaf_object param = DDWAF_OBJECT_MAP, tmp;
+        ddwaf_object_map_add(&param, "param", ddwaf_object_string(&tmp, "SQREEN"));
+
+        EXPECT_EQ(ddwaf_run(context, &param, &ret, LONG_TIME), DDWAF_MONITOR);
+        EXPECT_STREQ(ret.data, R"([{"rule":{"id":"1","name":"rule1","tags":{"type":"flow1","category":"category1"}},"rule_matches":[{"operator":"match_regex","operator_value":"^sqreen$","parameters":[{"address":"param","key_path":[],"value":"sqreen","highlight":["sqreen"]}]}]}])");
+        ddwaf_result_free(&ret);
+    }
+
+    EXPECT_GT(stats.allocations, allocations);
+    EXPECT_EQ(stats.blocks, 1);
+
+    ddwaf_context_destroy(context);
+    ddwaf_destroy(handle);
+}
+
 TEST(TestPWProcessor, TestBudget)
 {
     //Initialize a PowerWAF rule
@@ -349,12 +482,13 @@ TEST(TestPWProcessor, TestBudget)
     auto& flows = waf->flows;
     auto& rules = waf->rules;
 
-    rapidjson::Document document;
-    PWRetManager rManager(TIME_STORE_DEFAULT, document.GetAllocator());
-    PWProcessor processor(wrapper, rules);
+    PWRetManager rManager(TIME_STORE_DEFAULT);
+    PWProcessor processor(wrapper, rules, waf->targetIndex);
     processor.startNewRun(SQPowerWAF::monotonic_clock::now() + chrono::microseconds(50));
 
-    processor.runFlow("flow1", flows["flow1"], rManager);
+    auto flow = std::find_if(flows.begin(), flows.end(), [](const auto& f) { return f.first == "flow1"; });
+    ASSERT_NE(flow, flows.end());
+    processor.runFlow(flow->first, flow->second, rManager);
     ddwaf_result ret = rManager.synthetize();
     EXPECT_EQ(ret.data, nullptr);
 
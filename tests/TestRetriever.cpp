@@ -178,10 +178,12 @@ TEST(PWRetriever, NullErrorManagement)
     PWRetriever retriever(((PowerWAF*) handle)->manifest, 64, 1024);
     retriever.addParameter(map);
 
-    rapidjson::Document document;
-    PWRetManager rManager(TIME_STORE_DEFAULT, document.GetAllocator());
+    PWRetManager rManager(TIME_STORE_DEFAULT);
 
-    const condition& cond = ((PowerWAF*) handle)->rules.find("1")->second.conditions.front();
+    const auto& rules = ((PowerWAF*) handle)->rules;
+    auto rule_it      = std::find_if(rules.begin(), rules.end(), [](const ddwaf::rule& r) { return r.id == "1"; });
+    ASSERT_NE(rule_it, rules.end());
+    const condition& cond = rule_it->conditions.front();
 
     EXPECT_EQ(cond.performMatching(retriever, TIME_FAR, rManager), condition::status::missing_arg);
 
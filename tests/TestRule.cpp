@@ -36,7 +36,7 @@ TEST(TestRule, TestRuleDoMatchInvalidParameters)
 
     //Access the rule
     PowerWAF* waf         = reinterpret_cast<PowerWAF*>(handle);
-    const condition& cond = waf->rules.find("1")->second.conditions[0];
+    const condition& cond = waf->rules[0].conditions[0];
 
     //Send garbage input
     PWRetriever retriever(waf->manifest, 256, 256);
@@ -68,3 +68,113 @@ TEST(TestRule, TestRuleDoMatchInvalidParameters)
     ddwaf_context_destroy(context);
     ddwaf_destroy(handle);
 }
+
+TEST(TestRule, TestTransformationCache)
+{
+    auto rule_ = readRule(R"({version: '2.1', rules: [{id: 1, name: rule1, tags: {type: flow1, category: category1}, conditions: [{operator: match_regex, parameters: {inputs: [{address: arg}], regex: ^sqreen$}}], transformers: [lowercase]}, {id: 2, name: rule2, tags: {type: flow2, category: category2}, conditions: [{operator: match_regex, parameters: {inputs: [{address: arg}], regex: ^sq}}], transformers: [lowercase]}]})");
+    ASSERT_TRUE(rule_.type != DDWAF_OBJ_INVALID);
+
+    ddwaf_handle handle = ddwaf_init(&rule_, nullptr);
+    ASSERT_NE(handle, nullptr);
+    ddwaf_object_free(&rule_);
+
+    PowerWAF* waf = reinterpret_cast<PowerWAF*>(handle);
+    ASSERT_EQ(waf->rules.size(), 2);
+
+    ddwaf_object parameter;
+    ddwaf_object_string(&parameter, "SQREEN");
+
+    transformation_cache cache;
+    std::vector<uint8_t> submatch;
+    for (const ddwaf::rule& rule : waf->rules)
+    {
+        MatchGatherer gather(submatch);
+        EXPECT_TRUE(rule.conditions[0].matchWithTransformer(&parameter, gather, false, true, &cache));
+        EXPECT_STREQ(gather.resolvedValue.c_str(), "sqreen");
+    }
+
+    // The input was transformed once for both conditions and left untouched
+    EXPECT_EQ(cache.misses(), 1);
+    EXPECT_EQ(cache.hits(), 1);
+    EXPECT_STREQ(parameter.stringValue, "SQREEN");
+
+    cache.clear();
+    MatchGatherer gather(submatch);
+    EXPECT_TRUE(waf->rules[0].conditions[0].matchWithTransformer(&parameter, gather, false, true, &cache));
+    EXPECT_EQ(cache.misses(), 2);
+
+    ddwaf_object_free(&parameter);
+    ddwaf_destroy(handle);
+}
+
+TEST(TestRule, TestMatchInterTransformer)
+{
+    auto rule_ = readRule(R"({version: '2.1', rules: [{id: 1, name: rule1, tags: {type: flow1, category: category1}, conditions: [{operator: match_regex, parameters: {inputs: [{address: arg}], regex: ^%41$}}], transformers: [urlDecode, urlDecode]}, {id: 2, name: rule2, tags: {type: flow2, category: category2}, conditions: [{operator: match_regex, parameters: {inputs: [{address: arg}], regex: ^%41$}}], transformers: [urlDecode, urlDecode, lowercase]}]})");
+    ASSERT_TRUE(rule_.type != DDWAF_OBJ_INVALID);
+
+    ddwaf_handle handle = ddwaf_init(&rule_, nullptr);
+    ASSERT_NE(handle, nullptr);
+    ddwaf_object_free(&rule_);
+
+    PowerWAF* waf = reinterpret_cast<PowerWAF*>(handle);
+    ASSERT_EQ(waf->rules.size(), 2);
+
+    ddwaf_object parameter;
+    ddwaf_object_string(&parameter, "%2541");
+
+    // Only the intermediary representation matches
+    std::vector<uint8_t> submatch;
+    {
+        transformation_cache cache;
+        MatchGatherer gather(submatch);
+        EXPECT_FALSE(waf->rules[0].conditions[0].matchWithTransformer(&parameter, gather, false, true, &cache));
+    }
+
+    // Every prefix of the chains is a node
+    auto trie = std::make_shared<const transformer_trie>(std::vector<std::vector<PW_TRANSFORM_ID>> {
+        { PWT_DECODE_URL }, { PWT_DECODE_URL, PWT_DECODE_URL }, { PWT_DECODE_URL, PWT_DECODE_URL, PWT_LOWERCASE } });
+    for (ddwaf::rule& rule : waf->rules)
+    {
+        condition& cond                   = rule.conditions[0];
+        cond.options.matchInterTransformer = true;
+        cond.setTransformerChain(trie, trie->find(cond.getTransformers()));
+        EXPECT_EQ(cond.prefixChains.size(), cond.getTransformers().size());
+    }
+
+    // The intermediary representations are computed once and shared by the two
+    // chains, the second node of the first one finding its parent in the cache
+    transformation_cache cache;
+    for (const ddwaf::rule& rule : waf->rules)
+    {
+        MatchGatherer gather(submatch);
+        EXPECT_TRUE(rule.conditions[0].matchWithTransformer(&parameter, gather, false, true, &cache));
+        EXPECT_STREQ(gather.resolvedValue.c_str(), "%41");
+    }
+    EXPECT_EQ(cache.misses(), 2);
+    EXPECT_EQ(cache.hits(), 3);
+    EXPECT_STREQ(parameter.stringValue, "%2541");
+
+    // Without the cache of a context
+    {
+        MatchGatherer gather(submatch);
+        EXPECT_TRUE(waf->rules[1].conditions[0].matchWithTransformer(&parameter, gather, false, true));
+        EXPECT_STREQ(gather.resolvedValue.c_str(), "%41");
+    }
+
+    // Unchanged representations aren't matched again, the final one is matched once
+    {
+        ddwaf_object other;
+        ddwaf_object_string(&other, "%41");
+
+        MatchGatherer gather(submatch);
+        EXPECT_TRUE(waf->rules[0].conditions[0].matchWithTransformer(&other, gather, false, true, &cache));
+        EXPECT_STREQ(gather.resolvedValue.c_str(), "%41");
+
+        ddwaf_object_string(&other, "nothing to decode");
+        EXPECT_FALSE(waf->rules[1].conditions[0].matchWithTransformer(&other, gather, false, true, &cache));
+        ddwaf_object_free(&other);
+    }
+
+    ddwaf_object_free(&parameter);
+    ddwaf_destroy(handle);
+}
@@ -0,0 +1,169 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include "test.h"
+#include <random>
+#include <simd.hpp>
+
+using namespace ddwaf;
+
+namespace
+{
+// Strings of every length up to 100 from a small alphabet, so that ranges,
+// pairs and letters show up at every position of a vector
+std::vector<std::string> generateInputs()
+{
+    const char alphabet[] = { ' ', ' ', 'a', 'Z', 'A', 'z', '.', '\0', '@', '[', '\x80', '\xff' };
+
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<size_t> pick(0, sizeof(alphabet) - 1);
+
+    std::vector<std::string> inputs;
+    for (size_t length = 0; length <= 100; ++length)
+    {
+        for (unsigned sample = 0; sample < 20; ++sample)
+        {
+            std::string input(length, 'x');
+            for (char& c : input)
+            {
+                // Mostly clean strings, to exercise the vectorized loops
+                c = pick(generator) < 3 ? alphabet[pick(generator)] : 'x';
+            }
+            inputs.push_back(input);
+        }
+    }
+    return inputs;
+}
+}
+
+TEST(TestSIMD, TestKernels)
+{
+    const auto inputs          = generateInputs();
+    const simd::kernels& model = simd::get(simd::isa::scalar);
+    constexpr auto letters     = simd::byte_set().with("@.").with_range('A', 'Z');
+    constexpr auto highSet     = simd::byte_set().with((uint8_t) 0).with((uint8_t) 0xff);
+    const std::string needles[] = { "", "a", "  ", "xax", std::string("x\0x", 3), "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxy" };
+
+    for (simd::isa set : { simd::isa::sse2, simd::isa::avx2, simd::isa::neon })
+    {
+        if (!simd::supports(set))
+            continue;
+
+        const simd::kernels& kernels = simd::get(set);
+        for (const std::string& input : inputs)
+        {
+            const char* data = input.data();
+            EXPECT_EQ(kernels.find_range(data, input.size(), 'A', 'Z'), model.find_range(data, input.size(), 'A', 'Z'));
+            EXPECT_EQ(kernels.find_range(data, input.size(), 0, 0), model.find_range(data, input.size(), 0, 0));
+            EXPECT_EQ(kernels.find_range(data, input.size(), 0x80, 0xff), model.find_range(data, input.size(), 0x80, 0xff));
+            EXPECT_EQ(kernels.find_either(data, input.size(), '.', '@'), model.find_either(data, input.size(), '.', '@'));
+            EXPECT_EQ(kernels.find_either(data, input.size(), 0, 0xff), model.find_either(data, input.size(), 0, 0xff));
+            EXPECT_EQ(kernels.find_set(data, input.size(), letters), model.find_set(data, input.size(), letters));
+            EXPECT_EQ(kernels.find_set(data, input.size(), highSet), model.find_set(data, input.size(), highSet));
+            EXPECT_EQ(kernels.find_pair(data, input.size(), ' '), model.find_pair(data, input.size(), ' '));
+            for (const std::string& needle : needles)
+                EXPECT_EQ(kernels.find_substring(data, input.size(), needle.data(), needle.size()), model.find_substring(data, input.size(), needle.data(), needle.size()));
+
+            // A needle taken from the end of the input, found at its first occurrence
+            const std::string tail = input.substr(input.size() - std::min<size_t>(input.size(), 5));
+            EXPECT_EQ(kernels.find_substring(data, input.size(), tail.data(), tail.size()), model.find_substring(data, input.size(), tail.data(), tail.size()));
+
+            std::string expected = input, lowercase = input;
+            model.lowercase(expected.data(), expected.size());
+            kernels.lowercase(lowercase.data(), lowercase.size());
+            EXPECT_EQ(lowercase, expected);
+        }
+    }
+}
+
+TEST(TestSIMD, TestBase64)
+{
+    const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    const simd::kernels& model = simd::get(simd::isa::scalar);
+
+    // Valid strings with, at times, a single byte of any value somewhere
+    std::mt19937 generator(42);
+    std::vector<std::string> inputs;
+    for (size_t length = 0; length <= 200; ++length)
+    {
+        for (unsigned sample = 0; sample < 10; ++sample)
+        {
+            std::string input(length, 'A');
+            for (char& c : input)
+                c = alphabet[generator() % 64];
+
+            if (length != 0 && sample % 2 == 1)
+                input[generator() % length] = (char) generator();
+            inputs.push_back(input);
+        }
+    }
+
+    for (simd::isa set : { simd::isa::scalar, simd::isa::sse2, simd::isa::avx2, simd::isa::neon })
+    {
+        if (!simd::supports(set))
+            continue;
+
+        const simd::kernels& kernels = simd::get(set);
+        for (const std::string& input : inputs)
+        {
+            std::string expected(input.size(), 0), decoded(input.size(), 0);
+            size_t expectedConsumed, consumed;
+            const size_t expectedLength = model.base64_decode(input.data(), input.size(), expected.data(), expectedConsumed);
+            const size_t length         = kernels.base64_decode(input.data(), input.size(), decoded.data(), consumed);
+            EXPECT_EQ(consumed, expectedConsumed);
+            EXPECT_EQ(length, consumed / 4 * 3);
+            EXPECT_EQ(decoded.substr(0, length), expected.substr(0, expectedLength));
+
+            // The transformer decodes in place
+            std::string inPlace = input;
+            EXPECT_EQ(kernels.base64_decode(inPlace.data(), inPlace.size(), inPlace.data(), consumed), expectedLength);
+            EXPECT_EQ(inPlace.substr(0, expectedLength), expected.substr(0, expectedLength));
+
+            // Any input is fine to encode, and then decodes to itself
+            std::string encoded(input.size() / 3 * 4, 0), expectedEncoded(input.size() / 3 * 4, 0);
+            EXPECT_EQ(kernels.base64_encode(input.data(), input.size(), encoded.data()), input.size() / 3 * 3);
+            model.base64_encode(input.data(), input.size(), expectedEncoded.data());
+            EXPECT_EQ(encoded, expectedEncoded);
+        }
+    }
+
+    // 63 is encoded as '-' while only '/' is decoded
+    char encoded[4];
+    EXPECT_EQ(simd::base64_encode("\xff\xff\xff", 3, encoded), 3);
+    EXPECT_EQ(std::string(encoded, 4), "----");
+
+    char decoded[3];
+    size_t consumed;
+    EXPECT_EQ(simd::base64_decode("////", 4, decoded, consumed), 3);
+    EXPECT_EQ(std::string(decoded, 3), "\xff\xff\xff");
+    EXPECT_EQ(simd::base64_decode("----", 4, decoded, consumed), 0);
+    EXPECT_EQ(consumed, 0);
+}
+
+TEST(TestSIMD, TestBest)
+{
+    EXPECT_TRUE(simd::supports(simd::isa::scalar));
+    EXPECT_TRUE(simd::supports(simd::best()));
+
+    EXPECT_EQ(simd::find_byte("abc.d", 5, '.'), 3);
+    EXPECT_EQ(simd::find_byte("abcd", 4, '.'), 4);
+    EXPECT_EQ(simd::find_either("ab+c%d", 6, '%', '+'), 2);
+    EXPECT_EQ(simd::find_either("abcd", 4, '%', '+'), 4);
+    EXPECT_EQ(simd::find_set("abc&def", 7, simd::byte_set().with("&%")), 3);
+
+    constexpr auto set = simd::byte_set().with_range(0x7f, 0x81).with("a");
+    for (unsigned c = 0; c < 256; ++c)
+        EXPECT_EQ(set.contains((uint8_t) c), c == 'a' || (c >= 0x7f && c <= 0x81));
+
+    EXPECT_EQ(simd::find_pair("a b  c", 6, ' '), 4);
+    EXPECT_EQ(simd::find_pair(" ", 1, ' '), 1);
+    EXPECT_EQ(simd::find_pair("", 0, ' '), 0);
+
+    EXPECT_EQ(simd::find_substring("admin' or 1=1 --", 16, "or 1", 4), 7);
+    EXPECT_EQ(simd::find_substring("admin' or 1=1 --", 16, "or 2", 4), 16);
+    EXPECT_EQ(simd::find_substring("abc", 3, "abcd", 4), 3);
+    EXPECT_EQ(simd::find_substring("abc", 3, "", 0), 0);
+}
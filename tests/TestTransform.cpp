@@ -5,6 +5,7 @@
 // Copyright 2021 Datadog, Inc.
 
 #include "test.h"
+#include <random>
 
 uint8_t codepointToUTF8(uint32_t codepoint, char* utf8_buffer);
 
@@ -149,6 +150,42 @@ TEST(TestTransforms, TestNeedTransform)
     ddwaf_object_free(&string);
 }
 
+TEST(TestTransforms, TestTriggerBytes)
+{
+    ddwaf::simd::byte_set triggers;
+    EXPECT_TRUE(PWTransformer::triggerBytes(PWT_DECODE_URL, triggers));
+    EXPECT_TRUE(triggers.contains('%') && triggers.contains('+') && !triggers.contains('a'));
+    EXPECT_FALSE(PWTransformer::triggerBytes(PWT_LENGTH, triggers));
+    EXPECT_FALSE(PWTransformer::triggerBytes(PWT_DECODE_BASE64, triggers));
+
+    // Strings made of any other byte never need to be transformed
+    std::mt19937 generator(7);
+    std::uniform_int_distribution<unsigned> pickByte(0, 255);
+    for (uint32_t id = PWT_LOWERCASE; id < PWT_INVALID; id <<= 1)
+    {
+        const auto transformID = (PW_TRANSFORM_ID) id;
+        if (!PWTransformer::triggerBytes(transformID, triggers))
+            continue;
+
+        for (unsigned sample = 0; sample < 200; ++sample)
+        {
+            std::string input(sample % 40, 'x');
+            for (char& c : input)
+            {
+                do
+                {
+                    c = (char) pickByte(generator);
+                } while (triggers.contains((uint8_t) c));
+            }
+
+            ddwaf_object string;
+            ddwaf_object_stringl_nc(&string, input.data(), input.size());
+            EXPECT_FALSE(PWTransformer::transform(transformID, &string, true)) << "transformer: " << id;
+            EXPECT_FALSE(PWTransformer::doesNeedTransform({ transformID }, &string));
+        }
+    }
+}
+
 TEST(TestTransforms, TestCompressWhiteSpace)
 {
     EXPECT_EQ(PWTransformer::getIDForString("compressWhiteSpace"), PWT_COMPRESS_WHITE);
@@ -256,6 +293,11 @@ TEST(TestTransforms, TestURLDecode)
 
     doesTransform({ PWT_DECODE_URL }, "%%750041", "%u0041");
     doesTransform({ PWT_DECODE_URL_IIS }, "%%550041", "A");
+    // Long literal runs around the escapes
+    doesTransform({ PWT_DECODE_URL }, "a-long-value-without-any-escape-sequence-in-it-at-all", NULL);
+    doesTransform({ PWT_DECODE_URL }, "a-long-value-with-a-stray-%-and-%zz-but-nothing-to-decode", NULL);
+    doesTransform({ PWT_DECODE_URL }, "a-long-value-with-a-stray-%-and-then+an+escape+at+the+end%21", "a-long-value-with-a-stray-%-and-then an escape at the end!");
+    doesTransform({ PWT_DECODE_URL_IIS }, "a-long-value-with-a-stray-%u12-and-then-%u0041-and-more-literal-bytes", "a-long-value-with-a-stray-%u12-and-then-A-and-more-literal-bytes");
 }
 
 TEST(TestTransforms, TestCSSDecode)
@@ -324,6 +366,19 @@ TEST(TestTransforms, TestHTMLDecode)
     doesTransform({ PWT_DECODE_HTML }, "HTML &#9999999 99999 &#x41; transformation", "HTML \xef\xbf\xbd 99999 A transformation");
     doesTransform({ PWT_DECODE_HTML }, "HTML &#9999999ffff 99999 &#x41; transformation", "HTML \xef\xbf\xbd"
                                                                                          "ffff 99999 A transformation");
+
+    // Named references are case insensitive but must be complete
+    doesTransform({ PWT_DECODE_HTML }, "&LT;&Gt;&aMp;&QUOT;&NbSp;", "<>&\"\xa0");
+    doesTransform({ PWT_DECODE_HTML }, "&l; &lt &ltt; &quo; &quott; &nbs; &;", NULL);
+    doesTransform({ PWT_DECODE_HTML }, "&amp;lt;", "&lt;", false);
+    // A failed codepoint right before another reference
+    doesTransform({ PWT_DECODE_HTML }, "&#&#x41", "&#A");
+    doesTransform({ PWT_DECODE_HTML }, "&#x&lt;", "&#x<");
+
+    // Long literal runs around the references
+    doesTransform({ PWT_DECODE_HTML }, "a-long-value-with-stray-&-and-&#-and-&#x-but-nothing-to-decode", NULL);
+    doesTransform({ PWT_DECODE_HTML }, "a-long-value-with-&#x3c;script&#62;-and-then&lt;/script&gt;-at-the-end", "a-long-value-with-<script>-and-then</script>-at-the-end");
+    doesTransform({ PWT_DECODE_HTML }, "&#106;&#97;&#118;&#97;&#115;&#99;&#114;&#105;&#112;&#116;&#58;alert(1)", "javascript:alert(1)");
 }
 
 TEST(TestTransforms, TestB64DecodeValidation)
@@ -356,6 +411,44 @@ TEST(TestTransforms, TestB64Decode)
 
     doesTransform({ PWT_DECODE_BASE64 }, "Zm9vYmF", "fooba@", false);
     doesTransform({ PWT_DECODE_BASE64_EXT }, "Zm==============9v", "foo", false);
+
+    // Long enough to be decoded by blocks, with characters to skip in the middle
+    doesTransform({ PWT_DECODE_BASE64 }, "eyJhbGciOiJIUzI1NiIsInR5cCI6IkpXVCJ9eyJzdWIiOiIxMjM0NTY3ODkwIn0=", "{\"alg\":\"HS256\",\"typ\":\"JWT\"}{\"sub\":\"1234567890\"}", false);
+    doesTransform({ PWT_DECODE_BASE64_EXT }, "eyJhbGciOiJIUzI1NiIsInR5cCI6IkpXV\r\nCJ9eyJzdWIiOiIxMjM0NTY3ODkwIn0=", "{\"alg\":\"HS256\",\"typ\":\"JWT\"}{\"sub\":\"1234567890\"}", false);
+    EXPECT_FALSE(shouldTransform({ PWT_DECODE_BASE64 }, "eyJhbGciOiJIUzI1NiIsInR5cCI6IkpXV\r\nCJ9eyJzdWIiOiIxMjM0NTY3ODkwIn0="));
+}
+
+TEST(TestTransforms, TestB64RoundTrip)
+{
+    std::mt19937 generator(42);
+    for (size_t length = 1; length <= 200; ++length)
+    {
+        std::string input(length, 0);
+        for (char& c : input)
+            c = (char) generator();
+
+        ddwaf_object string;
+        ddwaf_object_stringl(&string, input.data(), input.size());
+        EXPECT_TRUE(PWTransformer::transform(PWT_ENCODE_BASE64, &string));
+        EXPECT_EQ(string.nbEntries, (length + 2) / 3 * 4);
+
+        // The output is valid for the strict mode, unless 63 was encoded as a '-'
+        const std::string encoded(string.stringValue, string.nbEntries);
+        const bool strict = encoded.find('-') == std::string::npos;
+        EXPECT_EQ(PWTransformer::doesNeedTransform({ PWT_DECODE_BASE64 }, &string), strict);
+
+        if (strict)
+        {
+            EXPECT_TRUE(PWTransformer::transform(PWT_DECODE_BASE64, &string));
+
+            // The decoder drops the second byte of a 3 characters quartet if it's null
+            std::string expected = input;
+            if (length % 3 == 2 && expected.back() == 0)
+                expected.pop_back();
+            EXPECT_EQ(std::string(string.stringValue, string.nbEntries), expected);
+        }
+        ddwaf_object_free(&string);
+    }
 }
 
 TEST(TestTransforms, TestB64Encode)
@@ -0,0 +1,119 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include "test.h"
+#include <random>
+#include <transformer_pipeline.hpp>
+
+using namespace ddwaf;
+
+namespace
+{
+// Transformers applied one after the other, as they used to be
+ddwaf_object referenceTransform(const vector<PW_TRANSFORM_ID>& transformers, const std::string& input)
+{
+    ddwaf_object output, view;
+    ddwaf_object_invalid(&output);
+    ddwaf_object_stringl_nc(&view, input.data(), input.size());
+    if (!PWTransformer::doesNeedTransform(transformers, &view))
+        return output;
+
+    ddwaf_object_stringl(&output, input.data(), input.size());
+    for (PW_TRANSFORM_ID transformer : transformers)
+    {
+        if (!PWTransformer::transform(transformer, &output))
+        {
+            ddwaf_object_free(&output);
+            ddwaf_object_invalid(&output);
+            break;
+        }
+
+        if (output.type == DDWAF_OBJ_STRING && output.nbEntries == 0)
+            break;
+    }
+    return output;
+}
+
+// An invalid object stands for the input used as is
+std::string describe(const ddwaf_object& object, const std::string& input)
+{
+    switch (object.type)
+    {
+        case DDWAF_OBJ_INVALID:
+            return "string:" + input;
+        case DDWAF_OBJ_STRING:
+            return "string:" + std::string(object.stringValue, object.nbEntries);
+        case DDWAF_OBJ_UNSIGNED:
+            return "unsigned:" + std::to_string(object.uintValue);
+        default:
+            return "other";
+    }
+}
+}
+
+TEST(TestTransformerPipeline, TestFusion)
+{
+    EXPECT_EQ(transformer_pipeline({ PWT_LOWERCASE, PWT_DECODE_URL, PWT_NONULL, PWT_COMPRESS_WHITE }).passes(), 1);
+    EXPECT_EQ(transformer_pipeline({ PWT_LOWERCASE, PWT_DECODE_URL_IIS, PWT_NONULL, PWT_COMPRESS_WHITE }).passes(), 3);
+    EXPECT_EQ(transformer_pipeline({ PWT_NORMALIZE }).passes(), 1);
+    EXPECT_EQ(transformer_pipeline(vector<PW_TRANSFORM_ID>(10, PWT_LOWERCASE)).passes(), 2);
+
+    EXPECT_TRUE(transformer_pipeline({ PWT_LOWERCASE, PWT_DECODE_URL }).inPlace());
+    EXPECT_FALSE(transformer_pipeline({ PWT_LOWERCASE, PWT_LENGTH }).inPlace());
+}
+
+TEST(TestTransformerPipeline, TestTransform)
+{
+    transformer_pipeline pipeline({ PWT_LOWERCASE, PWT_DECODE_URL, PWT_NONULL, PWT_COMPRESS_WHITE });
+
+    ddwaf_object output = pipeline.transform("already clean", 13);
+    EXPECT_EQ(output.type, DDWAF_OBJ_INVALID);
+
+    const char input[] = "SELECT%20%2A++FROM%00%00%20%20users%";
+    output             = pipeline.transform(input, sizeof(input) - 1);
+    EXPECT_EQ(output.type, DDWAF_OBJ_STRING);
+    EXPECT_STREQ(output.stringValue, "select * from users%");
+    ddwaf_object_free(&output);
+
+    // The copy comes from the arena
+    arena allocator;
+    output = pipeline.transform(input, sizeof(input) - 1, &allocator);
+    EXPECT_STREQ(output.stringValue, "select * from users%");
+    EXPECT_EQ(allocator.stats().allocations, 1);
+}
+
+TEST(TestTransformerPipeline, TestEquivalence)
+{
+    const vector<PW_TRANSFORM_ID> candidates = { PWT_LOWERCASE, PWT_NONULL, PWT_COMPRESS_WHITE, PWT_DECODE_URL,
+                                                 PWT_DECODE_URL_IIS, PWT_NORMALIZE, PWT_DECODE_HTML, PWT_LENGTH };
+    const char alphabet[]                    = { 'a', 'A', 'F', ' ', ' ', '\0', '%', '%', '+', '4', '1', '2', '0', 'u', '/', '.', '&', ';' };
+
+    std::mt19937 generator(1337);
+    std::uniform_int_distribution<size_t> pickTransformer(0, candidates.size() - 1);
+    std::uniform_int_distribution<size_t> pickChar(0, sizeof(alphabet) - 1);
+    std::uniform_int_distribution<size_t> pickLength(0, 80);
+    std::uniform_int_distribution<size_t> pickChainLength(1, 5);
+
+    for (unsigned sample = 0; sample < 3000; ++sample)
+    {
+        vector<PW_TRANSFORM_ID> transformers(pickChainLength(generator));
+        for (PW_TRANSFORM_ID& transformer : transformers)
+            transformer = candidates[pickTransformer(generator)];
+
+        // Mostly clean inputs, so that the fused pass skips over long spans
+        std::string input(pickLength(generator), 'x');
+        for (char& c : input)
+            c = pickChar(generator) < 6 ? alphabet[pickChar(generator)] : 'x';
+
+        ddwaf_object expected = referenceTransform(transformers, input);
+        ddwaf_object output   = transformer_pipeline(transformers).transform(input.data(), input.size());
+
+        EXPECT_EQ(describe(output, input), describe(expected, input)) << "input: " << input;
+
+        ddwaf_object_free(&expected);
+        ddwaf_object_free(&output);
+    }
+}
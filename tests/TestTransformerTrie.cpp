@@ -0,0 +1,141 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include "test.h"
+#include <random>
+#include <transformer_trie.hpp>
+
+using namespace ddwaf;
+
+namespace
+{
+// An invalid object stands for the input used as is
+std::string describe(const ddwaf_object* object, const std::string& input)
+{
+    if (object == nullptr || object->type == DDWAF_OBJ_INVALID)
+        return "string:" + input;
+    if (object->type == DDWAF_OBJ_STRING)
+        return "string:" + std::string(object->stringValue, object->nbEntries);
+    if (object->type == DDWAF_OBJ_UNSIGNED)
+        return "unsigned:" + std::to_string(object->uintValue);
+    return "other";
+}
+}
+
+TEST(TestTransformerTrie, TestStructure)
+{
+    const vector<PW_TRANSFORM_ID> lower = { PWT_LOWERCASE }, lowerURL = { PWT_LOWERCASE, PWT_DECODE_URL },
+                                  lowerURLHTML  = { PWT_LOWERCASE, PWT_DECODE_URL, PWT_DECODE_HTML },
+                                  lowerURLNulls = { PWT_LOWERCASE, PWT_DECODE_URL, PWT_NONULL },
+                                  pathLower = { PWT_NORMALIZE, PWT_LOWERCASE }, pathURL = { PWT_NORMALIZE, PWT_DECODE_URL };
+
+    transformer_trie trie({ lowerURLHTML, lower, lowerURLNulls, pathLower, pathURL, lowerURL, lower });
+
+    // [normalizePath] is shared by two chains, so gets its own node
+    EXPECT_EQ(trie.size(), 7);
+    EXPECT_EQ(trie.find({ PWT_DECODE_URL }), transformation_cache::no_chain);
+    EXPECT_EQ(trie.find({ PWT_LOWERCASE, PWT_NONULL }), transformation_cache::no_chain);
+
+    EXPECT_EQ(trie.parent(trie.find(lower)), transformation_cache::no_chain);
+    EXPECT_EQ(trie.parent(trie.find(lowerURL)), trie.find(lower));
+    EXPECT_EQ(trie.parent(trie.find(lowerURLHTML)), trie.find(lowerURL));
+    EXPECT_EQ(trie.parent(trie.find(lowerURLNulls)), trie.find(lowerURL));
+
+    const auto path = trie.find({ PWT_NORMALIZE });
+    ASSERT_NE(path, transformation_cache::no_chain);
+    EXPECT_EQ(trie.parent(path), transformation_cache::no_chain);
+    EXPECT_EQ(trie.parent(trie.find(pathLower)), path);
+    EXPECT_EQ(trie.parent(trie.find(pathURL)), path);
+
+    EXPECT_EQ(trie.chain(trie.find(lowerURLHTML)), lowerURLHTML);
+}
+
+TEST(TestTransformerTrie, TestSharedPrefix)
+{
+    const vector<PW_TRANSFORM_ID> lower = { PWT_LOWERCASE }, lowerURLHTML = { PWT_LOWERCASE, PWT_DECODE_URL, PWT_DECODE_HTML },
+                                  lowerURLNulls = { PWT_LOWERCASE, PWT_DECODE_URL, PWT_NONULL };
+    transformer_trie trie({ lower, lowerURLHTML, lowerURLNulls });
+
+    ddwaf_object input;
+    ddwaf_object_string(&input, "SELECT%26lt;%00");
+
+    arena allocator;
+    transformation_cache cache;
+    bool failed;
+
+    const ddwaf_object* output = trie.evaluate(trie.find(lowerURLHTML), &input, false, cache, &allocator, failed);
+    ASSERT_NE(output, nullptr);
+    EXPECT_FALSE(failed);
+    EXPECT_EQ(std::string(output->stringValue, output->nbEntries), std::string("select<\0", 8));
+    // [lowercase], [lowercase, urlDecode] (shared) and the whole chain
+    EXPECT_EQ(cache.misses(), 3);
+
+    output = trie.evaluate(trie.find(lowerURLNulls), &input, false, cache, &allocator, failed);
+    ASSERT_NE(output, nullptr);
+    EXPECT_STREQ(output->stringValue, "select&lt;");
+    // Only removeNulls was applied, on top of the shared prefix
+    EXPECT_EQ(cache.misses(), 4);
+    EXPECT_EQ(cache.hits(), 1);
+
+    output = trie.evaluate(trie.find(lower), &input, false, cache, &allocator, failed);
+    ASSERT_NE(output, nullptr);
+    EXPECT_STREQ(output->stringValue, "select%26lt;%00");
+    EXPECT_EQ(cache.misses(), 4);
+
+    ddwaf_object_free(&input);
+}
+
+TEST(TestTransformerTrie, TestEquivalence)
+{
+    const vector<PW_TRANSFORM_ID> candidates = { PWT_LOWERCASE, PWT_NONULL, PWT_DECODE_URL, PWT_DECODE_URL_IIS,
+                                                 PWT_DECODE_HTML, PWT_DECODE_BASE64, PWT_LENGTH };
+    const char alphabet[]                    = { 'a', 'A', 'F', ' ', '\0', '%', '+', '4', '1', '2', 'u', '&', ';', '=' };
+
+    std::mt19937 generator(4242);
+    std::uniform_int_distribution<size_t> pickTransformer(0, candidates.size() - 1);
+    std::uniform_int_distribution<size_t> pickChar(0, sizeof(alphabet) - 1);
+    std::uniform_int_distribution<size_t> pickLength(0, 24);
+    std::uniform_int_distribution<size_t> pickChainLength(1, 4);
+
+    for (unsigned ruleset = 0; ruleset < 50; ++ruleset)
+    {
+        // Chains sharing prefixes, from a small set of transformers
+        vector<vector<PW_TRANSFORM_ID>> chains(8);
+        for (auto& chain : chains)
+        {
+            chain.resize(pickChainLength(generator));
+            for (PW_TRANSFORM_ID& transformer : chain)
+                transformer = candidates[pickTransformer(generator) % (chain.size() + 1)];
+        }
+
+        transformer_trie trie(chains);
+        for (unsigned sample = 0; sample < 40; ++sample)
+        {
+            std::string value(pickLength(generator), 'x');
+            for (char& c : value)
+                c = alphabet[pickChar(generator)];
+
+            ddwaf_object input;
+            ddwaf_object_stringl(&input, value.data(), value.size());
+
+            arena allocator;
+            transformation_cache cache;
+            for (const auto& chain : chains)
+            {
+                bool failed, expectedFailed;
+                const ddwaf_object* output = trie.evaluate(trie.find(chain), &input, false, cache, &allocator, failed);
+                ddwaf_object expected      = transformer_pipeline(chain).transform(value.data(), value.size(), nullptr, expectedFailed);
+
+                EXPECT_EQ(describe(output, value), describe(&expected, value)) << "input: " << value;
+                EXPECT_EQ(failed, expectedFailed);
+
+                ddwaf_object_free(&expected);
+            }
+
+            ddwaf_object_free(&input);
+        }
+    }
+}
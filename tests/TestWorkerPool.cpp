@@ -0,0 +1,57 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include "test.h"
+#include <atomic>
+#include <stdexcept>
+#include <worker_pool.hpp>
+
+TEST(TestWorkerPool, TestRun)
+{
+    ddwaf::worker_pool pool(3);
+    EXPECT_EQ(pool.size(), 3);
+
+    std::vector<std::atomic<int>> calls(32);
+    for (unsigned run = 0; run < 8; ++run)
+    {
+        pool.run(calls.size(), [&calls](size_t index) { calls[index]++; });
+    }
+
+    for (const auto& count : calls)
+    {
+        EXPECT_EQ(count.load(), 8);
+    }
+
+    // Nothing to do
+    pool.run(0, [](size_t) { FAIL(); });
+}
+
+TEST(TestWorkerPool, TestNoThread)
+{
+    ddwaf::worker_pool pool(0);
+
+    std::vector<size_t> order;
+    pool.run(4, [&order](size_t index) { order.push_back(index); });
+    EXPECT_EQ(order, std::vector<size_t>({ 0, 1, 2, 3 }));
+}
+
+TEST(TestWorkerPool, TestException)
+{
+    ddwaf::worker_pool pool(2);
+
+    std::atomic<int> calls { 0 };
+    EXPECT_THROW(pool.run(6, [&calls](size_t index) {
+        calls++;
+        if (index == 3)
+            throw std::runtime_error("failure");
+    }),
+                 std::runtime_error);
+
+    // Every task ran, and the pool is still usable
+    EXPECT_EQ(calls.load(), 6);
+    pool.run(2, [&calls](size_t) { calls++; });
+    EXPECT_EQ(calls.load(), 8);
+}
@@ -0,0 +1,147 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include "../test.h"
+
+TEST(TestCompare, TestString)
+{
+    Equal equal("abc");
+    GreaterThan greater("abc");
+    LessOrEqual lessOrEqual("abc");
+    EXPECT_STREQ(equal.getStringRepresentation().c_str(), "abc");
+    EXPECT_STREQ(equal.operatorName().data(), "equals");
+    EXPECT_STREQ(greater.operatorName().data(), "greater_than");
+    EXPECT_STREQ(lessOrEqual.operatorName().data(), "less_than_or_equal");
+    EXPECT_EQ(equal.expectedTypes(), DDWAF_OBJ_STRING);
+
+    std::vector<uint8_t> matchestogather;
+    MatchGatherer gatherer(matchestogather);
+
+    ddwaf_object param;
+    ddwaf_object_string(&param, "abc");
+    EXPECT_TRUE(equal.doesMatch(&param, gatherer));
+    EXPECT_STREQ(gatherer.resolvedValue.c_str(), "abc");
+    EXPECT_STREQ(gatherer.matchedValue.c_str(), "abc");
+    EXPECT_FALSE(greater.doesMatch(&param, gatherer));
+    EXPECT_TRUE(lessOrEqual.doesMatch(&param, gatherer));
+    ddwaf_object_free(&param);
+
+    // A prefix is lower than the whole string
+    ddwaf_object_string(&param, "ab");
+    EXPECT_FALSE(equal.doesMatch(&param, gatherer));
+    EXPECT_FALSE(greater.doesMatch(&param, gatherer));
+    EXPECT_TRUE(lessOrEqual.doesMatch(&param, gatherer));
+    ddwaf_object_free(&param);
+
+    ddwaf_object_string(&param, "abcd");
+    EXPECT_TRUE(greater.doesMatch(&param, gatherer));
+    EXPECT_FALSE(lessOrEqual.doesMatch(&param, gatherer));
+    ddwaf_object_free(&param);
+
+    // Bytes after a 0 are compared too
+    ddwaf_object_stringl(&param, "abc\0", 4);
+    EXPECT_FALSE(equal.doesMatch(&param, gatherer));
+    EXPECT_TRUE(greater.doesMatch(&param, gatherer));
+    ddwaf_object_free(&param);
+
+    // Numbers aren't compared with strings
+    ddwaf_object_unsigned_force(&param, 42);
+    EXPECT_FALSE(equal.doesMatch(&param, gatherer));
+    EXPECT_FALSE(lessOrEqual.doesMatch(&param, gatherer));
+}
+
+TEST(TestCompare, TestNumbers)
+{
+    GreaterThan greater(int64_t { -5 });
+    LessThan less(uint64_t { 10 });
+    Equal equal(uint64_t { UINT64_MAX });
+    EXPECT_STREQ(greater.getStringRepresentation().c_str(), "-5");
+    EXPECT_STREQ(equal.getStringRepresentation().c_str(), "18446744073709551615");
+    EXPECT_EQ(greater.expectedTypes(), DDWAF_OBJ_SIGNED | DDWAF_OBJ_UNSIGNED);
+
+    std::vector<uint8_t> matchestogather;
+    MatchGatherer gatherer(matchestogather);
+
+    ddwaf_object param;
+    ddwaf_object_signed_force(&param, -4);
+    EXPECT_TRUE(greater.doesMatch(&param, gatherer));
+    EXPECT_STREQ(gatherer.resolvedValue.c_str(), "-4");
+    EXPECT_STREQ(gatherer.matchedValue.c_str(), "-4");
+    EXPECT_TRUE(less.doesMatch(&param, gatherer));
+    EXPECT_FALSE(equal.doesMatch(&param, gatherer));
+
+    ddwaf_object_signed_force(&param, -5);
+    EXPECT_FALSE(greater.doesMatch(&param, gatherer));
+
+    ddwaf_object_signed_force(&param, INT64_MIN);
+    EXPECT_FALSE(greater.doesMatch(&param, gatherer));
+    EXPECT_TRUE(less.doesMatch(&param, gatherer));
+    EXPECT_STREQ(gatherer.resolvedValue.c_str(), "-9223372036854775808");
+
+    // Unsigned inputs are greater than any negative value
+    ddwaf_object_unsigned_force(&param, UINT64_MAX);
+    EXPECT_TRUE(greater.doesMatch(&param, gatherer));
+    EXPECT_FALSE(less.doesMatch(&param, gatherer));
+    EXPECT_TRUE(equal.doesMatch(&param, gatherer));
+    EXPECT_STREQ(gatherer.resolvedValue.c_str(), "18446744073709551615");
+
+    ddwaf_object_unsigned_force(&param, 10);
+    EXPECT_FALSE(less.doesMatch(&param, gatherer));
+    ddwaf_object_signed_force(&param, 9);
+    EXPECT_TRUE(less.doesMatch(&param, gatherer));
+
+    // Strings aren't compared with numbers
+    ddwaf_object_string(&param, "1");
+    EXPECT_FALSE(less.doesMatch(&param, gatherer));
+    EXPECT_FALSE(less.doesMatchKey(&param, gatherer));
+    ddwaf_object_free(&param);
+}
+
+TEST(TestCompare, TestRuleset)
+{
+    auto rule = readRule(R"({version: '2.1', rules: [{id: 1, name: rule1, tags: {type: flow1, category: category1}, conditions: [{operator: greater_than, parameters: {inputs: [{address: body.size}], value: 0}}]}]})");
+    ASSERT_TRUE(rule.type != DDWAF_OBJ_INVALID);
+
+    // YAML scalars are strings, the value is made a number by hand
+    const ddwaf_object* parameters = &rule.array[1].array[0].array[3].array[0].array[1];
+    ASSERT_STREQ(parameters->parameterName, "parameters");
+    auto value = const_cast<ddwaf_object*>(&parameters->array[1]);
+    ASSERT_STREQ(value->parameterName, "value");
+    ddwaf_object_free(value);
+    ddwaf_object_unsigned_force(value, 1000);
+    value->parameterName       = strdup("value");
+    value->parameterNameLength = 5;
+
+    ddwaf_handle handle = ddwaf_init(&rule, nullptr);
+    ASSERT_NE(handle, nullptr);
+    ddwaf_object_free(&rule);
+
+    ddwaf_context context = ddwaf_context_init(handle, ddwaf_object_free);
+    ASSERT_NE(context, nullptr);
+
+    ddwaf_object param, tmp;
+    ddwaf_object_map(&param);
+    ddwaf_object_map_add(&param, "body.size", ddwaf_object_signed_force(&tmp, 1001));
+
+    ddwaf_result ret;
+
+    auto code = ddwaf_run(context, &param, &ret, LONG_TIME);
+    EXPECT_EQ(code, DDWAF_MONITOR);
+    EXPECT_STREQ(ret.data, R"([{"rule":{"id":"1","name":"rule1","tags":{"type":"flow1","category":"category1"}},"rule_matches":[{"operator":"greater_than","operator_value":"1000","parameters":[{"address":"body.size","key_path":[],"value":"1001","highlight":["1001"]}]}]}])");
+    ddwaf_result_free(&ret);
+    ddwaf_context_destroy(context);
+
+    context = ddwaf_context_init(handle, ddwaf_object_free);
+    ASSERT_NE(context, nullptr);
+
+    ddwaf_object_map(&param);
+    ddwaf_object_map_add(&param, "body.size", ddwaf_object_unsigned_force(&tmp, 1000));
+
+    EXPECT_EQ(ddwaf_run(context, &param, nullptr, LONG_TIME), DDWAF_GOOD);
+
+    ddwaf_context_destroy(context);
+    ddwaf_destroy(handle);
+}
@@ -0,0 +1,100 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include "../test.h"
+
+TEST(TestExactMatch, TestBasic)
+{
+    ExactMatch processor({ "aaaa", "bbbb", "aaaa", "", "a longer value than eight bytes" });
+    EXPECT_STREQ(processor.getStringRepresentation().c_str(), "(null)");
+    EXPECT_STREQ(processor.operatorName().data(), "exact_match");
+    EXPECT_EQ(processor.valueCount(), 4);
+
+    std::vector<uint8_t> matchestogather;
+    MatchGatherer gatherer(matchestogather);
+
+    for (const char* value : { "aaaa", "bbbb", "", "a longer value than eight bytes" })
+    {
+        ddwaf_object param;
+        ddwaf_object_string(&param, value);
+
+        EXPECT_TRUE(processor.doesMatch(&param, gatherer));
+        EXPECT_STREQ(gatherer.resolvedValue.c_str(), value);
+        EXPECT_STREQ(gatherer.matchedValue.c_str(), value);
+
+        ddwaf_object_free(&param);
+    }
+
+    // Only whole values match
+    for (const char* value : { "aaa", "aaaaa", "xaaaa", "AAAA", "a longer value than eight bytes!" })
+    {
+        ddwaf_object param;
+        ddwaf_object_string(&param, value);
+
+        EXPECT_FALSE(processor.doesMatch(&param, gatherer));
+
+        ddwaf_object_free(&param);
+    }
+}
+
+TEST(TestExactMatch, TestLargeList)
+{
+    std::vector<std::string> tokens;
+    for (size_t i = 0; i < 50000; ++i)
+    {
+        tokens.push_back("user-" + std::to_string(i * 7919));
+    }
+
+    ExactMatch processor(std::vector<std::string_view>(tokens.begin(), tokens.end()));
+    EXPECT_EQ(processor.valueCount(), tokens.size());
+
+    std::vector<uint8_t> matchestogather;
+    MatchGatherer gatherer(matchestogather);
+    for (size_t i = 0; i < 100000; ++i)
+    {
+        const std::string value = "user-" + std::to_string(i * 7919 / 2);
+
+        ddwaf_object param;
+        ddwaf_object_stringl_nc(&param, value.c_str(), value.size());
+        EXPECT_EQ(processor.doesMatch(&param, gatherer), i % 2 == 0) << value;
+    }
+}
+
+TEST(TestExactMatch, TestRuleset)
+{
+    auto rule = readRule(R"({version: '2.1', rules: [{id: 1, name: rule1, tags: {type: flow1, category: category1}, conditions: [{operator: exact_match, parameters: {inputs: [{address: usr.id}], list: [admin, root]}}]}]})");
+    ASSERT_TRUE(rule.type != DDWAF_OBJ_INVALID);
+
+    ddwaf_handle handle = ddwaf_init(&rule, nullptr);
+    ASSERT_NE(handle, nullptr);
+    ddwaf_object_free(&rule);
+
+    ddwaf_context context = ddwaf_context_init(handle, ddwaf_object_free);
+    ASSERT_NE(context, nullptr);
+
+    ddwaf_object param, tmp;
+    ddwaf_object_map(&param);
+    ddwaf_object_map_add(&param, "usr.id", ddwaf_object_string(&tmp, "admin"));
+
+    ddwaf_result ret;
+
+    auto code = ddwaf_run(context, &param, &ret, LONG_TIME);
+    EXPECT_EQ(code, DDWAF_MONITOR);
+    EXPECT_STREQ(ret.data, R"([{"rule":{"id":"1","name":"rule1","tags":{"type":"flow1","category":"category1"}},"rule_matches":[{"operator":"exact_match","operator_value":"","parameters":[{"address":"usr.id","key_path":[],"value":"admin","highlight":["admin"]}]}]}])");
+    ddwaf_result_free(&ret);
+    ddwaf_context_destroy(context);
+
+    context = ddwaf_context_init(handle, ddwaf_object_free);
+    ASSERT_NE(context, nullptr);
+
+    ddwaf_object_map(&param);
+    ddwaf_object_map_add(&param, "usr.id", ddwaf_object_string(&tmp, "administrator"));
+
+    EXPECT_EQ(ddwaf_run(context, &param, nullptr, LONG_TIME), DDWAF_GOOD);
+
+    ddwaf_context_destroy(context);
+    ddwaf_destroy(handle);
+}
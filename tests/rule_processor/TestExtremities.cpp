@@ -0,0 +1,107 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include "../test.h"
+
+TEST(TestExtremities, TestBasic)
+{
+    BeginsWith begins("/admin");
+    Contains contains("/admin");
+    EndsWith ends("/admin");
+    EXPECT_STREQ(contains.getStringRepresentation().c_str(), "/admin");
+    EXPECT_STREQ(begins.operatorName().data(), "begins_with");
+    EXPECT_STREQ(contains.operatorName().data(), "contains");
+    EXPECT_STREQ(ends.operatorName().data(), "ends_with");
+
+    EXPECT_THROW(Contains(""), ddwaf::parsing_error);
+
+    std::vector<uint8_t> matchestogather;
+    MatchGatherer gatherer(matchestogather);
+
+    ddwaf_object param;
+    ddwaf_object_string(&param, "/admin/login");
+    EXPECT_TRUE(begins.doesMatch(&param, gatherer));
+    EXPECT_STREQ(gatherer.resolvedValue.c_str(), "/admin/login");
+    EXPECT_STREQ(gatherer.matchedValue.c_str(), "/admin");
+    EXPECT_TRUE(contains.doesMatch(&param, gatherer));
+    EXPECT_FALSE(ends.doesMatch(&param, gatherer));
+    ddwaf_object_free(&param);
+
+    ddwaf_object_string(&param, "/site/admin");
+    EXPECT_FALSE(begins.doesMatch(&param, gatherer));
+    EXPECT_TRUE(contains.doesMatch(&param, gatherer));
+    EXPECT_TRUE(ends.doesMatch(&param, gatherer));
+    ddwaf_object_free(&param);
+
+    ddwaf_object_string(&param, "/admi");
+    EXPECT_FALSE(begins.doesMatch(&param, gatherer));
+    EXPECT_FALSE(contains.doesMatch(&param, gatherer));
+    EXPECT_FALSE(ends.doesMatch(&param, gatherer));
+    ddwaf_object_free(&param);
+}
+
+TEST(TestExtremities, TestContainsLongString)
+{
+    Contains contains("/etc/passwd");
+
+    std::vector<uint8_t> matchestogather;
+    MatchGatherer gatherer(matchestogather);
+
+    // Partial matches of the first and last bytes all along the string
+    std::string input;
+    while (input.size() < 10000)
+        input += "/etc/passw /tc/passwd ";
+
+    ddwaf_object param;
+    ddwaf_object_stringl_nc(&param, input.c_str(), input.size());
+    EXPECT_FALSE(contains.doesMatch(&param, gatherer));
+
+    for (size_t position : { 0, 1, 15, 31, 5000, 9999 })
+    {
+        std::string found = input;
+        found.insert(position, "/etc/passwd");
+
+        ddwaf_object_stringl_nc(&param, found.c_str(), found.size());
+        EXPECT_TRUE(contains.doesMatch(&param, gatherer)) << position;
+        EXPECT_STREQ(gatherer.matchedValue.c_str(), "/etc/passwd");
+    }
+}
+
+TEST(TestExtremities, TestRuleset)
+{
+    auto rule = readRule(R"({version: '2.1', rules: [{id: 1, name: rule1, tags: {type: flow1, category: category1}, conditions: [{operator: contains, parameters: {inputs: [{address: server.request.uri.raw}], value: ../}}]}]})");
+    ASSERT_TRUE(rule.type != DDWAF_OBJ_INVALID);
+
+    ddwaf_handle handle = ddwaf_init(&rule, nullptr);
+    ASSERT_NE(handle, nullptr);
+    ddwaf_object_free(&rule);
+
+    ddwaf_context context = ddwaf_context_init(handle, ddwaf_object_free);
+    ASSERT_NE(context, nullptr);
+
+    ddwaf_object param, tmp;
+    ddwaf_object_map(&param);
+    ddwaf_object_map_add(&param, "server.request.uri.raw", ddwaf_object_string(&tmp, "/static/../../secret"));
+
+    ddwaf_result ret;
+
+    auto code = ddwaf_run(context, &param, &ret, LONG_TIME);
+    EXPECT_EQ(code, DDWAF_MONITOR);
+    EXPECT_STREQ(ret.data, R"([{"rule":{"id":"1","name":"rule1","tags":{"type":"flow1","category":"category1"}},"rule_matches":[{"operator":"contains","operator_value":"../","parameters":[{"address":"server.request.uri.raw","key_path":[],"value":"/static/../../secret","highlight":["../"]}]}]}])");
+    ddwaf_result_free(&ret);
+    ddwaf_context_destroy(context);
+
+    context = ddwaf_context_init(handle, ddwaf_object_free);
+    ASSERT_NE(context, nullptr);
+
+    ddwaf_object_map(&param);
+    ddwaf_object_map_add(&param, "server.request.uri.raw", ddwaf_object_string(&tmp, "/static/./secret"));
+
+    EXPECT_EQ(ddwaf_run(context, &param, nullptr, LONG_TIME), DDWAF_GOOD);
+
+    ddwaf_context_destroy(context);
+    ddwaf_destroy(handle);
+}
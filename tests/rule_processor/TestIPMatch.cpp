@@ -0,0 +1,76 @@
+// Unless explicitly stated otherwise all files in this repository are
+// dual-licensed under the Apache-2.0 License or BSD-3-Clause License.
+//
+// This product includes software developed at Datadog (https://www.datadoghq.com/).
+// Copyright 2021 Datadog, Inc.
+
+#include "../test.h"
+
+TEST(TestIPMatch, TestBasic)
+{
+    IPMatch processor({ "1.2.3.4", "5.6.7.0/24", "abcd::/16" });
+    EXPECT_STREQ(processor.getStringRepresentation().c_str(), "(null)");
+    EXPECT_STREQ(processor.operatorName().data(), "ip_match");
+    EXPECT_EQ(processor.rangeCount(), 3);
+
+    std::vector<uint8_t> matchestogather;
+    MatchGatherer gatherer(matchestogather);
+
+    for (const char* ip : { "1.2.3.4", "5.6.7.254", "::ffff:5.6.7.1", "abcd::1234" })
+    {
+        ddwaf_object param;
+        ddwaf_object_string(&param, ip);
+
+        EXPECT_TRUE(processor.doesMatch(&param, gatherer));
+        EXPECT_STREQ(gatherer.resolvedValue.c_str(), ip);
+        EXPECT_STREQ(gatherer.matchedValue.c_str(), ip);
+
+        ddwaf_object_free(&param);
+    }
+
+    for (const char* ip : { "1.2.3.5", "5.6.8.0", "abce::1", "not an ip", "1.2.3.4/32", "" })
+    {
+        ddwaf_object param;
+        ddwaf_object_string(&param, ip);
+
+        EXPECT_FALSE(processor.doesMatch(&param, gatherer));
+
+        ddwaf_object_free(&param);
+    }
+}
+
+TEST(TestIPMatch, TestRuleset)
+{
+    auto rule = readRule(R"({version: '2.1', rules: [{id: 1, name: rule1, tags: {type: flow1, category: category1}, conditions: [{operator: ip_match, parameters: {inputs: [{address: http.client_ip}], list: [192.168.0.1/24, "::1"]}}]}]})");
+    ASSERT_TRUE(rule.type != DDWAF_OBJ_INVALID);
+
+    ddwaf_handle handle = ddwaf_init(&rule, nullptr);
+    ASSERT_NE(handle, nullptr);
+    ddwaf_object_free(&rule);
+
+    ddwaf_context context = ddwaf_context_init(handle, ddwaf_object_free);
+    ASSERT_NE(context, nullptr);
+
+    ddwaf_object param, tmp;
+    ddwaf_object_map(&param);
+    ddwaf_object_map_add(&param, "http.client_ip", ddwaf_object_string(&tmp, "192.168.0.12"));
+
+    ddwaf_result ret;
+
+    auto code = ddwaf_run(context, &param, &ret, LONG_TIME);
+    EXPECT_EQ(code, DDWAF_MONITOR);
+    EXPECT_STREQ(ret.data, R"([{"rule":{"id":"1","name":"rule1","tags":{"type":"flow1","category":"category1"}},"rule_matches":[{"operator":"ip_match","operator_value":"","parameters":[{"address":"http.client_ip","key_path":[],"value":"192.168.0.12","highlight":["192.168.0.12"]}]}]}])");
+    ddwaf_result_free(&ret);
+    ddwaf_context_destroy(context);
+
+    context = ddwaf_context_init(handle, ddwaf_object_free);
+    ASSERT_NE(context, nullptr);
+
+    ddwaf_object_map(&param);
+    ddwaf_object_map_add(&param, "http.client_ip", ddwaf_object_string(&tmp, "192.168.1.12"));
+
+    EXPECT_EQ(ddwaf_run(context, &param, nullptr, LONG_TIME), DDWAF_GOOD);
+
+    ddwaf_context_destroy(context);
+    ddwaf_destroy(handle);
+}
@@ -52,3 +52,49 @@ TEST(TestLibInjectionXSS, TestRuleset)
     ddwaf_context_destroy(context);
     ddwaf_destroy(handle);
 }
+
+TEST(TestLibInjectionXSS, TestLongString)
+{
+    auto rule = readRule(R"({version: '2.1', rules: [{id: 1, name: rule1, tags: {type: flow1, category: category1}, conditions: [{operator: is_xss, parameters: {inputs: [{address: arg1}]}}]}]})");
+    ASSERT_TRUE(rule.type != DDWAF_OBJ_INVALID);
+
+    //The attack lies across the boundary of the first two windows, then far past the first one
+    for (size_t offset : { DDWAF_MAX_STRING_LENGTH - 4, 5 * DDWAF_MAX_STRING_LENGTH })
+    {
+        std::string input(8 * DDWAF_MAX_STRING_LENGTH, 'A');
+        input.replace(offset, 26, "<script>alert(1);</script>");
+
+        for (uint64_t budget : { 0, 8 * DDWAF_MAX_STRING_LENGTH })
+        {
+            ddwaf_options options = { sizeof(ddwaf_options), DDWAF_RESULT_JSON, 0, budget };
+            ddwaf_handle handle   = ddwaf_init_with_options(&rule, nullptr, &options);
+            ASSERT_NE(handle, nullptr);
+
+            ddwaf_context context = ddwaf_context_init(handle, ddwaf_object_free);
+            ASSERT_NE(context, nullptr);
+
+            ddwaf_object param, tmp;
+            ddwaf_object_map(&param);
+            ddwaf_object_map_add(&param, "arg1", ddwaf_object_stringl(&tmp, input.c_str(), input.size()));
+
+            ddwaf_result ret;
+            if (budget != 0)
+            {
+                EXPECT_EQ(ddwaf_run(context, &param, &ret, LONG_TIME), DDWAF_MONITOR);
+                ASSERT_NE(ret.data, nullptr);
+                EXPECT_NE(strstr(ret.data, "<script>alert(1);</script>"), nullptr);
+            }
+            else
+            {
+                EXPECT_EQ(ddwaf_run(context, &param, &ret, LONG_TIME), DDWAF_GOOD);
+                EXPECT_EQ(ret.data, nullptr);
+            }
+            ddwaf_result_free(&ret);
+
+            ddwaf_context_destroy(context);
+            ddwaf_destroy(handle);
+        }
+    }
+
+    ddwaf_object_free(&rule);
+}
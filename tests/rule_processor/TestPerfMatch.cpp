@@ -99,3 +99,106 @@ TEST(TestPhraseMatch, TestComplex)
     run("String21", NULL);
     run("nonsense", NULL);
 }
+
+TEST(TestPhraseMatch, TestGroup)
+{
+    std::vector<const char*> strings1 { "string2", "string 3", "ring" };
+    std::vector<const char*> strings2 { "string21", "str", "_4" };
+    std::vector<const char*> strings3 { "nothing" };
+
+    auto make = [](const std::vector<const char*>& strings) {
+        std::vector<uint32_t> lengths;
+        for (const char* str : strings)
+        {
+            lengths.push_back(strlen(str));
+        }
+        return std::make_unique<PerfMatch>(strings, lengths);
+    };
+
+    std::vector<std::unique_ptr<PerfMatch>> standalone, grouped;
+    for (const auto* strings : { &strings1, &strings2, &strings3 })
+    {
+        standalone.emplace_back(make(*strings));
+        grouped.emplace_back(make(*strings));
+    }
+
+    std::vector<const std::vector<std::string>*> lists;
+    for (const auto& processor : grouped)
+    {
+        lists.push_back(&processor->getPatterns());
+    }
+
+    auto group = std::make_shared<const PerfMatchGroup>(lists);
+    EXPECT_EQ(group->memberCount(), 3);
+    for (uint32_t i = 0; i < grouped.size(); ++i)
+    {
+        grouped[i]->joinGroup(group, i);
+    }
+
+    std::vector<uint8_t> matchestogather;
+    for (const char* str : { "string21", "bla_string 3", "string_4", "strin", "nothing_string", "" })
+    {
+        ddwaf_object param;
+        ddwaf_object_string(&param, str);
+
+        for (uint32_t i = 0; i < grouped.size(); ++i)
+        {
+            MatchGatherer expected(matchestogather), actual(matchestogather);
+            EXPECT_EQ(standalone[i]->doesMatch(&param, expected), grouped[i]->doesMatch(&param, actual)) << str;
+            EXPECT_STREQ(expected.matchedValue.c_str(), actual.matchedValue.c_str());
+            EXPECT_STREQ(expected.resolvedValue.c_str(), actual.resolvedValue.c_str());
+        }
+
+        ddwaf_object_free(&param);
+    }
+}
+
+TEST(TestPhraseMatch, TestGroupRuns)
+{
+    std::vector<const char*> strings1 { "attack" };
+    std::vector<const char*> strings2 { "safe" };
+
+    std::vector<std::unique_ptr<PerfMatch>> grouped;
+    std::vector<const std::vector<std::string>*> lists;
+    for (const auto* strings : { &strings1, &strings2 })
+    {
+        grouped.emplace_back(std::make_unique<PerfMatch>(*strings, std::vector<uint32_t> { (uint32_t) strlen((*strings)[0]) }));
+        lists.push_back(&grouped.back()->getPatterns());
+    }
+
+    auto group = std::make_shared<const PerfMatchGroup>(lists);
+    for (uint32_t i = 0; i < grouped.size(); ++i)
+    {
+        grouped[i]->joinGroup(group, i);
+    }
+
+    // The same buffer holds another input in the next run
+    char buffer[] = "an attack";
+    ddwaf_object param;
+    ddwaf_object_stringl_nc(&param, buffer, sizeof(buffer) - 1);
+
+    std::vector<uint8_t> matchestogather;
+    ddwaf::arena allocator;
+    {
+        MatchGatherer gatherer(matchestogather, &allocator);
+        EXPECT_NE(gatherer.run, 0);
+        EXPECT_TRUE(grouped[0]->doesMatch(&param, gatherer));
+        EXPECT_FALSE(grouped[1]->doesMatch(&param, gatherer));
+    }
+
+    allocator.reset();
+    memcpy(buffer, "a safe el", sizeof(buffer) - 1);
+    {
+        MatchGatherer gatherer(matchestogather, &allocator);
+        EXPECT_FALSE(grouped[0]->doesMatch(&param, gatherer));
+        EXPECT_TRUE(grouped[1]->doesMatch(&param, gatherer));
+    }
+
+    // Without an arena, every input is scanned
+    memcpy(buffer, "an attack", sizeof(buffer) - 1);
+    MatchGatherer gatherer(matchestogather);
+    EXPECT_EQ(gatherer.run, 0);
+    EXPECT_TRUE(grouped[0]->doesMatch(&param, gatherer));
+    memcpy(buffer, "a safe el", sizeof(buffer) - 1);
+    EXPECT_TRUE(grouped[1]->doesMatch(&param, gatherer));
+}
@@ -93,3 +93,234 @@ TEST(TestRegexMatch, TestComplexRegex)
     EXPECT_TRUE(processor.doesMatch(&param, gather));
     ddwaf_object_free(&param);
 }
+
+TEST(TestRegexMatch, TestGroup)
+{
+    RE2Manager processor1("^(regex)(.*)$", false);
+    RE2Manager processor2("ex$", false);
+    RE2Manager processor3("pony", false);
+
+    std::vector<RE2Manager*> members { &processor1, &processor2, &processor3 };
+    std::vector<const re2::RE2*> regexes;
+    for (const RE2Manager* member : members)
+    {
+        regexes.push_back(&member->getRegex());
+    }
+
+    auto group = std::make_shared<const RE2ManagerGroup>(regexes, false);
+    EXPECT_EQ(group->memberCount(), 3);
+    // "ex" is too short to be an atom
+    EXPECT_EQ(group->prefilteredCount(), 2);
+    EXPECT_EQ(group->atomCount(), 2);
+    for (uint32_t i = 0; i < members.size(); ++i)
+    {
+        members[i]->joinGroup(group, i);
+    }
+
+    std::vector<uint8_t> matchestogather { 1, 2 };
+    MatchGatherer gatherer(matchestogather);
+    ddwaf_object param;
+    ddwaf_object_string(&param, "REGEX and regex");
+
+    EXPECT_TRUE(processor1.doesMatch(&param, gatherer));
+    EXPECT_STREQ(gatherer.matchedValue.c_str(), "REGEX and regex");
+    ASSERT_EQ(gatherer.submatches.size(), 2);
+    EXPECT_STREQ(gatherer.submatches[0].second.c_str(), "REGEX");
+    EXPECT_STREQ(gatherer.submatches[1].second.c_str(), " and regex");
+
+    EXPECT_TRUE(processor2.doesMatch(&param, gatherer));
+    EXPECT_FALSE(processor3.doesMatch(&param, gatherer));
+
+    ddwaf_object param2;
+    ddwaf_object_string(&param2, "Pony");
+
+    EXPECT_FALSE(processor1.doesMatch(&param2, gatherer));
+    EXPECT_FALSE(processor2.doesMatch(&param2, gatherer));
+    EXPECT_TRUE(processor3.doesMatch(&param2, gatherer));
+
+    ddwaf_object_free(&param);
+    ddwaf_object_free(&param2);
+}
+
+TEST(TestRegexMatch, TestGroupAtoms)
+{
+    const std::vector<std::string> patterns {
+        "union\\s+(all\\s+)?select",
+        "<script[^>]*>",
+        "/etc/(passwd|shadow)",
+        "(?i)JaVaScRiPt:",
+        "\\.\\./",
+        "[0-9]{16}",
+        "a.b",
+    };
+
+    for (const bool caseSensitive : { false, true })
+    {
+        std::vector<std::unique_ptr<RE2Manager>> grouped, alone;
+        std::vector<const re2::RE2*> regexes;
+        for (const std::string& pattern : patterns)
+        {
+            grouped.push_back(std::make_unique<RE2Manager>(pattern, caseSensitive));
+            alone.push_back(std::make_unique<RE2Manager>(pattern, caseSensitive));
+            regexes.push_back(&grouped.back()->getRegex());
+        }
+
+        auto group = std::make_shared<const RE2ManagerGroup>(regexes, caseSensitive);
+        // Neither [0-9]{16} nor a.b have a literal of 3 bytes
+        EXPECT_EQ(group->prefilteredCount(), 5);
+        for (uint32_t i = 0; i < grouped.size(); ++i)
+        {
+            grouped[i]->joinGroup(group, i);
+        }
+
+        std::vector<uint8_t> matchestogather;
+        MatchGatherer gatherer(matchestogather);
+        for (const char* input : { "1 UNION ALL SELECT password", "1 union  select", "<SCRIPT src=x>", "<script>",
+                                   "/etc/passwd", "/ETC/shadow", "JAVASCRIPT:alert(1)", "../../", "4111111111111111",
+                                   "axb", "nothing to see", "" })
+        {
+            ddwaf_object param;
+            ddwaf_object_string(&param, input);
+            for (size_t i = 0; i < grouped.size(); ++i)
+            {
+                EXPECT_EQ(grouped[i]->doesMatch(&param, gatherer), alone[i]->doesMatch(&param, gatherer)) << patterns[i] << " " << input;
+            }
+            ddwaf_object_free(&param);
+        }
+    }
+
+    // Atoms are looked for in the input lowercased bytewise, which isn't
+    // enough for the others
+    RE2Manager processor1("(?i)caf\xc3\xa9", false);
+    RE2Manager processor2("pony", false);
+    auto group = std::make_shared<const RE2ManagerGroup>(std::vector<const re2::RE2*> { &processor1.getRegex(), &processor2.getRegex() }, false);
+    EXPECT_EQ(group->prefilteredCount(), 0);
+    processor1.joinGroup(group, 0);
+
+    std::vector<uint8_t> matchestogather;
+    MatchGatherer gatherer(matchestogather);
+    ddwaf_object param;
+    ddwaf_object_string(&param, "CAF\xc3\x89");
+    EXPECT_TRUE(processor1.doesMatch(&param, gatherer));
+    ddwaf_object_free(&param);
+}
+
+TEST(TestRegexMatch, TestGroupUnicodeCaseFolding)
+{
+    // The long s (U+017F) folds to s and the Kelvin sign (U+212A) to k, the
+    // case being folded by the group or within the pattern
+    for (const bool caseSensitive : { false, true })
+    {
+        RE2Manager processor1(caseSensitive ? "(?i)select" : "select", caseSensitive);
+        RE2Manager processor2(caseSensitive ? "(?i)kill" : "kill", caseSensitive);
+        RE2Manager processor3("pony", caseSensitive);
+        auto group = std::make_shared<const RE2ManagerGroup>(std::vector<const re2::RE2*> { &processor1.getRegex(), &processor2.getRegex(), &processor3.getRegex() }, caseSensitive);
+        EXPECT_EQ(group->prefilteredCount(), 3);
+        processor1.joinGroup(group, 0);
+        processor2.joinGroup(group, 1);
+        processor3.joinGroup(group, 2);
+
+        std::vector<uint8_t> matchestogather;
+        MatchGatherer gatherer(matchestogather);
+        ddwaf_object param;
+        ddwaf_object_string(&param, "1 \xc5\xbf" "elect \xe2\x84\xaa" "ill");
+        EXPECT_TRUE(processor1.doesMatch(&param, gatherer));
+        EXPECT_TRUE(processor2.doesMatch(&param, gatherer));
+        EXPECT_FALSE(processor3.doesMatch(&param, gatherer));
+        ddwaf_object_free(&param);
+    }
+}
+
+TEST(TestRegexMatch, TestMaxMemory)
+{
+    RE2Manager processor("[a-z]+[0-9]{3}(foo|bar)+baz", false);
+    processor.warmUp();
+    EXPECT_EQ(processor.dfaFallbacks(), 0);
+
+    // Too small to compile the regular expression
+    EXPECT_FALSE(processor.setMaxMemory(100));
+
+    // Enough to compile it, but not for its DFA
+    EXPECT_TRUE(processor.setMaxMemory(8 * 1024));
+    processor.warmUp();
+    const uint64_t fallbacks = processor.dfaFallbacks();
+    EXPECT_GT(fallbacks, 0);
+
+    std::vector<uint8_t> matchestogather;
+    MatchGatherer gatherer(matchestogather);
+    ddwaf_object param;
+    ddwaf_object_string(&param, "-abc123foobarbaz");
+
+    EXPECT_TRUE(processor.doesMatch(&param, gatherer));
+    EXPECT_STREQ(gatherer.matchedValue.c_str(), "abc123foobarbaz");
+    EXPECT_GT(processor.dfaFallbacks(), fallbacks);
+
+    ddwaf_object_free(&param);
+}
+
+TEST(TestRegexMatch, TestFitMaxMemory)
+{
+    RE2Manager processor("[a-z]+[0-9]{3}(foo|bar)+baz", false);
+
+    // The smallest budget, doubling from 100 bytes, it compiles in
+    const int64_t fitted = processor.fitMaxMemory(100);
+    EXPECT_GT(fitted, 100);
+    EXPECT_LT(fitted, RE2Manager::defaultMaxMemory);
+    EXPECT_EQ(processor.getRegex().options().max_mem(), fitted);
+    EXPECT_FALSE(processor.setMaxMemory(fitted / 2));
+
+    // A larger budget is kept as is
+    EXPECT_EQ(processor.fitMaxMemory(64 * 1024), 64 * 1024);
+}
+
+TEST(TestRegexMatch, TestGroupMaxMemory)
+{
+    // The first two are prefiltered by their atoms, the last two go through the set
+    RE2Manager processor1("admin[0-9]+", false);
+    RE2Manager processor2("passwd|shadow", false);
+    RE2Manager processor3("^[a-f0-9]{32}$", false);
+    RE2Manager processor4("^\\d+\\.\\d+$", false);
+
+    const int64_t share = 32 * 1024;
+    std::vector<const re2::RE2*> regexes;
+    for (RE2Manager* member : { &processor1, &processor2, &processor3, &processor4 })
+    {
+        EXPECT_EQ(member->fitMaxMemory(share), share);
+        regexes.push_back(&member->getRegex());
+    }
+
+    // The copies of the filter and the set share the budget
+    RE2ManagerGroup group(regexes, false, 4 * share);
+    EXPECT_EQ(group.prefilteredCount(), 2);
+    EXPECT_LE(group.maxMemory(), 4 * share);
+
+    // Without a budget, the copies and the set get the budget of the members
+    RE2ManagerGroup unbounded(regexes, false);
+    EXPECT_EQ(unbounded.maxMemory(), 6 * share);
+}
+
+TEST(TestRegexMatch, TestLongString)
+{
+    RE2Manager processor("(regex)", true);
+
+    std::string input(4 * DDWAF_MAX_STRING_LENGTH, 'A');
+    input.replace(3 * DDWAF_MAX_STRING_LENGTH, 5, "regex");
+
+    std::vector<uint8_t> matchestogather;
+    MatchGatherer gatherer(matchestogather);
+    ddwaf_object param;
+    ddwaf_object_stringl(&param, input.c_str(), input.size());
+
+    //Past the default budget
+    EXPECT_FALSE(processor.doesMatch(&param, gatherer));
+
+    processor.setMaxStringLength(input.size());
+    EXPECT_TRUE(processor.doesMatch(&param, gatherer));
+    EXPECT_STREQ(gatherer.matchedValue.c_str(), "regex");
+
+    //Only the window starting with the match is reported
+    EXPECT_EQ(gatherer.resolvedValue.size(), DDWAF_MAX_STRING_LENGTH);
+    EXPECT_EQ(gatherer.resolvedValue.compare(0, 5, "regex"), 0);
+
+    ddwaf_object_free(&param);
+}